@@ -0,0 +1,841 @@
+#include <JuceHeader.h>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include "JobQueue.h"
+#include "ModelDownloader.h"
+#include "ModelLoader.h"
+#include "ModelRegistry.h"
+#include "ResourceUsage.h"
+#include "SeparationClient.h"
+#include "StemMetrics.h"
+#include "StemSeparator.h"
+#include "Telemetry.h"
+#include "ThreadTuner.h"
+#include "Trace.h"
+
+namespace
+{
+    struct BatchOptions
+    {
+        juce::File modelFile { ModelDownloader::getDefaultModelFile() };
+
+        // Registry preset to run instead of modelFile, see ModelRegistry
+        juce::String ensembleName;
+
+        // Fetch missing model files first
+        bool download { false };
+        ModelDownloader::Options downloadOptions;
+        juce::File outputRoot;
+        juce::File referenceRoot;
+        juce::File traceFile;
+        juce::File cacheDirectory;
+        juce::int64 cacheMaxBytes { StemCache::kDefaultMaxBytes };
+        juce::Array<juce::File> inputFiles;
+        int numWorkers { juce::jmax(1, juce::SystemStats::getNumPhysicalCpus()) };
+        bool numWorkersGiven { false };
+
+        // Split the cores between workers and their BLAS threads, see ThreadTuner
+        bool autoThreads { false };
+        bool recalibrateThreads { false };
+        std::shared_ptr<const ThreadTuner::Plan> threadPlan;
+        StemSeparator::Options separatorOptions;
+        bool verbose { false };
+
+        // Send the files to a running DemucsServer instead of loading the model
+        bool useServer { false };
+        int serverPort { SeparationProtocol::kDefaultPort };
+        juce::String serverModel;
+
+        // Job queue mode
+        juce::File queueFile;
+        int priority { 0 };
+        juce::StringArray pauseIds;
+        juce::StringArray resumeIds;
+        juce::StringArray removeIds;
+        std::vector<std::pair<juce::String, int>> priorityChanges;
+        bool runQueue { false };
+    };
+
+    struct BatchEntry
+    {
+        juce::File inputFile;
+        StemSeparator::Result result;
+        juce::String error;
+        bool succeeded { false };
+        double meanSdr { 0.0 };
+    };
+
+    juce::String getPresetNames()
+    {
+        juce::StringArray names;
+        for (const auto& preset : ModelRegistry::getPresets())
+            names.add(preset.name);
+        return names.joinIntoString(", ");
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: DemucsBatch [options] <file|directory>...\n"
+                  << "\n"
+                  << "Options:\n"
+                  << "  --model <file>        Model file (default: " << ModelDownloader::getDefaultModelFile().getFullPathName() << ")\n"
+                  << "  --ensemble <name>     Run a preset from the model folder instead: " << getPresetNames() << "\n"
+                  << "  --download            Download missing model files first, then exit if there are no inputs\n"
+                  << "  --model-url <url>     Where --download fetches from (default: " << ModelDownloader::getDefaultBaseUrl() << ")\n"
+                  << "  --jobs <n>            Number of files separated at once (default: physical core count)\n"
+                  << "  --auto-threads        Pick the job count and BLAS threads per job from a calibration run cached\n"
+                  << "                        for this machine, and pin each job to its own cores (with --jobs: split evenly)\n"
+                  << "  --recalibrate         Run the --auto-threads calibration again\n"
+                  << "  --output <dir>        Write <name>_stems folders here instead of next to each input\n"
+                  << "  --list <file>         Read input paths from a text file, one per line\n"
+                  << "  --stream              Decode, separate and write in chunks to bound memory per job\n"
+                  << "  --chunk-seconds <s>   Chunk length for --stream (default: 30)\n"
+                  << "  --chunk-workers <n>   Chunks of one file separated at once with --stream (default: 1)\n"
+                  << "  --half-chunks         Hold chunks waiting to be stitched in FP16, half the memory\n"
+                  << "  --skip-silence <dB>   Don't separate segments whose peak is below this level, write silent stems\n"
+                  << "  --silence-to-other    With --skip-silence, put skipped segments into the other stem unchanged\n"
+                  << "  --format <name>       Stem encoding: wav16, wav24, float (32-bit WAV), flac16 or flac24 (default: wav16)\n"
+                  << "  --source-rate         Write stems at the input's sample rate instead of 44.1 kHz\n"
+                  << "  --reference <dir>     Compare stems with <dir>/<name>_stems and print SDR, e.g. against an FP32 run\n"
+                  << "  --cache <dir>         Reuse stems of unchanged segments from earlier runs stored in <dir>\n"
+                  << "  --cache-size <MB>     Size limit for --cache, least recently used segments go first (default: 4096)\n"
+                  << "  --trace <file>        Write a Chrome trace (chrome://tracing, Perfetto) and print per-stage timings\n"
+                  << "  --server              Separate on a running DemucsServer; --model or --ensemble then picks one of its models by name\n"
+                  << "  --port <n>            Port of the server (default: " << SeparationProtocol::kDefaultPort << ")\n"
+                  << "  --verbose             Print inference progress for every file, with the time since the start\n"
+                  << "  --run-tests           Run the unit tests and exit\n"
+                  << "  --help                Show this message\n"
+                  << "\n"
+                  << "Job queue (shared with the app, jobs resume from cached chunks after a stop or crash):\n"
+                  << "  --queue <file>        Add the inputs to this queue instead of separating them now (app: " << JobQueue::getDefaultQueueFile().getFullPathName() << ")\n"
+                  << "  --priority <n>        Priority of the added jobs, higher runs first (default: 0)\n"
+                  << "  --set-priority <id> <n>\n"
+                  << "  --pause <id>          Pause a queued or running job\n"
+                  << "  --resume <id>         Queue a paused or failed job again\n"
+                  << "  --remove <id>\n"
+                  << "  --run                 Run the queue until no queued jobs are left\n";
+    }
+
+    void addInput(const juce::File& file, const juce::String& wildcard, BatchOptions& options)
+    {
+        if (file.isDirectory())
+        {
+            auto children = file.findChildFiles(juce::File::findFiles, true, wildcard);
+            children.sort();
+            options.inputFiles.addArray(children);
+        }
+        else if (file.existsAsFile())
+        {
+            options.inputFiles.add(file);
+        }
+        else
+        {
+            throw std::runtime_error("No such file or directory: " + file.getFullPathName().toStdString());
+        }
+    }
+
+    BatchOptions parseArguments(const juce::ArgumentList& args)
+    {
+        BatchOptions options;
+
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+        const auto wildcard = formatManager.getWildcardForAllFormats();
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+
+            auto nextValue = [&]() -> juce::String
+            {
+                if (i + 1 >= args.size())
+                    throw std::runtime_error("Missing value for " + arg.text.toStdString());
+                return args[++i].text;
+            };
+
+            auto nextFile = [&]()
+            {
+                return juce::File::getCurrentWorkingDirectory().getChildFile(nextValue().unquoted());
+            };
+
+            if (arg == "--model")
+            {
+                options.modelFile = nextFile();
+                options.serverModel = options.modelFile.getFileNameWithoutExtension();
+                options.ensembleName = {};
+            }
+            else if (arg == "--ensemble")
+            {
+                options.ensembleName = nextValue();
+                if (ModelRegistry::findPreset(options.ensembleName) == nullptr)
+                    throw std::runtime_error("Unknown --ensemble, expected one of " + getPresetNames().toStdString());
+                options.serverModel = options.ensembleName;
+            }
+            else if (arg == "--jobs")
+            {
+                options.numWorkers = nextValue().getIntValue();
+                options.numWorkersGiven = true;
+                if (options.numWorkers < 1)
+                    throw std::runtime_error("--jobs must be at least 1");
+            }
+            else if (arg == "--output")
+            {
+                options.outputRoot = nextFile();
+            }
+            else if (arg == "--format")
+            {
+                if (!StemSeparator::parseOutputFormat(nextValue(), options.separatorOptions.outputFormat))
+                    throw std::runtime_error("Unknown --format, expected wav16, wav24, float, flac16 or flac24");
+            }
+            else if (arg == "--auto-threads")
+            {
+                options.autoThreads = true;
+            }
+            else if (arg == "--recalibrate")
+            {
+                options.autoThreads = true;
+                options.recalibrateThreads = true;
+            }
+            else if (arg == "--download")
+            {
+                options.download = true;
+            }
+            else if (arg == "--model-url")
+            {
+                options.downloadOptions.baseUrl = nextValue().trimCharactersAtEnd("/");
+            }
+            else if (arg == "--server")
+            {
+                options.useServer = true;
+            }
+            else if (arg == "--port")
+            {
+                options.serverPort = nextValue().getIntValue();
+            }
+            else if (arg == "--source-rate")
+            {
+                options.separatorOptions.keepSourceSampleRate = true;
+            }
+            else if (arg == "--reference")
+            {
+                options.referenceRoot = nextFile();
+            }
+            else if (arg == "--skip-silence")
+            {
+                options.separatorOptions.skipSilence = true;
+                options.separatorOptions.silenceThresholdDb = nextValue().getFloatValue();
+            }
+            else if (arg == "--silence-to-other")
+            {
+                options.separatorOptions.silenceToOther = true;
+            }
+            else if (arg == "--cache")
+            {
+                options.cacheDirectory = nextFile();
+            }
+            else if (arg == "--cache-size")
+            {
+                options.cacheMaxBytes = nextValue().getLargeIntValue() * 1024 * 1024;
+                if (options.cacheMaxBytes <= 0)
+                    throw std::runtime_error("--cache-size must be positive");
+            }
+            else if (arg == "--trace")
+            {
+                options.traceFile = nextFile();
+            }
+            else if (arg == "--list")
+            {
+                auto listFile = nextFile();
+
+                juce::StringArray lines;
+                listFile.readLines(lines);
+                for (auto& line : lines)
+                {
+                    line = line.trim();
+                    if (line.isNotEmpty() && !line.startsWithChar('#'))
+                        addInput(listFile.getParentDirectory().getChildFile(line), wildcard, options);
+                }
+            }
+            else if (arg == "--stream")
+            {
+                options.separatorOptions.streaming = true;
+            }
+            else if (arg == "--chunk-seconds")
+            {
+                options.separatorOptions.chunkSeconds = nextValue().getDoubleValue();
+                if (options.separatorOptions.chunkSeconds <= options.separatorOptions.overlapSeconds * 2.0)
+                    throw std::runtime_error("--chunk-seconds must be longer than twice the chunk overlap");
+            }
+            else if (arg == "--chunk-workers")
+            {
+                options.separatorOptions.numChunkWorkers = nextValue().getIntValue();
+                if (options.separatorOptions.numChunkWorkers < 1)
+                    throw std::runtime_error("--chunk-workers must be at least 1");
+            }
+            else if (arg == "--half-chunks")
+            {
+                options.separatorOptions.halfPrecisionPendingChunks = true;
+            }
+            else if (arg == "--queue")
+            {
+                options.queueFile = nextFile();
+            }
+            else if (arg == "--priority")
+            {
+                options.priority = nextValue().getIntValue();
+            }
+            else if (arg == "--set-priority")
+            {
+                const auto id = nextValue();
+                options.priorityChanges.emplace_back(id, nextValue().getIntValue());
+            }
+            else if (arg == "--pause")
+            {
+                options.pauseIds.add(nextValue());
+            }
+            else if (arg == "--resume")
+            {
+                options.resumeIds.add(nextValue());
+            }
+            else if (arg == "--remove")
+            {
+                options.removeIds.add(nextValue());
+            }
+            else if (arg == "--run")
+            {
+                options.runQueue = true;
+            }
+            else if (arg == "--verbose")
+            {
+                options.verbose = true;
+            }
+            else if (arg.isOption())
+            {
+                throw std::runtime_error("Unknown option: " + arg.text.toStdString());
+            }
+            else
+            {
+                addInput(arg.resolveAsFile(), wildcard, options);
+            }
+        }
+
+        return options;
+    }
+
+    juce::File getOutputDirectory(const BatchOptions& options, const juce::File& input)
+    {
+        return options.outputRoot == juce::File()
+            ? StemSeparator::getDefaultOutputDirectory(input)
+            : options.outputRoot.getChildFile(input.getFileNameWithoutExtension() + "_stems");
+    }
+
+    // Fetches the --model file or the --ensemble preset's files, whichever is missing
+    bool downloadModels(const BatchOptions& options)
+    {
+        auto downloadOptions = options.downloadOptions;
+        juce::StringArray fileNames;
+
+        if (const auto* preset = ModelRegistry::findPreset(options.ensembleName))
+        {
+            fileNames = preset->fileNames;
+        }
+        else
+        {
+            downloadOptions.directory = options.modelFile.getParentDirectory();
+            fileNames.add(options.modelFile.getFileName());
+        }
+
+        int lastPercent = -1;
+        try
+        {
+            ModelDownloader::download(fileNames, downloadOptions,
+                [&lastPercent](float progress, const juce::String& message) {
+                    const int percent = juce::roundToInt(progress * 100.0f);
+                    if (percent / 5 != lastPercent / 5 || progress >= 1.0f)
+                        std::cout << "[" << percent << "%] " << message << std::endl;
+                    lastPercent = percent;
+                });
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    // The --model file, or every member of the --ensemble preset
+    std::shared_ptr<const ModelEnsemble> loadModels(const BatchOptions& options)
+    {
+        std::vector<ModelLoader::Stats> stats;
+        std::shared_ptr<const ModelEnsemble> ensemble;
+
+        if (const auto* preset = ModelRegistry::findPreset(options.ensembleName))
+        {
+            std::cout << "Loading " << preset->name << " (" << preset->description << ")" << std::endl;
+            ensemble = ModelRegistry::load(*preset, ModelDownloader::getModelDirectory(), &stats);
+        }
+        else
+        {
+            std::cout << "Loading model " << options.modelFile.getFullPathName() << std::endl;
+            ensemble = ModelRegistry::load(juce::Array<juce::File> { options.modelFile }, &stats);
+        }
+
+        for (const auto& modelStats : stats)
+            std::cout << modelStats.toString() << std::endl;
+
+        return ensemble;
+    }
+
+    std::shared_ptr<StemCache> makeCache(const juce::File& directory, const ModelEnsemble& ensemble, const BatchOptions& options)
+    {
+        return std::make_shared<StemCache>(directory, ensemble.getModelFiles(), ensemble.getWeightsTag(), options.cacheMaxBytes);
+    }
+
+    class BatchWorker : public juce::Thread
+    {
+    public:
+        // Without a model the worker hands its files to the server in options
+        BatchWorker(int index,
+                    std::shared_ptr<const ModelEnsemble> ensemble,
+                    const BatchOptions& options,
+                    std::vector<BatchEntry>& entries,
+                    std::atomic<int>& nextEntry,
+                    juce::CriticalSection& outputLock,
+                    Telemetry& telemetry)
+            : Thread("DemucsBatchWorker" + juce::String(index)),
+              mIndex(index),
+              mOptions(options),
+              mEntries(entries),
+              mNextEntry(nextEntry),
+              mOutputLock(outputLock),
+              mTelemetry(telemetry)
+        {
+            if (ensemble != nullptr)
+            {
+                // Streaming chunk workers split this worker's cores between them
+                auto separatorOptions = options.separatorOptions;
+                if (options.threadPlan != nullptr)
+                    separatorOptions.threadPlan = std::make_shared<const ThreadTuner::Plan>(
+                        ThreadTuner::splitWorker(*options.threadPlan, index, separatorOptions.numChunkWorkers));
+
+                mSeparator = std::make_unique<StemSeparator>(std::move(ensemble));
+                mSeparator->setOptions(separatorOptions);
+            }
+            else
+            {
+                mClient = std::make_unique<SeparationClient>();
+                if (!mClient->connect(options.serverPort))
+                    throw std::runtime_error("No server of this user on port " + std::to_string(options.serverPort));
+            }
+        }
+
+        void run() override
+        {
+            if (mOptions.threadPlan != nullptr)
+                ThreadTuner::applyToCurrentThread(*mOptions.threadPlan, mIndex);
+
+            while (!threadShouldExit())
+            {
+                const int index = mNextEntry++;
+                if (index >= static_cast<int>(mEntries.size()))
+                    break;
+
+                processEntry(mEntries[(size_t) index]);
+            }
+        }
+
+    private:
+        void processEntry(BatchEntry& entry)
+        {
+            const auto& input = entry.inputFile;
+            const auto outputDir = getOutputDirectory(mOptions, input);
+
+            try
+            {
+                auto onProgress = [this, &input](float, const juce::String& message) {
+                    if (mOptions.verbose)
+                        mTelemetry.push(input.getFileName() + ": " + message, -1.0f, mIndex);
+                };
+                auto shouldCancel = [this]() {
+                    return threadShouldExit();
+                };
+
+                if (mSeparator != nullptr)
+                    entry.result = mSeparator->process(input, outputDir, onProgress, shouldCancel);
+                else
+                    entry.result = mClient->separate(input, outputDir, mOptions.separatorOptions, true,
+                                                     onProgress, shouldCancel, mOptions.serverModel);
+
+                print("[ok]     " + input.getFullPathName()
+                      + "  audio " + juce::String(entry.result.audioSeconds, 1) + " s"
+                      + "  wall " + juce::String(entry.result.wallSeconds, 1) + " s"
+                      + "  RTF " + juce::String(entry.result.getRealtimeFactor(), 3));
+
+                if (mOptions.verbose)
+                    print("         scratch allocations: " + juce::String(entry.result.scratchAllocations));
+
+                if (mOptions.separatorOptions.skipSilence)
+                    print("         silent segments skipped: " + juce::String(entry.result.numSilentSegments)
+                          + "/" + juce::String(entry.result.numSegments)
+                          + " (" + juce::String(entry.result.silentSeconds, 1) + " s)");
+
+                if (mOptions.separatorOptions.cache != nullptr || mClient != nullptr)
+                    print("         cached segments: " + juce::String(entry.result.numCachedSegments)
+                          + "/" + juce::String(entry.result.numSegments));
+
+                if (mOptions.referenceRoot != juce::File())
+                {
+                    const auto referenceDir = mOptions.referenceRoot.getChildFile(input.getFileNameWithoutExtension() + "_stems");
+                    const auto comparison = StemMetrics::compareStems(input, referenceDir, outputDir);
+                    entry.meanSdr = comparison.getMeanSdr();
+                    print("         " + comparison.toString());
+                }
+
+                entry.succeeded = true;
+            }
+            catch (const std::exception& e)
+            {
+                entry.error = e.what();
+                print("[failed] " + input.getFullPathName() + "  " + entry.error);
+            }
+        }
+
+        void print(const juce::String& line)
+        {
+            const juce::ScopedLock lock(mOutputLock);
+            std::cout << line << std::endl;
+        }
+
+        std::unique_ptr<StemSeparator> mSeparator;
+        std::unique_ptr<SeparationClient> mClient;
+        const int mIndex;
+        const BatchOptions& mOptions;
+        std::vector<BatchEntry>& mEntries;
+        std::atomic<int>& mNextEntry;
+        juce::CriticalSection& mOutputLock;
+        Telemetry& mTelemetry;
+    };
+}
+
+namespace
+{
+    void printJobs(const JobQueue& queue)
+    {
+        const auto jobs = queue.getJobs();
+        if (jobs.empty())
+        {
+            std::cout << "Queue is empty" << std::endl;
+            return;
+        }
+
+        for (const auto& job : jobs)
+            std::cout << job.id << "  " << JobQueue::getStateName(job.state).paddedRight(' ', 8)
+                      << "  priority " << juce::String(job.priority).paddedLeft(' ', 3)
+                      << "  " << juce::String(juce::roundToInt(job.progress * 100.0f)).paddedLeft(' ', 3) << " %"
+                      << "  " << job.inputFile.getFullPathName()
+                      << (job.message.isNotEmpty() ? "  (" + job.message + ")" : juce::String()) << std::endl;
+    }
+
+    int runQueueMode(BatchOptions& options)
+    {
+        std::unique_ptr<JobQueue> queue;
+        int exitCode = 0;
+
+        try
+        {
+            queue = std::make_unique<JobQueue>(options.queueFile);
+
+            for (const auto& input : options.inputFiles)
+                std::cout << "Queued " << queue->addJob(input, getOutputDirectory(options, input), options.priority)
+                          << "  " << input.getFullPathName() << std::endl;
+
+            auto apply = [&exitCode](bool succeeded, const juce::String& action, const juce::String& id)
+            {
+                if (!succeeded)
+                {
+                    std::cerr << "Error: could not " << action << " job " << id << std::endl;
+                    exitCode = 1;
+                }
+            };
+
+            for (const auto& [id, priority] : options.priorityChanges)
+                apply(queue->setPriority(id, priority), "reprioritise", id);
+            for (const auto& id : options.pauseIds)
+                apply(queue->pause(id), "pause", id);
+            for (const auto& id : options.resumeIds)
+                apply(queue->resume(id), "resume", id);
+            for (const auto& id : options.removeIds)
+                apply(queue->remove(id), "remove", id);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 2;
+        }
+
+        if (!options.runQueue)
+        {
+            printJobs(*queue);
+            return exitCode;
+        }
+
+        std::shared_ptr<const ModelEnsemble> ensemble;
+        try
+        {
+            ensemble = loadModels(options);
+
+            // Jobs checkpoint into stores of their own, this one reuses chunks across jobs
+            options.separatorOptions.cache = makeCache(
+                options.cacheDirectory != juce::File() ? options.cacheDirectory : StemCache::getDefaultDirectory(),
+                *ensemble, options);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 2;
+        }
+
+        int numFailed = 0;
+        queue->onJobFinished = [&numFailed](const JobQueue::Job& job)
+        {
+            if (job.state == JobQueue::State::failed)
+                ++numFailed;
+
+            std::cout << "[" << JobQueue::getStateName(job.state) << "] " << job.id << "  "
+                      << job.inputFile.getFullPathName() << "  " << job.message << std::endl;
+        };
+
+        if (!queue->startRunning(ensemble, options.separatorOptions, true))
+        {
+            std::cerr << "Error: the queue is already being run by another process" << std::endl;
+            return 2;
+        }
+
+        queue->waitUntilStopped();
+        printJobs(*queue);
+        return numFailed == 0 ? exitCode : 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h") || args.size() == 0)
+    {
+        printUsage();
+        return args.size() == 0 ? 2 : 0;
+    }
+
+    if (args.containsOption("--run-tests"))
+    {
+        juce::UnitTestRunner runner;
+        runner.setAssertOnFailure(false);
+        runner.runTestsInCategory("DemucsJUCE");
+
+        int numFailures = 0;
+        for (int i = 0; i < runner.getNumResults(); ++i)
+            numFailures += runner.getResult(i)->failures;
+
+        return numFailures == 0 ? 0 : 1;
+    }
+
+    BatchOptions options;
+    try
+    {
+        options = parseArguments(args);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+
+    if (options.download && !options.useServer)
+    {
+        if (!downloadModels(options))
+            return 2;
+
+        if (options.inputFiles.isEmpty() && options.queueFile == juce::File())
+            return 0;
+    }
+
+    if (options.queueFile != juce::File())
+        return runQueueMode(options);
+
+    if (options.inputFiles.isEmpty())
+    {
+        std::cerr << "Error: no input files" << std::endl;
+        return 2;
+    }
+
+    // Loaded once and shared read-only by every worker, unless a server does the work
+    std::shared_ptr<const ModelEnsemble> ensemble;
+    if (options.useServer)
+    {
+        SeparationClient probe;
+        if (!probe.connect(options.serverPort))
+        {
+            std::cerr << "Error: no DemucsServer of this user on port " << options.serverPort << std::endl;
+            return 2;
+        }
+
+        std::cout << "Using DemucsServer on port " << options.serverPort << std::endl;
+    }
+    else
+    {
+        try
+        {
+            ensemble = loadModels(options);
+
+            if (options.autoThreads)
+            {
+                const auto topology = ThreadTuner::Topology::detect();
+                std::cout << "CPU: " << topology.toString() << std::endl;
+
+                auto plan = options.numWorkersGiven
+                    ? ThreadTuner::makePlan(topology, options.numWorkers)
+                    : ThreadTuner::getTunedPlan(*ensemble->getMember(0).model, topology, options.recalibrateThreads,
+                                                [](const juce::String& message) { std::cout << message << std::endl; });
+
+                options.numWorkers = plan.numWorkers;
+                options.threadPlan = std::make_shared<const ThreadTuner::Plan>(std::move(plan));
+                std::cout << "Threads: " << options.threadPlan->toString() << std::endl;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    if (options.cacheDirectory != juce::File() && !options.useServer)
+    {
+        try
+        {
+            options.separatorOptions.cache = makeCache(options.cacheDirectory, *ensemble, options);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    // One set of encoder threads for every worker rather than one per worker
+    if (!options.useServer)
+        options.separatorOptions.writePool = std::make_shared<juce::ThreadPool>(StemSeparator::kNumStems);
+
+    std::cout << "Separating " << options.inputFiles.size() << " file(s) with "
+              << options.numWorkers << " worker(s)" << std::endl;
+
+    std::vector<BatchEntry> entries((size_t) options.inputFiles.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+        entries[i].inputFile = options.inputFiles[(int) i];
+
+    std::atomic<int> nextEntry { 0 };
+    juce::CriticalSection outputLock;
+    const auto batchStart = juce::Time::getMillisecondCounterHiRes();
+
+    // Workers push their progress without waiting on the console, this thread prints it
+    Telemetry telemetry(4096);
+    auto printProgress = [&]
+    {
+        telemetry.drain([&](const Telemetry::Record& record)
+        {
+            const juce::ScopedLock lock(outputLock);
+            std::cout << juce::String((record.milliseconds - batchStart) / 1000.0, 1).paddedLeft(' ', 7) << " s  "
+                      << record.getText() << std::endl;
+        });
+    };
+
+    // All created before any starts, so a worker that can't reach the server stops the
+    // batch before a file is touched
+    std::vector<std::unique_ptr<BatchWorker>> workers;
+    const int numWorkers = juce::jmin(options.numWorkers, static_cast<int>(entries.size()));
+    try
+    {
+        for (int i = 0; i < numWorkers; ++i)
+            workers.push_back(std::make_unique<BatchWorker>(i, ensemble, options, entries, nextEntry, outputLock, telemetry));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+
+    for (auto& worker : workers)
+        worker->startThread();
+
+    for (auto& worker : workers)
+        while (!worker->waitForThreadToExit(100))
+            printProgress();
+
+    printProgress();
+    if (telemetry.getNumDropped() > 0)
+        std::cout << telemetry.getNumDropped() << " progress messages dropped" << std::endl;
+
+    int numFailed = 0;
+    double totalAudioSeconds = 0.0;
+    double totalSdr = 0.0;
+    double totalSilentSeconds = 0.0;
+    double totalSegmentSeconds = 0.0;
+    for (const auto& entry : entries)
+    {
+        if (entry.succeeded)
+        {
+            totalAudioSeconds += entry.result.audioSeconds;
+            totalSdr += entry.meanSdr;
+            totalSilentSeconds += entry.result.silentSeconds;
+            totalSegmentSeconds += entry.result.segmentSeconds;
+        }
+        else
+        {
+            ++numFailed;
+        }
+    }
+
+    const auto batchSeconds = (juce::Time::getMillisecondCounterHiRes() - batchStart) / 1000.0;
+    const int numSucceeded = static_cast<int>(entries.size()) - numFailed;
+    std::cout << "Done: " << numSucceeded << " succeeded, " << numFailed << " failed"
+              << ", wall " << juce::String(batchSeconds, 1) << " s"
+              << ", RTF " << juce::String(totalAudioSeconds > 0.0 ? batchSeconds / totalAudioSeconds : 0.0, 3)
+              << ", peak resident " << ResourceUsage::formatBytes(ResourceUsage::getPeakResidentBytes())
+              << std::endl;
+
+    if (options.referenceRoot != juce::File() && numSucceeded > 0)
+        std::cout << "Mean SDR vs reference: " << juce::String(totalSdr / numSucceeded, 2) << " dB" << std::endl;
+
+    if (options.separatorOptions.skipSilence && totalSegmentSeconds > 0.0)
+        std::cout << "Silence skipped: " << juce::String(totalSilentSeconds, 1) << " of "
+                  << juce::String(totalSegmentSeconds, 1) << " s separated ("
+                  << juce::String(100.0 * totalSilentSeconds / totalSegmentSeconds, 1) << " % of inference)" << std::endl;
+
+    if (const auto& cache = options.separatorOptions.cache)
+    {
+        const auto stats = cache->getStats();
+        std::cout << "Cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+                  << stats.evictions << " evictions, " << ResourceUsage::formatBytes(stats.bytes)
+                  << " in " << cache->getDirectory().getFullPathName() << std::endl;
+    }
+
+    if (options.traceFile != juce::File())
+    {
+       #if DEMUCS_JUCE_TRACING
+        if (Trace::writeChromeTrace(options.traceFile))
+            std::cout << "Trace written to " << options.traceFile.getFullPathName() << std::endl;
+        else
+            std::cerr << "Error: could not write " << options.traceFile.getFullPathName() << std::endl;
+
+        std::cout << Trace::formatSummary(Trace::summarise());
+       #else
+        std::cerr << "Error: --trace needs a build with DEMUCS_JUCE_TRACING enabled" << std::endl;
+       #endif
+    }
+
+    return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,337 @@
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include "ChunkPlan.h"
+#include "ModelDownloader.h"
+#include "ModelLoader.h"
+#include "ResourceUsage.h"
+#include "StemSeparator.h"
+#include "ThreadTuner.h"
+
+// Counts operator new calls made by this executable. Eigen and juce::HeapBlock allocate
+// with malloc directly, so this undercounts; StemSeparator's scratch counter covers those.
+namespace
+{
+    std::atomic<juce::int64> numOperatorNewCalls { 0 };
+
+    void* countedAllocate(std::size_t size)
+    {
+        ++numOperatorNewCalls;
+        if (auto* ptr = std::malloc(size > 0 ? size : 1))
+            return ptr;
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace
+{
+    struct BenchOptions
+    {
+        juce::File modelFile { ModelDownloader::getDefaultModelFile() };
+        juce::File outputFile;
+        double audioSeconds { 60.0 };
+        double chunkSeconds { 30.0 };
+        int seed { 1 };
+        juce::Array<int> blasThreads { 1, 2, 4 };
+        juce::Array<int> chunkWorkers { 1, 2 };
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: demucs_bench [options]\n"
+                  << "\n"
+                  << "Runs offline, using a local model file and generated audio, and prints JSON.\n"
+                  << "\n"
+                  << "Options:\n"
+                  << "  --model <file>          Model file (default: " << ModelDownloader::getDefaultModelFile().getFullPathName() << ")\n"
+                  << "  --seconds <s>           Length of the synthetic input (default: 60)\n"
+                  << "  --chunk-seconds <s>     Segment length for per-segment timing (default: 30)\n"
+                  << "  --threads <a,b,...>     OpenBLAS thread counts to sweep (default: 1,2,4)\n"
+                  << "  --workers <a,b,...>     Chunk worker counts to sweep end-to-end (default: 1,2)\n"
+                  << "  --seed <n>              Seed for the synthetic audio (default: 1)\n"
+                  << "  --output <file>         Write JSON here instead of stdout\n";
+    }
+
+    juce::Array<int> parseIntList(const juce::String& text)
+    {
+        juce::Array<int> values;
+        for (const auto& token : juce::StringArray::fromTokens(text, ",", {}))
+            if (token.trim().getIntValue() > 0)
+                values.add(token.trim().getIntValue());
+
+        if (values.isEmpty())
+            throw std::runtime_error("Expected a comma separated list of positive integers: " + text.toStdString());
+
+        return values;
+    }
+
+    BenchOptions parseArguments(const juce::ArgumentList& args)
+    {
+        BenchOptions options;
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+
+            auto nextValue = [&]() -> juce::String
+            {
+                if (i + 1 >= args.size())
+                    throw std::runtime_error("Missing value for " + arg.text.toStdString());
+                return args[++i].text;
+            };
+
+            if (arg == "--model")
+                options.modelFile = juce::File::getCurrentWorkingDirectory().getChildFile(nextValue().unquoted());
+            else if (arg == "--output")
+                options.outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(nextValue().unquoted());
+            else if (arg == "--seconds")
+                options.audioSeconds = nextValue().getDoubleValue();
+            else if (arg == "--chunk-seconds")
+                options.chunkSeconds = nextValue().getDoubleValue();
+            else if (arg == "--threads")
+                options.blasThreads = parseIntList(nextValue());
+            else if (arg == "--workers")
+                options.chunkWorkers = parseIntList(nextValue());
+            else if (arg == "--seed")
+                options.seed = nextValue().getIntValue();
+            else
+                throw std::runtime_error("Unknown option: " + arg.text.toStdString());
+        }
+
+        if (options.audioSeconds <= 0.0 || options.chunkSeconds <= 0.0)
+            throw std::runtime_error("--seconds and --chunk-seconds must be positive");
+
+        return options;
+    }
+
+    // Deterministic stereo test signal: detuned harmonic tones, a kick-like pulse train
+    // and a noise layer, so every stem of the model has something to do
+    juce::AudioBuffer<float> createSyntheticAudio(double seconds, int seed)
+    {
+        const int numSamples = juce::roundToInt(seconds * StemSeparator::kSampleRate);
+        juce::AudioBuffer<float> audio(StemSeparator::kNumChannels, numSamples);
+        juce::Random random(seed);
+
+        const double sampleRate = StemSeparator::kSampleRate;
+        const double beatSamples = sampleRate * 60.0 / 120.0;
+
+        for (int ch = 0; ch < audio.getNumChannels(); ++ch)
+        {
+            float* data = audio.getWritePointer(ch);
+            const double detune = 1.0 + 0.002 * ch;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const double t = i / sampleRate;
+                const double beatPhase = std::fmod(static_cast<double>(i), beatSamples) / sampleRate;
+
+                double sample = 0.0;
+                for (int harmonic = 1; harmonic <= 4; ++harmonic)
+                    sample += 0.08 / harmonic * std::sin(juce::MathConstants<double>::twoPi * 110.0 * detune * harmonic * t);
+
+                sample += 0.5 * std::exp(-beatPhase * 30.0) * std::sin(juce::MathConstants<double>::twoPi * 55.0 * beatPhase);
+                sample += 0.05 * (random.nextFloat() * 2.0f - 1.0f);
+
+                data[i] = static_cast<float>(sample);
+            }
+        }
+
+        return audio;
+    }
+
+    juce::var runSegments(const demucscpp::demucs_model& model, const juce::AudioBuffer<float>& audio, double chunkSeconds)
+    {
+        const ChunkPlan plan(audio.getNumSamples(), juce::roundToInt(chunkSeconds * StemSeparator::kSampleRate), 0);
+
+        juce::Array<juce::var> segments;
+        std::map<juce::String, double> stageSeconds;
+        double totalSeconds = 0.0;
+
+        for (int index = 0; index < plan.getNumChunks(); ++index)
+        {
+            const auto chunk = plan.getChunk(index);
+
+            Eigen::MatrixXf audioData(StemSeparator::kNumChannels, chunk.length);
+            for (int ch = 0; ch < StemSeparator::kNumChannels; ++ch)
+                for (int i = 0; i < chunk.length; ++i)
+                    audioData(ch, i) = audio.getSample(ch, static_cast<int>(chunk.start) + i);
+
+            // demucs reports each layer group through the progress callback, so the time
+            // between two callbacks is attributed to the group named by the earlier one
+            juce::String currentStage { "setup" };
+            auto stageStart = juce::Time::getMillisecondCounterHiRes();
+            const auto segmentStart = stageStart;
+
+            demucscpp::demucs_inference(model, audioData,
+                [&](float, const std::string& message) {
+                    const auto now = juce::Time::getMillisecondCounterHiRes();
+                    stageSeconds[currentStage] += (now - stageStart) / 1000.0;
+                    currentStage = juce::String(message).removeCharacters("0123456789").trim()
+                                       .toLowerCase().replaceCharacter(' ', '_');
+                    stageStart = now;
+                });
+
+            const auto segmentEnd = juce::Time::getMillisecondCounterHiRes();
+            stageSeconds[currentStage] += (segmentEnd - stageStart) / 1000.0;
+
+            const double seconds = (segmentEnd - segmentStart) / 1000.0;
+            totalSeconds += seconds;
+
+            auto* segment = new juce::DynamicObject();
+            segment->setProperty("index", index);
+            segment->setProperty("audio_seconds", chunk.length / StemSeparator::kSampleRate);
+            segment->setProperty("seconds", seconds);
+            segment->setProperty("rtf", seconds / (chunk.length / StemSeparator::kSampleRate));
+            segments.add(juce::var(segment));
+        }
+
+        auto* stages = new juce::DynamicObject();
+        for (const auto& [name, seconds] : stageSeconds)
+            stages->setProperty(name.isEmpty() ? "unnamed" : name, seconds);
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("segments", segments);
+        result->setProperty("stage_seconds", juce::var(stages));
+        result->setProperty("seconds", totalSeconds);
+        result->setProperty("rtf", totalSeconds / (audio.getNumSamples() / StemSeparator::kSampleRate));
+        return juce::var(result);
+    }
+
+    juce::var runEndToEnd(StemSeparator& separator, const juce::File& inputFile, const juce::File& outputDirectory,
+                          double chunkSeconds, int chunkWorkers)
+    {
+        StemSeparator::Options options;
+        options.streaming = true;
+        options.chunkSeconds = chunkSeconds;
+        options.numChunkWorkers = chunkWorkers;
+        separator.setOptions(options);
+
+        const auto newCallsBefore = numOperatorNewCalls.load();
+        const auto result = separator.process(inputFile, outputDirectory);
+
+        auto* run = new juce::DynamicObject();
+        run->setProperty("chunk_workers", chunkWorkers);
+        run->setProperty("seconds", result.wallSeconds);
+        run->setProperty("rtf", result.getRealtimeFactor());
+        run->setProperty("scratch_allocations", result.scratchAllocations);
+        run->setProperty("operator_new_calls", numOperatorNewCalls.load() - newCallsBefore);
+        run->setProperty("peak_resident_bytes", ResourceUsage::getPeakResidentBytes());
+        return juce::var(run);
+    }
+
+    void writeWav(const juce::File& file, const juce::AudioBuffer<float>& audio)
+    {
+        file.deleteFile();
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::AudioFormatWriter> writer(
+            wavFormat.createWriterFor(new juce::FileOutputStream(file),
+                                      StemSeparator::kSampleRate, (unsigned int) audio.getNumChannels(), 32, {}, 0));
+
+        if (!writer || !writer->writeFromAudioSampleBuffer(audio, 0, audio.getNumSamples()))
+            throw std::runtime_error("Could not write " + file.getFullPathName().toStdString());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    const auto workDir = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                             .getNonexistentChildFile("demucs_bench", {});
+
+    try
+    {
+        const auto options = parseArguments(args);
+
+        auto* machine = new juce::DynamicObject();
+        machine->setProperty("cpu", juce::SystemStats::getCpuModel());
+        machine->setProperty("physical_cores", juce::SystemStats::getNumPhysicalCpus());
+        machine->setProperty("logical_cores", juce::SystemStats::getNumCpus());
+        machine->setProperty("os", juce::SystemStats::getOperatingSystemName());
+
+        auto* config = new juce::DynamicObject();
+        config->setProperty("model", options.modelFile.getFullPathName());
+        config->setProperty("audio_seconds", options.audioSeconds);
+        config->setProperty("chunk_seconds", options.chunkSeconds);
+        config->setProperty("seed", options.seed);
+
+        ModelLoader::Stats loadStats;
+        auto model = ModelLoader::load(options.modelFile, &loadStats);
+
+        auto* load = new juce::DynamicObject();
+        load->setProperty("seconds", loadStats.loadSeconds);
+        load->setProperty("file_bytes", loadStats.fileBytes);
+        load->setProperty("resident_bytes_added", loadStats.getResidentBytesAdded());
+
+        const auto audio = createSyntheticAudio(options.audioSeconds, options.seed);
+        workDir.createDirectory();
+        const auto inputFile = workDir.getChildFile("synthetic.wav");
+        writeWav(inputFile, audio);
+
+        StemSeparator separator(*model);
+        juce::Array<juce::var> runs;
+
+        for (auto threads : options.blasThreads)
+        {
+            ThreadTuner::setBlasThreads(threads);
+            std::cerr << "blas_threads " << threads << std::endl;
+
+            auto* run = new juce::DynamicObject();
+            run->setProperty("blas_threads", threads);
+            run->setProperty("inference", runSegments(*model, audio, options.chunkSeconds));
+
+            juce::Array<juce::var> endToEnd;
+            for (auto workers : options.chunkWorkers)
+                endToEnd.add(runEndToEnd(separator, inputFile, workDir.getChildFile("stems"), options.chunkSeconds, workers));
+
+            run->setProperty("end_to_end", endToEnd);
+            runs.add(juce::var(run));
+        }
+
+        auto* report = new juce::DynamicObject();
+        report->setProperty("benchmark", "demucs_bench");
+        report->setProperty("format_version", 1);
+        report->setProperty("machine", juce::var(machine));
+        report->setProperty("config", juce::var(config));
+        report->setProperty("model_load", juce::var(load));
+        report->setProperty("runs", runs);
+        report->setProperty("peak_resident_bytes", ResourceUsage::getPeakResidentBytes());
+
+        const auto json = juce::JSON::toString(juce::var(report));
+
+        if (options.outputFile != juce::File())
+        {
+            if (!options.outputFile.replaceWithText(json))
+                throw std::runtime_error("Could not write " + options.outputFile.getFullPathName().toStdString());
+        }
+        else
+        {
+            std::cout << json << std::endl;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        workDir.deleteRecursively();
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    workDir.deleteRecursively();
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "ChunkArena.h"
+
+void ChunkArena::prepare(int numWorkers, int numChannels, int chunkSamples, size_t halfBlockValues, int numHalfBlocks)
+{
+    mNumChannels = numChannels;
+    mChunkSamples = chunkSamples;
+
+    while (mWorkers.size() < numWorkers)
+    {
+        mWorkers.add(new WorkerBuffers());
+        ++mNumAllocations;
+    }
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        getInputBuffer(i, chunkSamples);
+        resizeMatrix(mWorkers[i]->audio, numChannels, chunkSamples);
+    }
+
+    const std::lock_guard<std::mutex> lock(mHalfBlockLock);
+
+    if (halfBlockValues > mHalfBlockValues)
+    {
+        mHalfBlocks.clear();
+        mHalfBlockValues = halfBlockValues;
+    }
+
+    while (mHalfBlocks.size() < numHalfBlocks)
+    {
+        mHalfBlocks.add(new juce::HeapBlock<juce::uint16>(mHalfBlockValues));
+        ++mNumAllocations;
+    }
+
+    if (mFreeHalfBlocks.capacity() < (size_t) mHalfBlocks.size())
+    {
+        mFreeHalfBlocks.reserve((size_t) mHalfBlocks.size());
+        ++mNumAllocations;
+    }
+
+    mFreeHalfBlocks.clear();
+    for (auto* block : mHalfBlocks)
+        mFreeHalfBlocks.push_back(block->get());
+}
+
+juce::AudioBuffer<float>& ChunkArena::getInputBuffer(int worker, int numSamples)
+{
+    auto& buffers = *mWorkers[worker];
+
+    if (buffers.input.getNumChannels() != mNumChannels || numSamples > buffers.inputCapacity)
+    {
+        buffers.inputCapacity = juce::jmax(buffers.inputCapacity, numSamples);
+        ++mNumAllocations;
+    }
+
+    // avoidReallocating keeps the larger allocation when a shorter chunk comes along
+    buffers.input.setSize(mNumChannels, numSamples, false, false, true);
+    return buffers.input;
+}
+
+Eigen::MatrixXf& ChunkArena::getAudioMatrix(int worker, int numSamples)
+{
+    auto& buffers = *mWorkers[worker];
+    auto& matrix = numSamples == mChunkSamples ? buffers.audio : buffers.partialAudio;
+    resizeMatrix(matrix, mNumChannels, numSamples);
+    return matrix;
+}
+
+void ChunkArena::resizeMatrix(Eigen::MatrixXf& matrix, int numChannels, int numSamples)
+{
+    if (matrix.rows() == numChannels && matrix.cols() == numSamples)
+        return;
+
+    matrix.resize(numChannels, numSamples);
+    ++mNumAllocations;
+}
+
+juce::uint16* ChunkArena::acquireHalfBlock()
+{
+    const std::lock_guard<std::mutex> lock(mHalfBlockLock);
+    if (mFreeHalfBlocks.empty())
+        return nullptr;
+
+    auto* block = mFreeHalfBlocks.back();
+    mFreeHalfBlocks.pop_back();
+    return block;
+}
+
+void ChunkArena::releaseHalfBlock(juce::uint16* block)
+{
+    if (block == nullptr)
+        return;
+
+    const std::lock_guard<std::mutex> lock(mHalfBlockLock);
+    mFreeHalfBlocks.push_back(block);
+}
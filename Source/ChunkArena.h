@@ -0,0 +1,58 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <mutex>
+#include <vector>
+#include "model.hpp"
+
+// Owns every app-side intermediate of chunked separation: each worker's decode buffer
+// and Eigen input matrix, plus the FP16 blocks that hold chunks waiting to be stitched.
+// It is sized from the chunk plan and kept by the StemSeparator, so later chunks and
+// later files reuse the same memory. getNumAllocations() counts every time the arena
+// had to grow; once warmed up for a chunk length it stays flat. Allocations made inside
+// demucs_inference itself are not covered.
+class ChunkArena
+{
+public:
+    struct WorkerBuffers
+    {
+        juce::AudioBuffer<float> input;
+        Eigen::MatrixXf audio;
+        Eigen::MatrixXf partialAudio;
+        int inputCapacity { 0 };
+    };
+
+    void prepare(int numWorkers, int numChannels, int chunkSamples, size_t halfBlockValues, int numHalfBlocks);
+
+    WorkerBuffers& getWorker(int index) { return *mWorkers[index]; }
+
+    // Decode buffer and Eigen matrix for numSamples of audio. Chunks shorter than the
+    // prepared length (the last one of a file) use a separate matrix so the full-size
+    // one is never reallocated.
+    juce::AudioBuffer<float>& getInputBuffer(int worker, int numSamples);
+    Eigen::MatrixXf& getAudioMatrix(int worker, int numSamples);
+
+    // Thread safe. Blocks are halfBlockValues long; returns nullptr if they're all in use.
+    juce::uint16* acquireHalfBlock();
+    void releaseHalfBlock(juce::uint16* block);
+
+    // Frees the decode buffers and matrices, keeping the FP16 blocks. For buffers sized to
+    // something other than a chunk, a whole file, which shouldn't be kept around.
+    void releaseWorkerBuffers() { mWorkers.clear(); }
+
+    juce::int64 getNumAllocations() const { return mNumAllocations.load(); }
+
+private:
+    void resizeMatrix(Eigen::MatrixXf& matrix, int numChannels, int numSamples);
+
+    juce::OwnedArray<WorkerBuffers> mWorkers;
+    int mNumChannels { 0 };
+    int mChunkSamples { 0 };
+
+    std::mutex mHalfBlockLock;
+    juce::OwnedArray<juce::HeapBlock<juce::uint16>> mHalfBlocks;
+    size_t mHalfBlockValues { 0 };
+    std::vector<juce::uint16*> mFreeHalfBlocks;
+
+    std::atomic<juce::int64> mNumAllocations { 0 };
+};
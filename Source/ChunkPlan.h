@@ -0,0 +1,57 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Splits a track into fixed-size chunks that overlap by a few seconds. Each chunk is
+// separated on its own and neighbouring chunks are crossfaded over the overlap, so
+// memory depends on the chunk length rather than the track length.
+class ChunkPlan
+{
+public:
+    struct Chunk
+    {
+        int index { 0 };
+        juce::int64 start { 0 };
+        int length { 0 };
+        int overlapWithPrevious { 0 };
+        int overlapWithNext { 0 };
+    };
+
+    ChunkPlan(juce::int64 totalSamples, int chunkSamples, int overlapSamples)
+        : mTotalSamples(totalSamples),
+          mChunkSamples(chunkSamples),
+          mOverlapSamples(juce::jlimit(0, chunkSamples / 2, overlapSamples))
+    {
+        jassert(chunkSamples > 0);
+
+        const auto hop = static_cast<juce::int64>(mChunkSamples - mOverlapSamples);
+        if (mTotalSamples <= mChunkSamples)
+            mNumChunks = 1;
+        else
+            mNumChunks = static_cast<int>((mTotalSamples - mOverlapSamples + hop - 1) / hop);
+    }
+
+    int getNumChunks() const { return mNumChunks; }
+    int getChunkSamples() const { return mChunkSamples; }
+    int getOverlapSamples() const { return mOverlapSamples; }
+    juce::int64 getTotalSamples() const { return mTotalSamples; }
+
+    Chunk getChunk(int index) const
+    {
+        jassert(juce::isPositiveAndBelow(index, mNumChunks));
+
+        Chunk chunk;
+        chunk.index = index;
+        chunk.start = static_cast<juce::int64>(index) * (mChunkSamples - mOverlapSamples);
+        chunk.length = static_cast<int>(juce::jmin(static_cast<juce::int64>(mChunkSamples), mTotalSamples - chunk.start));
+        chunk.overlapWithPrevious = index > 0 ? mOverlapSamples : 0;
+        chunk.overlapWithNext = index < mNumChunks - 1 ? mOverlapSamples : 0;
+        return chunk;
+    }
+
+private:
+    juce::int64 mTotalSamples;
+    int mChunkSamples;
+    int mOverlapSamples;
+    int mNumChunks { 0 };
+};
@@ -0,0 +1,124 @@
+#include "ChunkScheduler.h"
+#include "HalfFloat.h"
+
+ChunkScheduler::ChunkScheduler(int numChunks, int maxAhead, ChunkArena* halfPrecisionStorage)
+    : mNumChunks(numChunks),
+      mMaxAhead(juce::jmax(1, maxAhead)),
+      mHalfPrecisionStorage(halfPrecisionStorage),
+      mResults((size_t) numChunks),
+      mDone((size_t) numChunks, 0),
+      mChunkProgress((size_t) numChunks, 0.0f)
+{
+}
+
+bool ChunkScheduler::claim(int& index)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    mChanged.wait(lock, [this] {
+        return mAborted || mError != nullptr
+            || mNextToClaim >= mNumChunks
+            || mNextToClaim < mNextToTake + mMaxAhead;
+    });
+
+    if (mAborted || mError != nullptr || mNextToClaim >= mNumChunks)
+        return false;
+
+    index = mNextToClaim++;
+    return true;
+}
+
+void ChunkScheduler::complete(int index, Eigen::Tensor3dXf&& stems)
+{
+    PendingChunk pending;
+
+    if (mHalfPrecisionStorage != nullptr)
+        pending.halfStems = mHalfPrecisionStorage->acquireHalfBlock();
+
+    if (pending.halfStems != nullptr)
+    {
+        for (int i = 0; i < 3; ++i)
+            pending.dimensions[i] = stems.dimension(i);
+
+        HalfFloat::fromFloat(stems.data(), pending.halfStems, static_cast<size_t>(stems.size()));
+    }
+    else
+    {
+        pending.stems = std::move(stems);
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(mLock);
+        mResults[(size_t) index] = std::move(pending);
+        mDone[(size_t) index] = 1;
+    }
+    mChanged.notify_all();
+}
+
+void ChunkScheduler::fail(std::exception_ptr error)
+{
+    {
+        const std::lock_guard<std::mutex> lock(mLock);
+        if (mError == nullptr)
+            mError = error;
+    }
+    mChanged.notify_all();
+}
+
+float ChunkScheduler::setChunkProgress(int index, float progress)
+{
+    const std::lock_guard<std::mutex> lock(mLock);
+    mChunkProgress[(size_t) index] = juce::jlimit(0.0f, 1.0f, progress);
+
+    float sum = 0.0f;
+    for (auto p : mChunkProgress)
+        sum += p;
+
+    mProgress = juce::jmax(mProgress, sum / static_cast<float>(mNumChunks));
+    return mProgress;
+}
+
+bool ChunkScheduler::takeNext(Eigen::Tensor3dXf& stems)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    if (mNextToTake >= mNumChunks)
+        return false;
+
+    mChanged.wait(lock, [this] {
+        return mAborted || mError != nullptr || mDone[(size_t) mNextToTake] != 0;
+    });
+
+    if (mError != nullptr)
+        std::rethrow_exception(mError);
+
+    if (mAborted)
+        return false;
+
+    auto pending = std::move(mResults[(size_t) mNextToTake]);
+    mResults[(size_t) mNextToTake] = PendingChunk();
+    ++mNextToTake;
+
+    lock.unlock();
+    mChanged.notify_all();
+
+    if (pending.halfStems != nullptr)
+    {
+        stems.resize(pending.dimensions[0], pending.dimensions[1], pending.dimensions[2]);
+        HalfFloat::toFloat(pending.halfStems, stems.data(), static_cast<size_t>(stems.size()));
+        mHalfPrecisionStorage->releaseHalfBlock(pending.halfStems);
+    }
+    else
+    {
+        stems = std::move(pending.stems);
+    }
+
+    return true;
+}
+
+void ChunkScheduler::abort()
+{
+    {
+        const std::lock_guard<std::mutex> lock(mLock);
+        mAborted = true;
+    }
+    mChanged.notify_all();
+}
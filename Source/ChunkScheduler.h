@@ -0,0 +1,59 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <vector>
+#include "ChunkArena.h"
+#include "model.hpp"
+
+// Hands the chunks of one file out to worker threads and gives their results back to a
+// single consumer strictly in chunk order. Idle workers take the next unclaimed chunk,
+// but never more than maxAhead chunks ahead of the consumer, which keeps the number of
+// separated-but-not-yet-stitched chunks bounded. Given an arena with FP16 blocks, the
+// waiting chunks are kept in those, which halves that memory at the precision given in
+// HalfFloat.h.
+class ChunkScheduler
+{
+public:
+    ChunkScheduler(int numChunks, int maxAhead, ChunkArena* halfPrecisionStorage = nullptr);
+
+    // Worker side. claim() blocks while the workers are too far ahead and returns false
+    // once every chunk has been claimed or the run was aborted.
+    bool claim(int& index);
+    void complete(int index, Eigen::Tensor3dXf&& stems);
+    void fail(std::exception_ptr error);
+
+    // Records progress of one chunk and returns the overall progress, which never decreases
+    float setChunkProgress(int index, float progress);
+
+    // Consumer side. Blocks until the next chunk in order is done, rethrows a worker failure.
+    bool takeNext(Eigen::Tensor3dXf& stems);
+    void abort();
+
+private:
+    struct PendingChunk
+    {
+        Eigen::Tensor3dXf stems;
+        juce::uint16* halfStems { nullptr };
+        Eigen::Index dimensions[3] {};
+    };
+
+    const int mNumChunks;
+    const int mMaxAhead;
+    ChunkArena* const mHalfPrecisionStorage;
+
+    std::mutex mLock;
+    std::condition_variable mChanged;
+
+    int mNextToClaim { 0 };
+    int mNextToTake { 0 };
+    bool mAborted { false };
+    std::exception_ptr mError;
+
+    std::vector<PendingChunk> mResults;
+    std::vector<char> mDone;
+    std::vector<float> mChunkProgress;
+    float mProgress { 0.0f };
+};
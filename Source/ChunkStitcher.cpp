@@ -0,0 +1,75 @@
+#include "ChunkStitcher.h"
+#include "StemTensor.h"
+
+void ChunkStitcher::prepare(int numStems, int numChannels, const ChunkPlan& plan)
+{
+    const bool layoutChanged = numStems != mNumStems || numChannels != mNumChannels;
+    mNumStems = numStems;
+    mNumChannels = numChannels;
+    mOverlapSamples = plan.getOverlapSamples();
+
+    // Linear crossfade, fade in and fade out always sum to one
+    if (mOverlapSamples != mFadeLength)
+    {
+        mFadeIn.allocate((size_t) juce::jmax(1, mOverlapSamples), false);
+        mFadeOut.allocate((size_t) juce::jmax(1, mOverlapSamples), false);
+        for (int i = 0; i < mOverlapSamples; ++i)
+        {
+            mFadeIn[i] = (static_cast<float>(i) + 0.5f) / static_cast<float>(mOverlapSamples);
+            mFadeOut[i] = 1.0f - mFadeIn[i];
+        }
+
+        mFadeLength = mOverlapSamples;
+        mNumAllocations += 2;
+    }
+
+    if (layoutChanged || plan.getChunkSamples() > mBlockCapacity)
+    {
+        mBlockCapacity = juce::jmax(mBlockCapacity, plan.getChunkSamples());
+        ++mNumAllocations;
+    }
+
+    if (layoutChanged || mOverlapSamples > mTailCapacity)
+    {
+        mTailCapacity = juce::jmax(mTailCapacity, juce::jmax(1, mOverlapSamples));
+        ++mNumAllocations;
+    }
+
+    mBlock.setSize(numStems * numChannels, mBlockCapacity, false, false, true);
+    mTail.setSize(numStems * numChannels, mTailCapacity, false, true, true);
+}
+
+void ChunkStitcher::push(const ChunkPlan::Chunk& chunk, const Eigen::Tensor3dXf& stems, const BlockCallback& onBlock)
+{
+    using FVO = juce::FloatVectorOperations;
+
+    jassert(StemTensor::getNumSamples(stems) == chunk.length);
+
+    const int numOutput = chunk.length - chunk.overlapWithNext;
+    const int numFaded = chunk.overlapWithPrevious;
+
+    for (int stem = 0; stem < mNumStems; ++stem)
+    {
+        for (int ch = 0; ch < mNumChannels; ++ch)
+        {
+            const int channel = stem * mNumChannels + ch;
+            const float* source = StemTensor::getChannel(stems, stem, ch);
+            float* block = mBlock.getWritePointer(channel);
+            float* tail = mTail.getWritePointer(channel);
+
+            if (numFaded > 0)
+            {
+                FVO::multiply(block, source, mFadeIn.get(), numFaded);
+                FVO::addWithMultiply(block, tail, mFadeOut.get(), numFaded);
+            }
+
+            FVO::copy(block + numFaded, source + numFaded, numOutput - numFaded);
+
+            if (chunk.overlapWithNext > 0)
+                FVO::copy(tail, source + numOutput, chunk.overlapWithNext);
+        }
+    }
+
+    if (numOutput > 0)
+        onBlock(mBlock, numOutput);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include "ChunkPlan.h"
+#include "model.hpp"
+
+// Crossfades separated chunks back into one continuous stream of stems. Chunks have to
+// be pushed in order; every push emits the samples that can no longer change, with
+// stem s / channel c in block channel s * 2 + c, and keeps the overlapping tail until
+// the next chunk arrives.
+class ChunkStitcher
+{
+public:
+    using BlockCallback = std::function<void(const juce::AudioBuffer<float>& block, int numSamples)>;
+
+    void prepare(int numStems, int numChannels, const ChunkPlan& plan);
+    void push(const ChunkPlan::Chunk& chunk, const Eigen::Tensor3dXf& stems, const BlockCallback& onBlock);
+
+    // Number of times prepare() had to grow a buffer
+    juce::int64 getNumAllocations() const { return mNumAllocations; }
+
+private:
+    int mNumStems { 0 };
+    int mNumChannels { 0 };
+    int mOverlapSamples { 0 };
+
+    // Crossfade tables, rebuilt only when the overlap length changes
+    juce::HeapBlock<float> mFadeIn;
+    juce::HeapBlock<float> mFadeOut;
+    int mFadeLength { -1 };
+    int mBlockCapacity { 0 };
+    int mTailCapacity { 0 };
+    juce::int64 mNumAllocations { 0 };
+    juce::AudioBuffer<float> mBlock;
+    juce::AudioBuffer<float> mTail;
+};
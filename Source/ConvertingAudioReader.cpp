@@ -0,0 +1,105 @@
+#include "ConvertingAudioReader.h"
+#include "Trace.h"
+
+namespace
+{
+    constexpr float kMinus3dB = 0.70710678f;
+
+    std::array<float, 2> getDownmixGains(juce::AudioChannelSet::ChannelType type)
+    {
+        using Set = juce::AudioChannelSet;
+        switch (type)
+        {
+            case Set::left:
+                return { 1.0f, 0.0f };
+            case Set::right:
+                return { 0.0f, 1.0f };
+            case Set::leftSurround:
+            case Set::leftSurroundSide:
+            case Set::leftSurroundRear:
+            case Set::leftCentre:
+            case Set::wideLeft:
+                return { kMinus3dB, 0.0f };
+            case Set::rightSurround:
+            case Set::rightSurroundSide:
+            case Set::rightSurroundRear:
+            case Set::rightCentre:
+            case Set::wideRight:
+                return { 0.0f, kMinus3dB };
+            case Set::LFE:
+            case Set::LFE2:
+                return { 0.0f, 0.0f };
+            case Set::centre:
+            case Set::centreSurround:
+            default:
+                return { kMinus3dB, kMinus3dB };
+        }
+    }
+}
+
+ConvertingAudioReader::ConvertingAudioReader(std::unique_ptr<juce::AudioFormatReader> source, double targetRate)
+    : AudioFormatReader(nullptr, source->getFormatName()),
+      mSource(std::move(source)),
+      mResampler(mSource->sampleRate, targetRate)
+{
+    sampleRate = targetRate;
+    numChannels = 2;
+    bitsPerSample = 32;
+    usesFloatingPointData = true;
+    lengthInSamples = mResampler.getOutputLength(mSource->lengthInSamples);
+    metadataValues = mSource->metadataValues;
+
+    if (mSource->numChannels > 2)
+    {
+        const auto layout = mSource->getChannelLayout();
+        for (int ch = 0; ch < static_cast<int>(mSource->numChannels); ++ch)
+            mDownmixGains.push_back(getDownmixGains(layout.getTypeOfChannel(ch)));
+    }
+}
+
+bool ConvertingAudioReader::needsConversion(const juce::AudioFormatReader& source, double targetRate)
+{
+    return source.sampleRate != targetRate || source.numChannels != 2;
+}
+
+bool ConvertingAudioReader::readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                                        juce::int64 startSampleInFile, int numSamples)
+{
+    // Source samples outside the file read as silence, which is what the filter expects there
+    const auto range = mResampler.getInputRange(startSampleInFile, numSamples);
+    const auto numSourceSamples = static_cast<int>(range.getLength());
+    mStereoBuffer.setSize(2, numSourceSamples, false, false, true);
+
+    if (mDownmixGains.empty())
+    {
+        // A stereo buffer gets mono sources on both channels
+        mSource->read(&mStereoBuffer, 0, numSourceSamples, range.getStart(), true, true);
+    }
+    else
+    {
+        mSourceBuffer.setSize(static_cast<int>(mSource->numChannels), numSourceSamples, false, false, true);
+        mSource->read(&mSourceBuffer, 0, numSourceSamples, range.getStart(), true, true);
+
+        DEMUCS_TRACE_SCOPE("downmix");
+        mStereoBuffer.clear();
+        for (int ch = 0; ch < mSourceBuffer.getNumChannels(); ++ch)
+            for (int side = 0; side < 2; ++side)
+                if (const float gain = mDownmixGains[(size_t) ch][(size_t) side]; gain != 0.0f)
+                    mStereoBuffer.addFrom(side, 0, mSourceBuffer, ch, 0, numSourceSamples, gain);
+    }
+
+    DEMUCS_TRACE_SCOPE("resample");
+    for (int ch = 0; ch < numDestChannels; ++ch)
+    {
+        if (destChannels[ch] == nullptr)
+            continue;
+
+        auto* dest = reinterpret_cast<float*>(destChannels[ch]) + startOffsetInDestBuffer;
+        if (ch < 2)
+            mResampler.process(mStereoBuffer.getReadPointer(ch), range.getStart(), dest, startSampleInFile, numSamples);
+        else
+            juce::FloatVectorOperations::clear(dest, numSamples);
+    }
+
+    return true;
+}
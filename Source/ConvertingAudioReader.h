@@ -0,0 +1,37 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <memory>
+#include <vector>
+#include "PolyphaseResampler.h"
+
+// Presents any readable file as the float stereo stream demucs expects, at targetRate.
+// Mono is copied to both sides and surround layouts are folded down (centre and
+// surrounds at -3 dB, LFE dropped); other sample rates go through a PolyphaseResampler.
+// Reads can start anywhere and only decode the source range they need, so chunked
+// separation streams through a converted file just like through a native one.
+class ConvertingAudioReader : public juce::AudioFormatReader
+{
+public:
+    ConvertingAudioReader(std::unique_ptr<juce::AudioFormatReader> source, double targetRate);
+
+    static bool needsConversion(const juce::AudioFormatReader& source, double targetRate);
+
+    const juce::AudioFormatReader& getSource() const { return *mSource; }
+
+    bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                     juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+    std::unique_ptr<juce::AudioFormatReader> mSource;
+    PolyphaseResampler mResampler;
+
+    // Left/right gain of every source channel, empty when the source is mono or stereo
+    std::vector<std::array<float, 2>> mDownmixGains;
+
+    juce::AudioBuffer<float> mSourceBuffer;
+    juce::AudioBuffer<float> mStereoBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ConvertingAudioReader)
+};
@@ -0,0 +1,176 @@
+#include "HalfFloat.h"
+#include <cstring>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #endif
+#endif
+
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+ #define DEMUCS_F16C_TARGET __attribute__((target("avx,f16c")))
+#else
+ #define DEMUCS_F16C_TARGET
+#endif
+
+namespace
+{
+   #if JUCE_INTEL
+    bool detectF16C()
+    {
+       #if JUCE_MSVC
+        int info[4] {};
+        __cpuid(info, 1);
+        return (info[2] & (1 << 29)) != 0 && juce::SystemStats::hasAVX();
+       #else
+        return __builtin_cpu_supports("f16c") && juce::SystemStats::hasAVX();
+       #endif
+    }
+
+    DEMUCS_F16C_TARGET void fromFloatF16C(const float* source, juce::uint16* dest, size_t numValues)
+    {
+        size_t i = 0;
+        for (; i + 8 <= numValues; i += 8)
+        {
+            const auto half = _mm256_cvtps_ph(_mm256_loadu_ps(source + i), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), half);
+        }
+
+        for (; i < numValues; ++i)
+            dest[i] = HalfFloat::fromFloat(source[i]);
+    }
+
+    DEMUCS_F16C_TARGET void toFloatF16C(const juce::uint16* source, float* dest, size_t numValues)
+    {
+        size_t i = 0;
+        for (; i + 8 <= numValues; i += 8)
+        {
+            const auto half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+            _mm256_storeu_ps(dest + i, _mm256_cvtph_ps(half));
+        }
+
+        for (; i < numValues; ++i)
+            dest[i] = HalfFloat::toFloat(source[i]);
+    }
+   #endif
+}
+
+juce::uint16 HalfFloat::fromFloat(float value)
+{
+    juce::uint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const auto sign = static_cast<juce::uint32>((bits >> 16) & 0x8000);
+    const auto floatExponent = static_cast<int>((bits >> 23) & 0xff);
+    juce::uint32 mantissa = bits & 0x007fffff;
+
+    // Inf and NaN, keeping NaNs quiet
+    if (floatExponent == 0xff)
+        return static_cast<juce::uint16>(sign | 0x7c00 | (mantissa != 0 ? 0x0200 | (mantissa >> 13) : 0));
+
+    const int exponent = floatExponent - 127 + 15;
+
+    if (exponent >= 0x1f)
+        return static_cast<juce::uint16>(sign | 0x7c00);
+
+    if (exponent <= 0)
+    {
+        // Subnormal half, or zero if it's below half of the smallest subnormal
+        if (exponent < -10)
+            return static_cast<juce::uint16>(sign);
+
+        mantissa |= 0x00800000;
+        const int shift = 14 - exponent;
+        juce::uint32 half = mantissa >> shift;
+        const juce::uint32 remainder = mantissa & ((1u << shift) - 1);
+        const juce::uint32 halfway = 1u << (shift - 1);
+
+        if (remainder > halfway || (remainder == halfway && (half & 1) != 0))
+            ++half;
+
+        return static_cast<juce::uint16>(sign | half);
+    }
+
+    // A carry out of the mantissa correctly bumps the exponent, up to infinity
+    juce::uint32 half = (static_cast<juce::uint32>(exponent) << 10) | (mantissa >> 13);
+    const juce::uint32 remainder = mantissa & 0x1fff;
+
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1) != 0))
+        ++half;
+
+    return static_cast<juce::uint16>(sign | half);
+}
+
+float HalfFloat::toFloat(juce::uint16 value)
+{
+    const juce::uint32 sign = static_cast<juce::uint32>(value & 0x8000) << 16;
+    int exponent = (value >> 10) & 0x1f;
+    juce::uint32 mantissa = value & 0x03ff;
+    juce::uint32 bits;
+
+    if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mantissa != 0 ? 0x00400000 | (mantissa << 13) : 0);
+    }
+    else if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // Renormalise the subnormal
+            exponent = 1;
+            while ((mantissa & 0x0400) == 0)
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+
+            mantissa &= 0x03ff;
+            bits = sign | (static_cast<juce::uint32>(exponent + 127 - 15) << 23) | (mantissa << 13);
+        }
+    }
+    else
+    {
+        bits = sign | (static_cast<juce::uint32>(exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+bool HalfFloat::hasHardwareSupport()
+{
+   #if JUCE_INTEL
+    static const bool supported = detectF16C();
+    return supported;
+   #else
+    return false;
+   #endif
+}
+
+void HalfFloat::fromFloat(const float* source, juce::uint16* dest, size_t numValues)
+{
+   #if JUCE_INTEL
+    if (hasHardwareSupport())
+        return fromFloatF16C(source, dest, numValues);
+   #endif
+
+    for (size_t i = 0; i < numValues; ++i)
+        dest[i] = fromFloat(source[i]);
+}
+
+void HalfFloat::toFloat(const juce::uint16* source, float* dest, size_t numValues)
+{
+   #if JUCE_INTEL
+    if (hasHardwareSupport())
+        return toFloatF16C(source, dest, numValues);
+   #endif
+
+    for (size_t i = 0; i < numValues; ++i)
+        dest[i] = toFloat(source[i]);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// IEEE 754 half precision conversion. Uses F16C on x86 CPUs that have it and a
+// bit-exact scalar fallback elsewhere, both rounding to nearest even. A float -> half
+// -> float round trip keeps 11 significant bits, which is over 70 dB SDR on audio from
+// full scale down to -60 dBFS (checked by HalfFloatTests).
+namespace HalfFloat
+{
+    juce::uint16 fromFloat(float value);
+    float toFloat(juce::uint16 value);
+
+    void fromFloat(const float* source, juce::uint16* dest, size_t numValues);
+    void toFloat(const juce::uint16* source, float* dest, size_t numValues);
+
+    bool hasHardwareSupport();
+}
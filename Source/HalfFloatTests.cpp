@@ -0,0 +1,76 @@
+#include <JuceHeader.h>
+#include <cmath>
+#include <vector>
+#include "HalfFloat.h"
+
+class HalfFloatTests : public juce::UnitTest
+{
+public:
+    HalfFloatTests() : juce::UnitTest("HalfFloat", "DemucsJUCE") {}
+
+    void runTest() override
+    {
+        beginTest("Round trip SDR on audio");
+
+        // Full scale down to -60 dBFS, where the smallest samples approach the FP16 subnormals
+        for (const float levelDb : { 0.0f, -20.0f, -40.0f, -60.0f })
+        {
+            const auto audio = makeAudio(juce::Decibels::decibelsToGain(levelDb));
+            const auto sdr = roundTripSdr(audio);
+            logMessage(juce::String(levelDb) + " dBFS: " + juce::String(sdr, 1) + " dB SDR");
+            expectGreaterThan(sdr, 70.0, "Round trip SDR at " + juce::String(levelDb) + " dBFS");
+        }
+
+        beginTest("Block conversion matches single values");
+
+        const auto audio = makeAudio(1.0f);
+        std::vector<juce::uint16> half(audio.size());
+        HalfFloat::fromFloat(audio.data(), half.data(), audio.size());
+
+        bool allMatch = true;
+        for (size_t i = 0; i < audio.size(); ++i)
+            allMatch = allMatch && half[i] == HalfFloat::fromFloat(audio[i]);
+
+        expect(allMatch, HalfFloat::hasHardwareSupport() ? "F16C and scalar conversion differ"
+                                                         : "Block and single value conversion differ");
+    }
+
+private:
+    // Two decaying tones with noise, ten seconds at 44.1 kHz
+    static std::vector<float> makeAudio(float gain)
+    {
+        juce::Random random(1);
+        std::vector<float> audio(441000);
+
+        for (size_t i = 0; i < audio.size(); ++i)
+        {
+            const double t = static_cast<double>(i) / 44100.0;
+            const double tones = 0.5 * std::sin(juce::MathConstants<double>::twoPi * 220.0 * t)
+                               + 0.25 * std::sin(juce::MathConstants<double>::twoPi * 1375.0 * t);
+            const double noise = 0.1 * (random.nextDouble() * 2.0 - 1.0);
+            audio[i] = static_cast<float>((tones + noise) * std::exp(-1.5 * std::fmod(t, 2.5)) * gain);
+        }
+
+        return audio;
+    }
+
+    static double roundTripSdr(const std::vector<float>& audio)
+    {
+        std::vector<juce::uint16> half(audio.size());
+        std::vector<float> restored(audio.size());
+        HalfFloat::fromFloat(audio.data(), half.data(), audio.size());
+        HalfFloat::toFloat(half.data(), restored.data(), audio.size());
+
+        double signal = 0.0;
+        double error = 0.0;
+        for (size_t i = 0; i < audio.size(); ++i)
+        {
+            signal += static_cast<double>(audio[i]) * audio[i];
+            error += static_cast<double>(audio[i] - restored[i]) * (audio[i] - restored[i]);
+        }
+
+        return 10.0 * std::log10(signal / juce::jmax(error, 1.0e-30));
+    }
+};
+
+static HalfFloatTests halfFloatTests;
@@ -0,0 +1,602 @@
+#include "JobQueue.h"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    constexpr int kFileVersion = 1;
+
+    // How often a running job looks at the file for a pause from another process
+    constexpr juce::uint32 kPauseCheckIntervalMs = 1000;
+
+    // How often a running job writes its progress for other processes to show
+    constexpr juce::uint32 kProgressSaveIntervalMs = 5000;
+
+    JobQueue::State parseState(const juce::String& name)
+    {
+        for (auto state : { JobQueue::State::queued, JobQueue::State::running, JobQueue::State::paused,
+                            JobQueue::State::done, JobQueue::State::failed })
+        {
+            if (JobQueue::getStateName(state) == name)
+                return state;
+        }
+
+        return JobQueue::State::failed;
+    }
+
+    void sortInRunOrder(std::vector<JobQueue::Job>& jobs)
+    {
+        std::stable_sort(jobs.begin(), jobs.end(), [](const JobQueue::Job& a, const JobQueue::Job& b)
+        {
+            if (a.priority != b.priority)
+                return a.priority > b.priority;
+            return a.createdMilliseconds < b.createdMilliseconds;
+        });
+    }
+
+    JobQueue::Job* findJob(std::vector<JobQueue::Job>& jobs, const juce::String& id)
+    {
+        auto it = std::find_if(jobs.begin(), jobs.end(), [&id](const JobQueue::Job& job) { return job.id == id; });
+        return it != jobs.end() ? &*it : nullptr;
+    }
+}
+
+JobQueue::JobQueue(const juce::File& queueFile)
+    : Thread("DemucsJobQueue"),
+      mQueueFile(queueFile),
+      mQueueLock("DemucsJUCEQueue_" + juce::String::toHexString(queueFile.getFullPathName().hashCode64())),
+      mRunnerLock("DemucsJUCEQueueRunner_" + juce::String::toHexString(queueFile.getFullPathName().hashCode64()))
+{
+    if (!mQueueFile.getParentDirectory().createDirectory())
+        throw std::runtime_error("Could not create queue directory: " + mQueueFile.getParentDirectory().getFullPathName().toStdString());
+}
+
+JobQueue::~JobQueue()
+{
+    stopRunning();
+}
+
+juce::File JobQueue::getDefaultQueueFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+           .getChildFile("DemucsJUCE/queue.json");
+}
+
+juce::String JobQueue::getStateName(State state)
+{
+    switch (state)
+    {
+        case State::queued:  return "queued";
+        case State::running: return "running";
+        case State::paused:  return "paused";
+        case State::done:    return "done";
+        case State::failed:  return "failed";
+    }
+
+    return {};
+}
+
+//==============================================================================
+juce::String JobQueue::addJob(const juce::File& inputFile, const juce::File& outputDirectory, int priority)
+{
+    Job job;
+    job.id = juce::Uuid().toDashedString().substring(0, 8);
+    job.inputFile = inputFile;
+    job.outputDirectory = outputDirectory;
+    job.priority = priority;
+    job.createdMilliseconds = juce::Time::currentTimeMillis();
+
+    modify([&job](std::vector<Job>& jobs)
+    {
+        jobs.push_back(job);
+        return true;
+    });
+
+    return job.id;
+}
+
+bool JobQueue::setPriority(const juce::String& id, int priority)
+{
+    return modify([&](std::vector<Job>& jobs)
+    {
+        auto* job = findJob(jobs, id);
+        if (job == nullptr)
+            return false;
+
+        job->priority = priority;
+        return true;
+    });
+}
+
+bool JobQueue::pause(const juce::String& id)
+{
+    const bool paused = modify([&](std::vector<Job>& jobs)
+    {
+        auto* job = findJob(jobs, id);
+        if (job == nullptr || (job->state != State::queued && job->state != State::running))
+            return false;
+
+        job->state = State::paused;
+        job->message = "Paused";
+        return true;
+    });
+
+    if (paused)
+    {
+        const std::lock_guard<std::mutex> lock(mRunningLock);
+        if (mRunningId == id)
+            mPauseRunning = true;
+    }
+
+    return paused;
+}
+
+bool JobQueue::resume(const juce::String& id)
+{
+    return modify([&](std::vector<Job>& jobs)
+    {
+        auto* job = findJob(jobs, id);
+        if (job == nullptr || (job->state != State::paused && job->state != State::failed))
+            return false;
+
+        job->state = State::queued;
+        job->message = {};
+        return true;
+    });
+}
+
+bool JobQueue::remove(const juce::String& id)
+{
+    bool wasRunning = false;
+    const bool removed = modify([&](std::vector<Job>& jobs)
+    {
+        const auto oldSize = jobs.size();
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&](const Job& job)
+        {
+            if (job.id != id)
+                return false;
+
+            wasRunning = job.state == State::running;
+            return true;
+        }), jobs.end());
+        return jobs.size() != oldSize;
+    });
+
+    if (removed)
+    {
+        const std::lock_guard<std::mutex> lock(mRunningLock);
+        if (mRunningId == id)
+            mPauseRunning = true;
+    }
+
+    // A running job's checkpoints are deleted by its runner once it stops
+    if (removed && !wasRunning)
+        getCheckpointDirectory(id).deleteRecursively();
+
+    return removed;
+}
+
+int JobQueue::removeFinished()
+{
+    int numRemoved = 0;
+    modify([&numRemoved](std::vector<Job>& jobs)
+    {
+        const auto oldSize = jobs.size();
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [](const Job& job) { return job.state == State::done; }), jobs.end());
+        numRemoved = static_cast<int>(oldSize - jobs.size());
+        return numRemoved > 0;
+    });
+
+    return numRemoved;
+}
+
+std::vector<JobQueue::Job> JobQueue::getJobs() const
+{
+    std::vector<Job> jobs;
+    modify([&jobs](std::vector<Job>& loaded)
+    {
+        jobs = loaded;
+        return false;
+    });
+
+    {
+        const std::lock_guard<std::mutex> lock(mRunningLock);
+        if (auto* job = findJob(jobs, mRunningId); job != nullptr && job->state == State::running)
+        {
+            job->progress = mRunningProgress;
+            job->message = mRunningMessage;
+        }
+    }
+
+    sortInRunOrder(jobs);
+    return jobs;
+}
+
+//==============================================================================
+bool JobQueue::startRunning(const demucscpp::demucs_model& model, const StemSeparator::Options& options, bool stopWhenIdle)
+{
+    return startRunning(ModelEnsemble::wrap(model), options, stopWhenIdle);
+}
+
+bool JobQueue::startRunning(std::shared_ptr<const ModelEnsemble> ensemble, const StemSeparator::Options& options,
+                            bool stopWhenIdle)
+{
+    if (isThreadRunning())
+        return true;
+
+    if (!mRunnerLock.enter(0))
+        return false;
+
+    mEnsemble = std::move(ensemble);
+    mOptions = options;
+    mOptions.streaming = true;
+    mStopWhenIdle = stopWhenIdle;
+
+    // Only one process runs the queue, so anything still marked running was interrupted
+    modify([](std::vector<Job>& jobs)
+    {
+        bool changed = false;
+        for (auto& job : jobs)
+        {
+            if (job.state == State::running)
+            {
+                job.state = State::queued;
+                job.message = "Interrupted, resuming from checkpoint";
+                changed = true;
+            }
+        }
+        return changed;
+    });
+
+    startThread();
+    return true;
+}
+
+void JobQueue::stopRunning()
+{
+    signalThreadShouldExit();
+    waitUntilStopped();
+}
+
+void JobQueue::waitUntilStopped()
+{
+    waitForThreadToExit(-1);
+
+    if (mEnsemble != nullptr)
+    {
+        mEnsemble.reset();
+        mRunnerLock.exit();
+    }
+}
+
+void JobQueue::run()
+{
+    while (!threadShouldExit())
+    {
+        try
+        {
+            Job job;
+            if (claimNextJob(job))
+                runJob(job);
+            else if (mStopWhenIdle)
+                break;
+            else
+                wait(500);
+        }
+        catch (const DamagedFileError& e)
+        {
+            if (onFileDamaged)
+                onFileDamaged(e.what());
+        }
+        catch (const std::exception& e)
+        {
+            // The queue file couldn't be read or written, try again later
+            DBG("JobQueue: " + juce::String(e.what()));
+            wait(1000);
+        }
+    }
+}
+
+bool JobQueue::claimNextJob(Job& job)
+{
+    return modify([&job](std::vector<Job>& jobs)
+    {
+        sortInRunOrder(jobs);
+        for (auto& candidate : jobs)
+        {
+            if (candidate.state == State::queued)
+            {
+                candidate.state = State::running;
+                candidate.message = {};
+                job = candidate;
+                return true;
+            }
+        }
+        return false;
+    });
+}
+
+void JobQueue::runJob(Job job)
+{
+    {
+        const std::lock_guard<std::mutex> lock(mRunningLock);
+        mRunningId = job.id;
+        mRunningProgress = 0.0f;
+        mRunningMessage = {};
+        mLastProgressSave = juce::Time::getMillisecondCounter();
+        mPauseRunning = false;
+    }
+
+    StemSeparator separator(mEnsemble);
+
+    // The cancel check runs on every chunk worker at once
+    std::atomic<bool> cancelled { false };
+    juce::String error;
+    StemSeparator::Result result;
+
+    try
+    {
+        auto options = mOptions;
+        options.checkpoints = std::make_shared<StemCache>(getCheckpointDirectory(job.id), mEnsemble->getModelFiles(),
+                                                          mEnsemble->getWeightsTag(), std::numeric_limits<juce::int64>::max());
+        separator.setOptions(options);
+
+        result = separator.process(job.inputFile, job.outputDirectory,
+            [this, &job, &separator](float progress, const juce::String& message) {
+                bool save = false;
+                float savedProgress = 0.0f;
+                {
+                    const std::lock_guard<std::mutex> lock(mRunningLock);
+                    if (progress >= 0.0f)
+                        mRunningProgress = progress;
+                    mRunningMessage = message;
+
+                    const auto now = juce::Time::getMillisecondCounter();
+                    if (now - mLastProgressSave >= kProgressSaveIntervalMs)
+                    {
+                        mLastProgressSave = now;
+                        savedProgress = mRunningProgress;
+                        save = true;
+                    }
+                }
+
+                if (save)
+                    saveProgress(job.id, savedProgress, message, separator.getNumSegmentsDone(),
+                                 separator.getNumCachedSegments());
+            },
+            [this, &job, &cancelled]() {
+                if (threadShouldExit() || isPauseRequested(job.id))
+                    cancelled = true;
+                return cancelled.load();
+            });
+    }
+    catch (const std::exception& e)
+    {
+        error = e.what();
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(mRunningLock);
+        mRunningId = {};
+    }
+
+    bool finished = false;
+    modify([&](std::vector<Job>& jobs)
+    {
+        auto* stored = findJob(jobs, job.id);
+        if (stored == nullptr)
+        {
+            finished = true; // removed meanwhile
+            return false;
+        }
+
+        if (stored->state != State::running)
+        {
+            job = *stored; // paused meanwhile
+            return false;
+        }
+
+        if (cancelled)
+        {
+            // Stopped by stopRunning(), picks up from its checkpoints next time
+            stored->state = State::queued;
+            stored->message = "Stopped, resuming from checkpoint";
+        }
+        else if (error.isNotEmpty())
+        {
+            stored->state = State::failed;
+            stored->message = error;
+        }
+        else
+        {
+            stored->state = State::done;
+            stored->progress = 1.0f;
+            stored->numSegments = result.numSegments;
+            stored->numCachedSegments = result.numCachedSegments;
+            stored->message = "Done in " + juce::String(result.wallSeconds, 1) + " s";
+            finished = true;
+        }
+
+        job = *stored;
+        return true;
+    });
+
+    // Failed and stopped jobs keep theirs to resume from
+    if (finished)
+        getCheckpointDirectory(job.id).deleteRecursively();
+
+    if (onJobFinished)
+        onJobFinished(job);
+}
+
+bool JobQueue::isPauseRequested(const juce::String& id)
+{
+    if (mPauseRunning)
+        return true;
+
+    // Pauses from other processes only show up in the file. One worker reads it, the
+    // others go on instead of waiting for the file.
+    const std::unique_lock<std::mutex> lock(mPauseCheckLock, std::try_to_lock);
+    if (!lock.owns_lock())
+        return mPauseRunning;
+
+    const auto now = juce::Time::getMillisecondCounter();
+    if (now - mLastPauseCheck < kPauseCheckIntervalMs)
+        return false;
+
+    mLastPauseCheck = now;
+
+    // Called from the separator's cancel check, which must not throw; an unreadable
+    // queue file is read again at the next interval
+    try
+    {
+        modify([&](std::vector<Job>& jobs)
+        {
+            auto* job = findJob(jobs, id);
+            if (job == nullptr || job->state != State::running)
+                mPauseRunning = true;
+            return false;
+        });
+    }
+    catch (const DamagedFileError& e)
+    {
+        if (onFileDamaged)
+            onFileDamaged(e.what());
+    }
+    catch (const std::exception& e)
+    {
+        DBG("JobQueue: pause check failed, " + juce::String(e.what()));
+    }
+
+    return mPauseRunning;
+}
+
+void JobQueue::saveProgress(const juce::String& id, float progress, const juce::String& message,
+                            int numSegments, int numCachedSegments)
+{
+    // Called from the separator's progress callback, which must not throw; a failed write
+    // is retried at the next interval
+    try
+    {
+        modify([&](std::vector<Job>& jobs)
+        {
+            auto* job = findJob(jobs, id);
+            if (job == nullptr || job->state != State::running)
+                return false;
+
+            job->progress = progress;
+            job->message = message;
+            job->numSegments = numSegments;
+            job->numCachedSegments = numCachedSegments;
+            return true;
+        });
+    }
+    catch (const DamagedFileError& e)
+    {
+        if (onFileDamaged)
+            onFileDamaged(e.what());
+    }
+    catch (const std::exception& e)
+    {
+        DBG("JobQueue: progress save failed, " + juce::String(e.what()));
+    }
+}
+
+juce::File JobQueue::getCheckpointDirectory(const juce::String& id) const
+{
+    return mQueueFile.getSiblingFile(mQueueFile.getFileNameWithoutExtension() + "_checkpoints").getChildFile(id);
+}
+
+//==============================================================================
+bool JobQueue::modify(const std::function<bool(std::vector<Job>&)>& edit) const
+{
+    const std::lock_guard<std::mutex> lock(mFileLock);
+    const juce::InterProcessLock::ScopedLockType processLock(mQueueLock);
+
+    if (!processLock.isLocked())
+        throw std::runtime_error("Could not lock " + mQueueFile.getFullPathName().toStdString());
+
+    auto jobs = loadLocked();
+    if (!edit(jobs))
+        return false;
+
+    saveLocked(jobs);
+    return true;
+}
+
+std::vector<JobQueue::Job> JobQueue::loadLocked() const
+{
+    std::vector<Job> jobs;
+    if (!mQueueFile.existsAsFile())
+        return jobs;
+
+    // A half-written or hand-edited file would otherwise read as an empty queue and be
+    // overwritten by the next change, losing every job
+    juce::var root;
+    const auto parsed = juce::JSON::parse(mQueueFile.loadFileAsString(), root);
+    if (parsed.failed() || !root.isObject())
+    {
+        const auto reason = parsed.failed() ? parsed.getErrorMessage() : juce::String("not a JSON object");
+        const auto aside = mQueueFile.getSiblingFile(mQueueFile.getFileName() + ".bad").getNonexistentSibling(false);
+
+        if (!mQueueFile.moveFileTo(aside))
+            throw DamagedFileError("Could not read " + mQueueFile.getFullPathName().toStdString() + " (" + reason.toStdString()
+                                   + ") or move it aside");
+
+        throw DamagedFileError("Could not read " + mQueueFile.getFullPathName().toStdString() + " (" + reason.toStdString()
+                               + "), it was moved to " + aside.getFullPathName().toStdString() + " and the queue starts empty");
+    }
+
+    if (auto* array = root["jobs"].getArray())
+    {
+        for (const auto& item : *array)
+        {
+            Job job;
+            job.id = item["id"].toString();
+            job.inputFile = juce::File(item["input"].toString());
+            job.outputDirectory = juce::File(item["output"].toString());
+            job.priority = item["priority"];
+            job.state = parseState(item["state"].toString());
+            job.createdMilliseconds = item["created"];
+            job.progress = item["progress"];
+            job.numSegments = item["segments"];
+            job.numCachedSegments = item["cachedSegments"];
+            job.message = item["message"].toString();
+
+            if (job.id.isNotEmpty())
+                jobs.push_back(job);
+        }
+    }
+
+    return jobs;
+}
+
+void JobQueue::saveLocked(const std::vector<Job>& jobs) const
+{
+    juce::Array<juce::var> array;
+    for (const auto& job : jobs)
+    {
+        auto* item = new juce::DynamicObject();
+        item->setProperty("id", job.id);
+        item->setProperty("input", job.inputFile.getFullPathName());
+        item->setProperty("output", job.outputDirectory.getFullPathName());
+        item->setProperty("priority", job.priority);
+        item->setProperty("state", getStateName(job.state));
+        item->setProperty("created", job.createdMilliseconds);
+        item->setProperty("progress", job.progress);
+        item->setProperty("segments", job.numSegments);
+        item->setProperty("cachedSegments", job.numCachedSegments);
+        item->setProperty("message", job.message);
+        array.add(juce::var(item));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("version", kFileVersion);
+    root->setProperty("jobs", array);
+
+    // Written to a temporary file and renamed so a crash never leaves half a queue behind
+    juce::TemporaryFile temporary(mQueueFile);
+    if (!temporary.getFile().replaceWithText(juce::JSON::toString(juce::var(root)))
+        || !temporary.overwriteTargetFileWithTemporary())
+        throw std::runtime_error("Could not write " + mQueueFile.getFullPathName().toStdString());
+}
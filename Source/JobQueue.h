@@ -0,0 +1,125 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "StemSeparator.h"
+
+// Persistent queue of separation jobs. The queue lives in a JSON file that is rewritten
+// atomically on every change and guarded by an inter-process lock, so the app and
+// DemucsBatch can edit the same queue while either of them runs it.
+//
+// Jobs always run in streaming mode, and every finished chunk goes into a checkpoint store
+// of the job's own: a job that is paused, stopped or interrupted by a crash starts over but
+// only has to re-read and re-stitch the chunks it already separated. Unlike the shared
+// StemCache the store never evicts, however long the job, and it is deleted once the job
+// is done or removed. Progress is written to the file while a job runs.
+class JobQueue : private juce::Thread
+{
+public:
+    enum class State
+    {
+        queued,
+        running,
+        paused,
+        done,
+        failed
+    };
+
+    struct Job
+    {
+        juce::String id;
+        juce::File inputFile;
+        juce::File outputDirectory;
+        int priority { 0 };
+        State state { State::queued };
+        juce::int64 createdMilliseconds { 0 };
+        float progress { 0.0f };
+        int numSegments { 0 };
+        int numCachedSegments { 0 };
+        juce::String message;
+    };
+
+    // Thrown when the queue file can't be parsed. The file is first moved aside to
+    // <name>.bad, so it is kept as it was and the queue starts again empty.
+    struct DamagedFileError : std::runtime_error
+    {
+        using std::runtime_error::runtime_error;
+    };
+
+    explicit JobQueue(const juce::File& queueFile);
+    ~JobQueue() override;
+
+    static juce::File getDefaultQueueFile();
+    static juce::String getStateName(State state);
+
+    // Editing, from any thread or process. The id-based calls return false for unknown ids.
+    juce::String addJob(const juce::File& inputFile, const juce::File& outputDirectory, int priority = 0);
+    bool setPriority(const juce::String& id, int priority);
+    bool pause(const juce::String& id);
+    bool resume(const juce::String& id);
+    bool remove(const juce::String& id);
+    int removeFinished();
+
+    // Highest priority first, then oldest first. The job this process is running carries
+    // live progress; others show what was last written to the file.
+    std::vector<Job> getJobs() const;
+
+    // Runs queued jobs on a background thread until stopRunning(). Returns false if another
+    // process is already running this queue. With stopWhenIdle the thread ends once no
+    // queued jobs are left. A running job that is stopped goes back to the queue.
+    bool startRunning(const demucscpp::demucs_model& model,
+                      const StemSeparator::Options& options,
+                      bool stopWhenIdle = false);
+    bool startRunning(std::shared_ptr<const ModelEnsemble> ensemble,
+                      const StemSeparator::Options& options,
+                      bool stopWhenIdle = false);
+    void stopRunning();
+    void waitUntilStopped();
+    bool isRunning() const { return isThreadRunning(); }
+
+    // Called on the runner thread whenever a job stops running, with its new state
+    std::function<void(const Job&)> onJobFinished;
+
+    // Called on the runner thread if it was the one to find the queue file damaged
+    std::function<void(const juce::String& error)> onFileDamaged;
+
+private:
+    void run() override; // Thread
+
+    bool claimNextJob(Job& job);
+    void runJob(Job job);
+
+    // Loads the file, lets edit change it and writes it back if edit returns true, all
+    // under the inter-process lock
+    bool modify(const std::function<bool(std::vector<Job>&)>& edit) const;
+    std::vector<Job> loadLocked() const;
+    void saveLocked(const std::vector<Job>& jobs) const;
+    bool isPauseRequested(const juce::String& id);
+    void saveProgress(const juce::String& id, float progress, const juce::String& message,
+                      int numSegments, int numCachedSegments);
+    juce::File getCheckpointDirectory(const juce::String& id) const;
+
+    const juce::File mQueueFile;
+    mutable std::mutex mFileLock;
+    mutable juce::InterProcessLock mQueueLock;
+    juce::InterProcessLock mRunnerLock;
+
+    std::shared_ptr<const ModelEnsemble> mEnsemble;
+    StemSeparator::Options mOptions;
+    bool mStopWhenIdle { false };
+
+    // State of the job this process is running
+    mutable std::mutex mRunningLock;
+    juce::String mRunningId;
+    float mRunningProgress { 0.0f };
+    juce::String mRunningMessage;
+    juce::uint32 mLastProgressSave { 0 };
+    std::atomic<bool> mPauseRunning { false };
+    std::mutex mPauseCheckLock;
+    juce::uint32 mLastPauseCheck { 0 }; // guarded by mPauseCheckLock
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JobQueue)
+};
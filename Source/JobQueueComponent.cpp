@@ -0,0 +1,174 @@
+#include "JobQueueComponent.h"
+
+JobQueueComponent::JobQueueComponent(JobQueue& queue)
+    : mQueue(queue)
+{
+    auto& header = mTable.getHeader();
+    const int flags = juce::TableHeaderComponent::visible;
+    header.addColumn("File", fileColumn, 220, 100, -1, flags);
+    header.addColumn("State", stateColumn, 70, 50, -1, flags);
+    header.addColumn("Priority", priorityColumn, 60, 50, -1, flags);
+    header.addColumn("Progress", progressColumn, 70, 50, -1, flags);
+    header.addColumn("Message", messageColumn, 300, 100, -1, flags);
+
+    mTable.setRowHeight(20);
+    addAndMakeVisible(mTable);
+
+    auto runOnSelected = [this](std::function<void(const JobQueue::Job&)> action)
+    {
+        return [this, action]()
+        {
+            if (auto* job = getSelectedJob())
+            {
+                try
+                {
+                    action(*job);
+                }
+                catch (const std::exception& e)
+                {
+                    juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Job Queue", e.what());
+                }
+
+                refresh();
+            }
+        };
+    };
+
+    mPauseButton.onClick = runOnSelected([this](const JobQueue::Job& job) { mQueue.pause(job.id); });
+    mResumeButton.onClick = runOnSelected([this](const JobQueue::Job& job) { mQueue.resume(job.id); });
+    mRaiseButton.onClick = runOnSelected([this](const JobQueue::Job& job) { mQueue.setPriority(job.id, job.priority + 1); });
+    mLowerButton.onClick = runOnSelected([this](const JobQueue::Job& job) { mQueue.setPriority(job.id, job.priority - 1); });
+    mRemoveButton.onClick = runOnSelected([this](const JobQueue::Job& job) { mQueue.remove(job.id); });
+    mClearButton.onClick = [this]()
+    {
+        mQueue.removeFinished();
+        refresh();
+    };
+
+    for (auto* button : { &mPauseButton, &mResumeButton, &mRaiseButton, &mLowerButton, &mRemoveButton, &mClearButton })
+        addAndMakeVisible(button);
+
+    refresh();
+    startTimerHz(2);
+}
+
+void JobQueueComponent::resized()
+{
+    auto area = getLocalBounds();
+    auto buttons = area.removeFromTop(28);
+
+    for (auto* button : { &mPauseButton, &mResumeButton, &mRaiseButton, &mLowerButton, &mRemoveButton, &mClearButton })
+    {
+        button->setBounds(buttons.removeFromLeft(90));
+        buttons.removeFromLeft(6);
+    }
+
+    area.removeFromTop(6);
+    mTable.setBounds(area);
+}
+
+int JobQueueComponent::getNumRows()
+{
+    return static_cast<int>(mJobs.size());
+}
+
+void JobQueueComponent::paintRowBackground(juce::Graphics& g, int row, int, int, bool isSelected)
+{
+    const auto background = getLookAndFeel().findColour(juce::ListBox::backgroundColourId);
+    if (isSelected)
+        g.fillAll(getLookAndFeel().findColour(juce::TextEditor::highlightColourId));
+    else if (row % 2 == 1)
+        g.fillAll(background.interpolatedWith(getLookAndFeel().findColour(juce::ListBox::textColourId), 0.05f));
+}
+
+void JobQueueComponent::paintCell(juce::Graphics& g, int row, int columnId, int width, int height, bool)
+{
+    if (row < 0 || row >= getNumRows())
+        return;
+
+    const auto& job = mJobs[(size_t) row];
+    juce::String text;
+    auto justification = juce::Justification::centredLeft;
+
+    switch (columnId)
+    {
+        case fileColumn:     text = job.inputFile.getFileName(); break;
+        case stateColumn:    text = JobQueue::getStateName(job.state); break;
+        case priorityColumn: text = juce::String(job.priority); justification = juce::Justification::centredRight; break;
+        case progressColumn: text = juce::String(juce::roundToInt(job.progress * 100.0f)) + " %"; justification = juce::Justification::centredRight; break;
+        case messageColumn:  text = job.message; break;
+        default: break;
+    }
+
+    g.setColour(getLookAndFeel().findColour(juce::ListBox::textColourId));
+    g.setFont(14.0f);
+    g.drawText(text, 4, 0, width - 8, height, justification, true);
+}
+
+void JobQueueComponent::selectedRowsChanged(int lastRowSelected)
+{
+    mSelectedId = juce::isPositiveAndBelow(lastRowSelected, getNumRows()) ? mJobs[(size_t) lastRowSelected].id : juce::String();
+    updateButtons();
+}
+
+void JobQueueComponent::timerCallback()
+{
+    refresh();
+}
+
+void JobQueueComponent::refresh()
+{
+    try
+    {
+        mJobs = mQueue.getJobs();
+    }
+    catch (const JobQueue::DamagedFileError& e)
+    {
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Job Queue", e.what());
+        return;
+    }
+    catch (const std::exception&)
+    {
+        return; // Locked by another process for too long, try again on the next tick
+    }
+
+    // Keep the same job selected while the order changes
+    const auto selectedId = mSelectedId;
+    mTable.updateContent();
+
+    int selectedRow = -1;
+    for (size_t i = 0; i < mJobs.size(); ++i)
+        if (mJobs[i].id == selectedId)
+            selectedRow = static_cast<int>(i);
+
+    if (selectedRow >= 0)
+        mTable.selectRow(selectedRow, true, true);
+    else
+        mTable.deselectAllRows();
+
+    mSelectedId = selectedRow >= 0 ? selectedId : juce::String();
+    mTable.repaint();
+    updateButtons();
+}
+
+const JobQueue::Job* JobQueueComponent::getSelectedJob() const
+{
+    for (const auto& job : mJobs)
+        if (job.id == mSelectedId)
+            return &job;
+
+    return nullptr;
+}
+
+void JobQueueComponent::updateButtons()
+{
+    const auto* job = getSelectedJob();
+    const bool canPause = job != nullptr && (job->state == JobQueue::State::queued || job->state == JobQueue::State::running);
+    const bool canResume = job != nullptr && (job->state == JobQueue::State::paused || job->state == JobQueue::State::failed);
+
+    mPauseButton.setEnabled(canPause);
+    mResumeButton.setEnabled(canResume);
+    mRaiseButton.setEnabled(job != nullptr);
+    mLowerButton.setEnabled(job != nullptr);
+    mRemoveButton.setEnabled(job != nullptr);
+}
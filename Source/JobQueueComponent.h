@@ -0,0 +1,49 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "JobQueue.h"
+
+// Lists the jobs of a JobQueue with controls to pause, resume, reprioritise and remove them
+class JobQueueComponent : public juce::Component,
+                          private juce::TableListBoxModel,
+                          private juce::Timer
+{
+public:
+    explicit JobQueueComponent(JobQueue& queue);
+
+    void resized() override;
+
+private:
+    enum ColumnIds
+    {
+        fileColumn = 1,
+        stateColumn,
+        priorityColumn,
+        progressColumn,
+        messageColumn
+    };
+
+    int getNumRows() override;
+    void paintRowBackground(juce::Graphics& g, int row, int width, int height, bool isSelected) override;
+    void paintCell(juce::Graphics& g, int row, int columnId, int width, int height, bool isSelected) override;
+    void selectedRowsChanged(int lastRowSelected) override;
+
+    void timerCallback() override;
+    void refresh();
+    const JobQueue::Job* getSelectedJob() const;
+    void updateButtons();
+
+    JobQueue& mQueue;
+    std::vector<JobQueue::Job> mJobs;
+    juce::String mSelectedId;
+
+    juce::TableListBox mTable { {}, this };
+    juce::TextButton mPauseButton { "Pause" };
+    juce::TextButton mResumeButton { "Resume" };
+    juce::TextButton mRaiseButton { "Priority +" };
+    juce::TextButton mLowerButton { "Priority -" };
+    juce::TextButton mRemoveButton { "Remove" };
+    juce::TextButton mClearButton { "Clear Done" };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JobQueueComponent)
+};
@@ -0,0 +1,377 @@
+#include "LiveSeparator.h"
+#include "ModelLoader.h"
+
+namespace
+{
+    constexpr int kNumChannels = StemSeparator::kNumChannels;
+    constexpr int kNumStems = StemSeparator::kNumStems;
+}
+
+LiveSeparator::LiveSeparator(const juce::File& modelFile)
+    : Thread("DemucsLiveSeparator"),
+      mModelFile(modelFile)
+{
+}
+
+LiveSeparator::~LiveSeparator()
+{
+    release();
+}
+
+void LiveSeparator::prepare(double sampleRate, int maximumBlockSize)
+{
+    release();
+
+    mWindowSamples = juce::roundToInt(kWindowSeconds * StemSeparator::kSampleRate);
+    mOverlapSamples = juce::roundToInt(kOverlapSeconds * StemSeparator::kSampleRate);
+    mHopSamples = mWindowSamples - mOverlapSamples;
+
+    // A window is separated once its last sample has arrived, which can be one block after
+    // it was played, and inference then has one hop to finish before its first output
+    // sample is due
+    mLatencySamples = mWindowSamples + mHopSamples + maximumBlockSize;
+
+    const int ringSamples = 2 * (mWindowSamples + maximumBlockSize);
+    mInputFifo.setTotalSize(ringSamples);
+    mInputRing.setSize(kNumChannels, ringSamples);
+    mOutputFifo.setTotalSize(ringSamples);
+    mOutputRing.setSize(kNumStems * kNumChannels, ringSamples);
+
+    mDryDelay.setSize(kNumChannels, mLatencySamples);
+    mDryDelay.clear();
+    mDryScratch.setSize(kNumChannels, maximumBlockSize);
+    mDryDelayPosition = 0;
+
+    mWindow.setSize(kNumChannels, mWindowSamples);
+    mWindowMatrix.resize(kNumChannels, mWindowSamples);
+    mStitcher.prepare(kNumStems, kNumChannels, ChunkPlan(mWindowSamples, mWindowSamples, mOverlapSamples));
+
+    mWaitingForRestart = true;
+    mRestartRequested = true;
+    mSamplesSinceRestart = 0;
+    mSamplesToSkip = 0;
+    mLastGains.fill(1.0f);
+
+    if (sampleRate != StemSeparator::kSampleRate)
+    {
+        mState = State::unsupportedSampleRate;
+        return;
+    }
+
+    startThread();
+}
+
+void LiveSeparator::release()
+{
+    // Model loading can't be interrupted, so this may wait for it to finish
+    signalThreadShouldExit();
+    waitForThreadToExit(-1);
+
+    auto state = mState.load();
+    if (state == State::running || state == State::loadingModel || state == State::unsupportedSampleRate)
+        mState = State::idle;
+}
+
+juce::String LiveSeparator::getStatusText() const
+{
+    switch (getState())
+    {
+        case State::idle:                  return "Idle";
+        case State::loadingModel:          return "Loading model...";
+        case State::modelMissing:          return "Model not found: " + mModelFile.getFullPathName();
+        case State::unsupportedSampleRate: return "Only 44.1kHz is supported, passing audio through";
+        case State::failed:                return "Separation failed, passing audio through";
+        case State::running:               break;
+    }
+
+    return "Separating, latency " + juce::String(mLatencySamples / StemSeparator::kSampleRate, 2) + " s"
+           + ", underruns " + juce::String(getNumUnderruns())
+           + ", restarts " + juce::String(getNumRestarts());
+}
+
+//==============================================================================
+void LiveSeparator::process(juce::AudioBuffer<float>& buffer, int numSamples, const StemGains& gains)
+{
+    jassert(numSamples <= mDryScratch.getNumSamples());
+
+    readDelayedDry(buffer, numSamples);
+
+    if (mWaitingForRestart && !mRestartRequested.load(std::memory_order_acquire))
+    {
+        mWaitingForRestart = false;
+        mSamplesSinceRestart = 0;
+        mSamplesToSkip = 0;
+        mLastGains = gains;
+    }
+
+    if (!mWaitingForRestart)
+    {
+        int start1, size1, start2, size2;
+        mInputFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+        if (size1 + size2 < numSamples)
+        {
+            requestRestart();
+        }
+        else
+        {
+            for (int ch = 0; ch < kNumChannels; ++ch)
+            {
+                mInputRing.copyFrom(ch, start1, buffer, ch, 0, size1);
+                if (size2 > 0)
+                    mInputRing.copyFrom(ch, start2, buffer, ch, size1, size2);
+            }
+
+            mInputFifo.finishedWrite(numSamples);
+        }
+    }
+
+    if (mWaitingForRestart)
+    {
+        for (int ch = 0; ch < kNumChannels; ++ch)
+            buffer.copyFrom(ch, 0, mDryScratch, ch, 0, numSamples);
+        return;
+    }
+
+    // The first latency's worth of output after a restart predates the new stream
+    const int numDry = static_cast<int>(juce::jlimit<juce::int64>(0, numSamples, mLatencySamples - mSamplesSinceRestart));
+    mSamplesSinceRestart += numSamples;
+
+    // Stems that arrived after their slot was already filled with dry audio
+    if (mSamplesToSkip > 0)
+    {
+        const int numSkipped = juce::jmin(mSamplesToSkip, mOutputFifo.getNumReady());
+        mOutputFifo.finishedRead(numSkipped);
+        mSamplesToSkip -= numSkipped;
+    }
+
+    const int numWanted = numSamples - numDry;
+    const int numStems = mSamplesToSkip == 0 ? juce::jmin(numWanted, mOutputFifo.getNumReady()) : 0;
+    const int numMissing = numWanted - numStems;
+
+    for (int ch = 0; ch < kNumChannels; ++ch)
+    {
+        buffer.copyFrom(ch, 0, mDryScratch, ch, 0, numDry);
+        buffer.copyFrom(ch, numDry + numStems, mDryScratch, ch, numDry + numStems, numMissing);
+    }
+
+    mixStems(buffer, numDry, numStems, gains);
+
+    if (numMissing > 0)
+    {
+        mSamplesToSkip += numMissing;
+        ++mNumUnderruns;
+    }
+}
+
+void LiveSeparator::readDelayedDry(const juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    using FVO = juce::FloatVectorOperations;
+
+    const int delaySamples = mDryDelay.getNumSamples();
+    const int first = juce::jmin(numSamples, delaySamples - mDryDelayPosition);
+
+    for (int ch = 0; ch < kNumChannels; ++ch)
+    {
+        const float* input = buffer.getReadPointer(ch);
+        float* delay = mDryDelay.getWritePointer(ch);
+        float* dry = mDryScratch.getWritePointer(ch);
+
+        FVO::copy(dry, delay + mDryDelayPosition, first);
+        FVO::copy(delay + mDryDelayPosition, input, first);
+
+        if (numSamples > first)
+        {
+            FVO::copy(dry + first, delay, numSamples - first);
+            FVO::copy(delay, input + first, numSamples - first);
+        }
+    }
+
+    mDryDelayPosition = (mDryDelayPosition + numSamples) % delaySamples;
+}
+
+void LiveSeparator::mixStems(juce::AudioBuffer<float>& buffer, int offset, int numSamples, const StemGains& gains)
+{
+    if (numSamples > 0)
+    {
+        int start1, size1, start2, size2;
+        mOutputFifo.prepareToRead(numSamples, start1, size1, start2, size2);
+        jassert(size1 + size2 == numSamples);
+
+        for (int ch = 0; ch < kNumChannels; ++ch)
+            buffer.clear(ch, offset, numSamples);
+
+        // Gain changes are ramped over the block, split where the ring wraps
+        for (int stem = 0; stem < kNumStems; ++stem)
+        {
+            const float startGain = mLastGains[(size_t) stem];
+            const float endGain = gains[(size_t) stem];
+            const float wrapGain = startGain + (endGain - startGain) * static_cast<float>(size1) / static_cast<float>(numSamples);
+
+            for (int ch = 0; ch < kNumChannels; ++ch)
+            {
+                const int ringChannel = stem * kNumChannels + ch;
+                buffer.addFromWithRamp(ch, offset, mOutputRing.getReadPointer(ringChannel, start1), size1, startGain, wrapGain);
+                if (size2 > 0)
+                    buffer.addFromWithRamp(ch, offset + size1, mOutputRing.getReadPointer(ringChannel, start2), size2, wrapGain, endGain);
+            }
+        }
+
+        mOutputFifo.finishedRead(size1 + size2);
+    }
+
+    mLastGains = gains;
+}
+
+void LiveSeparator::requestRestart()
+{
+    mWaitingForRestart = true;
+    mRestartRequested.store(true, std::memory_order_release);
+    ++mNumRestarts;
+}
+
+//==============================================================================
+void LiveSeparator::run()
+{
+    if (!loadModel())
+        return;
+
+    mState = State::running;
+
+    while (!threadShouldExit())
+    {
+        if (mRestartRequested.load(std::memory_order_acquire))
+        {
+            mInputFifo.reset();
+            mOutputFifo.reset();
+            mWindowIndex = 0;
+            mRestartRequested.store(false, std::memory_order_release);
+        }
+
+        try
+        {
+            if (!separateNextWindow())
+                wait(5);
+        }
+        catch (const Aborted&)
+        {
+        }
+        catch (const std::exception& e)
+        {
+            DBG("LiveSeparator: " + juce::String(e.what()));
+            mState = State::failed;
+            return;
+        }
+    }
+}
+
+bool LiveSeparator::loadModel()
+{
+    if (mModel)
+        return true;
+
+    if (!mModelFile.existsAsFile())
+    {
+        mState = State::modelMissing;
+        return false;
+    }
+
+    mState = State::loadingModel;
+
+    try
+    {
+        mModel = ModelLoader::load(mModelFile);
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        DBG("LiveSeparator: " + juce::String(e.what()));
+        mState = State::failed;
+        return false;
+    }
+}
+
+bool LiveSeparator::separateNextWindow()
+{
+    // The first window of a stream is read in full, later ones keep the overlap
+    const int numNew = mWindowIndex == 0 ? mWindowSamples : mHopSamples;
+    if (mInputFifo.getNumReady() < numNew)
+        return false;
+
+    const int numKept = mWindowSamples - numNew;
+    for (int ch = 0; ch < kNumChannels; ++ch)
+        mWindow.copyFrom(ch, 0, mWindow, ch, mHopSamples, numKept);
+
+    int start1, size1, start2, size2;
+    mInputFifo.prepareToRead(numNew, start1, size1, start2, size2);
+    for (int ch = 0; ch < kNumChannels; ++ch)
+    {
+        mWindow.copyFrom(ch, numKept, mInputRing, ch, start1, size1);
+        if (size2 > 0)
+            mWindow.copyFrom(ch, numKept + size1, mInputRing, ch, start2, size2);
+    }
+    mInputFifo.finishedRead(size1 + size2);
+
+    // The column-major 2 x N Eigen matrix is interleaved stereo in memory
+    using Format = juce::AudioData::Format<juce::AudioData::Float32, juce::AudioData::NativeEndian>;
+    juce::AudioData::interleaveSamples(juce::AudioData::NonInterleavedSource<Format> { mWindow.getArrayOfReadPointers(), kNumChannels },
+                                       juce::AudioData::InterleavedDest<Format> { mWindowMatrix.data(), kNumChannels },
+                                       mWindowSamples);
+
+    auto stems = demucscpp::demucs_inference(*mModel, mWindowMatrix,
+        [this](float, const std::string&) {
+            if (shouldAbort())
+                throw Aborted {};
+        });
+
+    ChunkPlan::Chunk chunk;
+    chunk.index = mWindowIndex;
+    chunk.start = static_cast<juce::int64>(mWindowIndex) * mHopSamples;
+    chunk.length = mWindowSamples;
+    chunk.overlapWithPrevious = mWindowIndex > 0 ? mOverlapSamples : 0;
+    chunk.overlapWithNext = mOverlapSamples;
+
+    mStitcher.push(chunk, stems, [this](const juce::AudioBuffer<float>& block, int numSamples) {
+        if (!writeStems(block, numSamples))
+            throw Aborted {};
+    });
+
+    ++mWindowIndex;
+    return true;
+}
+
+bool LiveSeparator::writeStems(const juce::AudioBuffer<float>& block, int numSamples)
+{
+    int numWritten = 0;
+    while (numWritten < numSamples)
+    {
+        if (shouldAbort())
+            return false;
+
+        int start1, size1, start2, size2;
+        mOutputFifo.prepareToWrite(numSamples - numWritten, start1, size1, start2, size2);
+        if (size1 + size2 == 0)
+        {
+            // The audio thread isn't consuming, e.g. transport stopped
+            wait(2);
+            continue;
+        }
+
+        for (int ch = 0; ch < mOutputRing.getNumChannels(); ++ch)
+        {
+            mOutputRing.copyFrom(ch, start1, block, ch, numWritten, size1);
+            if (size2 > 0)
+                mOutputRing.copyFrom(ch, start2, block, ch, numWritten + size1, size2);
+        }
+
+        mOutputFifo.finishedWrite(size1 + size2);
+        numWritten += size1 + size2;
+    }
+
+    return true;
+}
+
+bool LiveSeparator::shouldAbort() const
+{
+    return threadShouldExit() || mRestartRequested.load(std::memory_order_acquire);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include "ChunkPlan.h"
+#include "ChunkStitcher.h"
+#include "StemSeparator.h"
+#include "model.hpp"
+
+// Separates a live stereo stream with a fixed delay. The audio thread pushes input into a
+// lock-free FIFO and a background thread runs demucs on overlapping windows, crossfades
+// them and pushes the stems into a second FIFO, which the audio thread mixes back with
+// per-stem gains. Output lags the input by exactly getLatencySamples(): a window has to
+// be complete before it is separated, and the next hop is the budget for inference.
+//
+// Whenever there are no stems to play (model still loading, sample rate other than
+// 44.1 kHz, inference falling behind) the input is played through the same delay line
+// instead, so the latency never changes.
+class LiveSeparator : private juce::Thread
+{
+public:
+    using StemGains = std::array<float, StemSeparator::kNumStems>;
+
+    enum class State
+    {
+        idle,
+        loadingModel,
+        running,
+        modelMissing,
+        unsupportedSampleRate,
+        failed
+    };
+
+    static constexpr double kWindowSeconds = 6.0;
+    static constexpr double kOverlapSeconds = 1.0;
+
+    explicit LiveSeparator(const juce::File& modelFile);
+    ~LiveSeparator() override;
+
+    // Not realtime safe. Stops the worker, resizes every buffer and starts again.
+    void prepare(double sampleRate, int maximumBlockSize);
+    void release();
+
+    int getLatencySamples() const { return mLatencySamples; }
+
+    // Realtime safe; never allocates, locks or waits. Works in place, numSamples must not
+    // exceed the block size passed to prepare().
+    void process(juce::AudioBuffer<float>& buffer, int numSamples, const StemGains& gains);
+
+    State getState() const { return mState.load(); }
+    juce::String getStatusText() const;
+
+    // Times the worker couldn't deliver stems in time, and times the input FIFO filled up
+    // and the stream had to be restarted
+    int getNumUnderruns() const { return mNumUnderruns.load(); }
+    int getNumRestarts() const { return mNumRestarts.load(); }
+
+private:
+    struct Aborted {};
+
+    void run() override; // Thread
+    bool loadModel();
+    bool separateNextWindow();
+    bool writeStems(const juce::AudioBuffer<float>& block, int numSamples);
+    bool shouldAbort() const;
+
+    void readDelayedDry(const juce::AudioBuffer<float>& buffer, int numSamples);
+    void mixStems(juce::AudioBuffer<float>& buffer, int offset, int numSamples, const StemGains& gains);
+    void requestRestart();
+
+    const juce::File mModelFile;
+    std::unique_ptr<demucscpp::demucs_model> mModel;
+    std::atomic<State> mState { State::idle };
+
+    int mWindowSamples { 0 };
+    int mOverlapSamples { 0 };
+    int mHopSamples { 0 };
+    int mLatencySamples { 0 };
+
+    // Audio thread -> worker
+    juce::AbstractFifo mInputFifo { 1 };
+    juce::AudioBuffer<float> mInputRing;
+
+    // Worker -> audio thread, stem s / channel c in channel s * 2 + c
+    juce::AbstractFifo mOutputFifo { 1 };
+    juce::AudioBuffer<float> mOutputRing;
+
+    // Set by the audio thread to ask the worker to empty both FIFOs and start a new
+    // stream; cleared by the worker once it has. The audio thread leaves the FIFOs alone
+    // in between, which is what makes resetting them safe.
+    std::atomic<bool> mRestartRequested { true };
+
+    // Audio thread state
+    juce::AudioBuffer<float> mDryDelay;
+    juce::AudioBuffer<float> mDryScratch;
+    int mDryDelayPosition { 0 };
+    bool mWaitingForRestart { true };
+    juce::int64 mSamplesSinceRestart { 0 };
+    int mSamplesToSkip { 0 };
+    StemGains mLastGains {};
+
+    // Worker state
+    juce::AudioBuffer<float> mWindow;
+    Eigen::MatrixXf mWindowMatrix;
+    ChunkStitcher mStitcher;
+    int mWindowIndex { 0 };
+
+    std::atomic<int> mNumUnderruns { 0 };
+    std::atomic<int> mNumRestarts { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LiveSeparator)
+};
@@ -1,23 +1,40 @@
 #include "MainComponent.h"
 #include <memory>
+#include <utility>
 
 MainComponent::MainComponent()
     : Thread("DemucsProcessingThread")
 {
-    setSize(800, 600);
+    setSize(900, 1000);
 
     addAndMakeVisible(mOpenButton);
     addAndMakeVisible(mProcessButton);
+    addAndMakeVisible(mQueueButton);
+    addAndMakeVisible(mStreamingToggle);
+    addAndMakeVisible(mChunkWorkersBox);
+    addAndMakeVisible(mCacheToggle);
+    addAndMakeVisible(mPreviewToggle);
+    addAndMakeVisible(mOutputFormatBox);
+    addAndMakeVisible(mModelBox);
+    addAndMakeVisible(mSourceRateToggle);
+    addAndMakeVisible(mServerToggle);
+    addAndMakeVisible(mAutoThreadsToggle);
+    addAndMakeVisible(mPlayableRangeView);
+    addAndMakeVisible(mTraceSummary);
+    addAndMakeVisible(mStemPlayer);
     addAndMakeVisible(mLogArea);
     addAndMakeVisible(mStatusLabel);
     addAndMakeVisible(mProgressBar);
 
     mOpenButton.onClick = [this]()
     {
+        juce::AudioFormatManager chooserFormats;
+        chooserFormats.registerBasicFormats();
+
         mFileChooser = std::make_unique<juce::FileChooser>(
-            "Select a 44.1kHz stereo WAV file...",
+            "Select an audio file...",
             juce::File{},
-            "*.wav");
+            chooserFormats.getWildcardForAllFormats());
 
         mFileChooser->launchAsync(juce::FileBrowserComponent::openMode | 
                            juce::FileBrowserComponent::canSelectFiles,
@@ -27,33 +44,18 @@ MainComponent::MainComponent()
                 {
                     auto file = fc.getResult();
                     
-                    // Check audio file properties
+                    // Any rate and channel count works, the separator converts to 44.1 kHz stereo
                     juce::AudioFormatManager formatManager;
                     formatManager.registerBasicFormats();
                     
                     if (auto reader = std::unique_ptr<juce::AudioFormatReader>(
                         formatManager.createReaderFor(file)))
                     {
-                        if (reader->sampleRate != 44100.0)
-                        {
-                            juce::AlertWindow::showMessageBoxAsync(
-                                juce::AlertWindow::WarningIcon,
-                                "Unsupported Sample Rate",
-                                "Only 44.1kHz audio files are supported.");
-                            return;
-                        }
-                        
-                        if (reader->numChannels != 2)
-                        {
-                            juce::AlertWindow::showMessageBoxAsync(
-                                juce::AlertWindow::WarningIcon,
-                                "Unsupported Channel Count",
-                                "Only stereo audio files are supported.");
-                            return;
-                        }
-
                         mSelectedFile = file;
-                        mProcessButton.setEnabled(mModel != nullptr);
+                        mSelectedFileLength = static_cast<juce::int64>(
+                            std::ceil(reader->lengthInSamples * StemSeparator::kSampleRate / reader->sampleRate));
+                        mProcessButton.setEnabled(mEnsemble != nullptr || mUseServer);
+                        mQueueButton.setEnabled(mJobQueue != nullptr);
                         updateProgressMessage("Audio file selected: " + mSelectedFile.getFileName());
                     }
                     else
@@ -75,24 +77,142 @@ MainComponent::MainComponent()
             mProcessButton.setEnabled(false);
             updateProgressMessage("Stopping...");
         }
-        else if (mModel != nullptr)
+        else if (mEnsemble != nullptr || mUseServer)
         {
             mIsProcessing = true;
             mProcessButton.setButtonText("Stop");
             mOpenButton.setEnabled(false);
+            mModelBox.setEnabled(false);
             startThread();
         }
     };
 
+    // Queued jobs survive restarts and resume from their cached chunks
+    try
+    {
+        mJobQueue = std::make_unique<JobQueue>(JobQueue::getDefaultQueueFile());
+        mJobQueue->onJobFinished = [this](const JobQueue::Job& job)
+        {
+            updateProgressMessage("Job " + job.inputFile.getFileName() + ": " + JobQueue::getStateName(job.state)
+                                  + (job.message.isNotEmpty() ? " (" + job.message + ")" : juce::String()));
+        };
+        mJobQueue->onFileDamaged = [this](const juce::String& error)
+        {
+            updateProgressMessage("Job queue: " + error);
+        };
+
+        mJobQueueComponent = std::make_unique<JobQueueComponent>(*mJobQueue);
+        addAndMakeVisible(*mJobQueueComponent);
+    }
+    catch (const std::exception& e)
+    {
+        mJobQueue.reset();
+        updateProgressMessage("Job queue unavailable: " + juce::String(e.what()));
+    }
+
+    mQueueButton.onClick = [this]()
+    {
+        if (mJobQueue == nullptr || !mSelectedFile.existsAsFile())
+            return;
+
+        try
+        {
+            mJobQueue->addJob(mSelectedFile, StemSeparator::getDefaultOutputDirectory(mSelectedFile));
+            updateProgressMessage("Queued " + mSelectedFile.getFileName());
+        }
+        catch (const std::exception& e)
+        {
+            updateProgressMessage("Could not queue file: " + juce::String(e.what()));
+        }
+    };
+
+    mStreamingToggle.onClick = [this]()
+    {
+        mStreamingEnabled = mStreamingToggle.getToggleState();
+        mChunkWorkersBox.setEnabled(mStreamingEnabled);
+    };
+
+    mCacheToggle.setToggleState(mCacheEnabled, juce::dontSendNotification);
+    mCacheToggle.onClick = [this]()
+    {
+        mCacheEnabled = mCacheToggle.getToggleState();
+    };
+
+    mServerToggle.onClick = [this]()
+    {
+        mUseServer = mServerToggle.getToggleState();
+        mProcessButton.setEnabled(mSelectedFile.existsAsFile() && (mEnsemble != nullptr || mUseServer));
+    };
+
+    mAutoThreadsToggle.onClick = [this]()
+    {
+        mAutoThreads = mAutoThreadsToggle.getToggleState();
+    };
+
+    mSourceRateToggle.onClick = [this]()
+    {
+        mKeepSourceRate = mSourceRateToggle.getToggleState();
+    };
+
+    mPreviewToggle.onClick = [this]()
+    {
+        mPreviewEnabled = mPreviewToggle.getToggleState();
+    };
+
+    // Parallel chunk workers only apply to the streaming path
+    for (int workers = 1; workers <= juce::SystemStats::getNumPhysicalCpus(); workers *= 2)
+        mChunkWorkersBox.addItem(juce::String(workers) + (workers == 1 ? " worker" : " workers"), workers);
+    mChunkWorkersBox.setSelectedId(1, juce::dontSendNotification);
+    mChunkWorkersBox.setEnabled(false);
+    mChunkWorkersBox.onChange = [this]()
+    {
+        mNumChunkWorkers = juce::jmax(1, mChunkWorkersBox.getSelectedId());
+    };
+
+    // Item ids are OutputFormat values + 1
+    mOutputFormatBox.addItemList({ "16-bit WAV", "24-bit WAV", "32-bit float WAV", "16-bit FLAC", "24-bit FLAC" }, 1);
+    mOutputFormatBox.setSelectedId(static_cast<int>(mOutputFormat.load()) + 1, juce::dontSendNotification);
+    mOutputFormatBox.onChange = [this]()
+    {
+        mOutputFormat = static_cast<StemSeparator::OutputFormat>(juce::jmax(0, mOutputFormatBox.getSelectedId() - 1));
+    };
+
+    // Item ids are preset indices + 1, presets with missing files are downloaded when picked
+    updateModelBox();
+    mModelBox.onChange = [this]()
+    {
+        const auto& presets = ModelRegistry::getPresets();
+        const int index = mModelBox.getSelectedId() - 1;
+        if (!juce::isPositiveAndBelow(index, (int) presets.size()) || &presets[(size_t) index] == mPreset)
+            return;
+
+        const auto& preset = presets[(size_t) index];
+        if (!ModelRegistry::getMissingFiles(preset, ModelDownloader::getModelDirectory()).isEmpty())
+        {
+            updateModelBox();
+            downloadPreset(preset);
+            return;
+        }
+
+        mPreset = &preset;
+        loadModel();
+    };
+
     mLogArea.setMultiLine(true);
     mLogArea.setReadOnly(true);
     mLogArea.setCaretVisible(false);
 
     mProcessButton.setEnabled(false);
+    mQueueButton.setEnabled(false);
+
+    startTimerHz(30);
 
-    if (ModelDownloader::getDefaultModelFile().exists())
+    const auto available = ModelRegistry::getAvailablePresets(ModelDownloader::getModelDirectory());
+    if (!available.empty())
     {
-        mModelFile = ModelDownloader::getDefaultModelFile();
+        const auto& defaultPreset = ModelRegistry::getDefaultPreset();
+        const bool hasDefault = std::find(available.begin(), available.end(), &defaultPreset) != available.end();
+        mPreset = hasDefault ? &defaultPreset : available.front();
         loadModel();
     }
     else
@@ -104,45 +224,21 @@ MainComponent::MainComponent()
             "OK",
             this,
             juce::ModalCallbackFunction::create(
-                [this](int result)
+                [this](int)
                 {
-                    mDownloader = std::make_unique<ModelDownloader>(
-                        [this](bool wasSuccessful, const juce::String& error)
-                        {
-                            if (wasSuccessful)
-                            {
-                                mModelFile = ModelDownloader::getDefaultModelFile();
-                                loadModel();
-
-                                juce::AlertWindow::showMessageBoxAsync(
-                                    juce::AlertWindow::InfoIcon,
-                                    "Success",
-                                    "Model downloaded successfully!");
-                            }
-                            else
-                            {
-                                juce::AlertWindow::showMessageBoxAsync(
-                                    juce::AlertWindow::WarningIcon,
-                                    "Download Failed",
-                                    "Failed to download model: " + error);
-                            }
-                            
-                            mDownloader.reset();
-                        },
-                        [this](float progress, const juce::String& message)
-                        {
-                            updateProgressMessage(message);
-                        });
-
-                    mDownloader->startThread();
+                    downloadPreset(ModelRegistry::getDefaultPreset());
                 }));
     }
 }
 
 MainComponent::~MainComponent()
 {
+    stopTimer();
     signalThreadShouldExit();
     stopThread(3000);
+
+    if (mJobQueue != nullptr)
+        mJobQueue->stopRunning();
 }
 
 void MainComponent::paint(juce::Graphics& g)
@@ -155,9 +251,33 @@ void MainComponent::resized()
     auto area = getLocalBounds().reduced(20);
     auto topArea = area.removeFromTop(40);
 
-    mOpenButton.setBounds(topArea.removeFromLeft(150));
+    mOpenButton.setBounds(topArea.removeFromLeft(130));
+    topArea.removeFromLeft(10);
+    mProcessButton.setBounds(topArea.removeFromLeft(100));
     topArea.removeFromLeft(10);
-    mProcessButton.setBounds(topArea.removeFromLeft(150));
+    mQueueButton.setBounds(topArea.removeFromLeft(110));
+    topArea.removeFromLeft(10);
+    mSourceRateToggle.setBounds(topArea.removeFromLeft(240));
+    topArea.removeFromLeft(10);
+    mServerToggle.setBounds(topArea.removeFromLeft(200));
+
+    area.removeFromTop(10);
+    auto optionsArea = area.removeFromTop(30);
+    mStreamingToggle.setBounds(optionsArea.removeFromLeft(200));
+    optionsArea.removeFromLeft(10);
+    mChunkWorkersBox.setBounds(optionsArea.removeFromLeft(120).reduced(0, 3));
+    optionsArea.removeFromLeft(10);
+    mCacheToggle.setBounds(optionsArea.removeFromLeft(170));
+    optionsArea.removeFromLeft(10);
+    mPreviewToggle.setBounds(optionsArea.removeFromLeft(170));
+    optionsArea.removeFromLeft(10);
+    mOutputFormatBox.setBounds(optionsArea.removeFromLeft(150).reduced(0, 3));
+
+    area.removeFromTop(10);
+    auto modelArea = area.removeFromTop(30);
+    mModelBox.setBounds(modelArea.removeFromLeft(360).reduced(0, 3));
+    modelArea.removeFromLeft(10);
+    mAutoThreadsToggle.setBounds(modelArea.removeFromLeft(220));
 
     area.removeFromTop(10);
     mStatusLabel.setBounds(area.removeFromTop(30));
@@ -166,30 +286,162 @@ void MainComponent::resized()
     auto progressArea = area.removeFromTop(20);
     mProgressBar.setBounds(progressArea);
 
+    area.removeFromTop(6);
+    mPlayableRangeView.setBounds(area.removeFromTop(14));
+
+    area.removeFromTop(10);
+    mTraceSummary.setBounds(area.removeFromTop(juce::jmin(140, area.getHeight() / 3)));
+
+    area.removeFromTop(10);
+    mStemPlayer.setBounds(area.removeFromTop(juce::jmin(34 + StemSeparator::kNumStems * 30, area.getHeight() / 2)));
+
+    if (mJobQueueComponent != nullptr)
+    {
+        area.removeFromTop(10);
+        mJobQueueComponent->setBounds(area.removeFromTop(juce::jmin(200, area.getHeight() / 2)));
+    }
+
     area.removeFromTop(10);
     mLogArea.setBounds(area);
 }
 
 void MainComponent::loadModel()
 {
+    if (mPreset == nullptr)
+        return;
+
+    // The queue runner holds on to the current models
+    if (mJobQueue != nullptr)
+        mJobQueue->stopRunning();
+
+    mModelBox.setSelectedId(static_cast<int>(mPreset - ModelRegistry::getPresets().data()) + 1, juce::dontSendNotification);
+
     try
     {
-        updateProgressMessage("Loading model...");
-        mModel = std::make_unique<demucscpp::demucs_model>();
-        if (!demucscpp::load_demucs_model(mModelFile.getFullPathName().toStdString(), mModel.get()))
+        // Drop the previous models first, so two sets of weights are never resident at once
+        mSeparator.reset();
+        mEnsemble.reset();
+
+        // Tuned on the previous model's first member
+        mThreadPlan.reset();
+
+        updateProgressMessage("Loading " + mPreset->name + "...");
+        std::vector<ModelLoader::Stats> stats;
+        mEnsemble = ModelRegistry::load(*mPreset, ModelDownloader::getModelDirectory(), &stats);
+        mSeparator = std::make_unique<StemSeparator>(mEnsemble);
+        updateProgressMessage("Model loaded successfully, " + juce::String(mEnsemble->getNumStems()) + " stems");
+        for (const auto& modelStats : stats)
+            updateProgressMessage(modelStats.toString());
+
+        try
         {
-            throw std::runtime_error("Failed to load model");
+            mCache = std::make_shared<StemCache>(StemCache::getDefaultDirectory(), mEnsemble->getModelFiles(),
+                                                 mEnsemble->getWeightsTag(), StemCache::kDefaultMaxBytes);
         }
-        updateProgressMessage("Model loaded successfully");
+        catch (const std::exception& e)
+        {
+            mCache.reset();
+            updateProgressMessage("Stem cache disabled: " + juce::String(e.what()));
+        }
+
         mProcessButton.setEnabled(mSelectedFile.exists());
+        startJobQueue();
     }
     catch (const std::exception& e)
     {
-        mModel.reset();
+        mSeparator.reset();
+        mEnsemble.reset();
         updateProgressMessage("Error loading model: " + juce::String(e.what()));
     }
 }
 
+void MainComponent::downloadPreset(const ModelRegistry::Preset& preset)
+{
+    if (mDownloader != nullptr)
+    {
+        updateProgressMessage("A model download is already running");
+        return;
+    }
+
+    mDownloader = std::make_unique<ModelDownloader>(
+        ModelRegistry::getMissingFiles(preset, ModelDownloader::getModelDirectory()),
+        ModelDownloader::Options(),
+        [this, &preset](bool wasSuccessful, const juce::String& error)
+        {
+            if (wasSuccessful && mIsProcessing)
+            {
+                // Loading frees the models the processing thread is using
+                mPendingPreset = &preset;
+                updateModelBox();
+                updateProgressMessage(preset.name + " downloaded, it loads when processing is done");
+            }
+            else if (wasSuccessful)
+            {
+                mPreset = &preset;
+                updateModelBox();
+                loadModel();
+
+                juce::AlertWindow::showMessageBoxAsync(
+                    juce::AlertWindow::InfoIcon,
+                    "Success",
+                    "Model downloaded successfully!");
+            }
+            else
+            {
+                juce::AlertWindow::showMessageBoxAsync(
+                    juce::AlertWindow::WarningIcon,
+                    "Download Failed",
+                    "Failed to download model: " + error + "\nPick it again to resume the download.");
+            }
+
+            // Not from inside the downloader's own callback
+            juce::MessageManager::callAsync([safeThis = juce::Component::SafePointer<MainComponent>(this)]
+            {
+                if (safeThis != nullptr)
+                    safeThis->mDownloader.reset();
+            });
+        },
+        [this](float progress, const juce::String& message)
+        {
+            updateProgressMessage(message, progress);
+        });
+
+    mDownloader->startThread();
+}
+
+void MainComponent::updateModelBox()
+{
+    const auto modelDirectory = ModelDownloader::getModelDirectory();
+    const auto& presets = ModelRegistry::getPresets();
+
+    mModelBox.clear(juce::dontSendNotification);
+    for (size_t i = 0; i < presets.size(); ++i)
+    {
+        const auto& preset = presets[i];
+        const bool available = ModelRegistry::getMissingFiles(preset, modelDirectory).isEmpty();
+        mModelBox.addItem(preset.name + " - " + preset.description + (available ? "" : " (download)"), (int) i + 1);
+    }
+
+    if (mPreset != nullptr)
+        mModelBox.setSelectedId(static_cast<int>(mPreset - presets.data()) + 1, juce::dontSendNotification);
+}
+
+void MainComponent::startJobQueue()
+{
+    if (mJobQueue == nullptr || mEnsemble == nullptr)
+        return;
+
+    StemSeparator::Options options;
+    options.streaming = true;
+    options.numChunkWorkers = mNumChunkWorkers;
+    options.cache = mCache;
+    options.outputFormat = mOutputFormat;
+    options.keepSourceSampleRate = mKeepSourceRate;
+
+    if (!mJobQueue->startRunning(mEnsemble, options))
+        updateProgressMessage("Job queue is being run by another process");
+}
+
 void MainComponent::run()
 {
     try
@@ -198,132 +450,256 @@ void MainComponent::run()
     }
     catch (const std::exception& e)
     {
-        juce::MessageManager::callAsync([this, error = std::string(e.what())]()
+        updateProgressMessage("Error: " + juce::String(e.what()));
+        juce::MessageManager::callAsync([safeThis = juce::Component::SafePointer<MainComponent>(this)]()
         {
-            updateProgressMessage("Error: " + juce::String(error));
-            resetProcessingState();
+            if (safeThis != nullptr)
+                safeThis->resetProcessingState();
         });
     }
 }
 
 void MainComponent::processAudioFile()
 {
-    updateProgressMessage("Processing audio file...", 0.0f);
+    if (mUseServer)
+    {
+        processOnServer();
+        return;
+    }
 
-    if (!mModel)
+    if (!mEnsemble || !mSeparator)
         throw std::runtime_error("Model not loaded");
 
-    // Load audio file
-    juce::AudioFormatManager formatManager;
-    formatManager.registerBasicFormats();
-    
-    auto reader = std::unique_ptr<juce::AudioFormatReader>(
-        formatManager.createReaderFor(mSelectedFile));
+    auto options = mSeparator->getOptions();
+    options.streaming = mStreamingEnabled;
+    options.numChunkWorkers = mNumChunkWorkers;
+    options.cache = mCacheEnabled ? mCache : nullptr;
+    options.outputFormat = mOutputFormat;
+    options.keepSourceSampleRate = mKeepSourceRate;
+    options.threadPlan = nullptr;
+
+    // Full quality, written chunk by chunk and flushed, so the start of the stems can be
+    // played within one chunk's inference time
+    options.flushAfterEveryChunk = mPreviewEnabled;
+    if (options.flushAfterEveryChunk)
+        options.streaming = true;
+
+    // Streaming splits the cores between chunk workers. A whole-file run gives them all to
+    // the BLAS threads of this thread and pins it, undone at the end as the thread outlives the run.
+    std::unique_ptr<ThreadTuner::ScopedPlan> wholeFilePlan;
+    if (mAutoThreads)
+    {
+        const auto topology = ThreadTuner::Topology::detect();
+        if (options.streaming)
+        {
+            if (mThreadPlan == nullptr)
+                mThreadPlan = std::make_shared<const ThreadTuner::Plan>(
+                    ThreadTuner::getTunedPlan(*mEnsemble->getMember(0).model, topology, false,
+                        [this](const juce::String& message) { updateProgressMessage(message); }));
+
+            options.threadPlan = mThreadPlan;
+            options.numChunkWorkers = mThreadPlan->numWorkers;
+        }
+        else
+        {
+            wholeFilePlan = std::make_unique<ThreadTuner::ScopedPlan>(ThreadTuner::makePlan(topology, 1), 0);
+        }
+    }
 
-    if (!reader)
-        throw std::runtime_error("Could not load audio file");
+    mSeparator->setOptions(options);
 
-    const int numSamples = static_cast<int>(reader->lengthInSamples);
-    Eigen::MatrixXf audioData(2, numSamples);
-    
-    juce::AudioBuffer<float> buffer(2, numSamples);
-    reader->read(&buffer, 0, numSamples, 0, true, true);
+    const auto outputDirectory = StemSeparator::getDefaultOutputDirectory(mSelectedFile);
+    // The queue may be recording at the same time, this run's spans are kept apart
+    const auto traceSession = std::make_shared<Trace::Session>();
+    DEMUCS_TRACE_SESSION(traceSession);
+    mPlayableRangeView.reset(mSelectedFileLength);
 
-    // Copy to Eigen matrix
-    for (int ch = 0; ch < 2; ++ch)
-    {
-        const float* channelData = buffer.getReadPointer(ch);
-        for (int i = 0; i < numSamples; ++i)
-            audioData(ch, i) = channelData[i];
-    }
+    auto onProgress = [this](float progress, const juce::String& message) {
+        updateProgressMessage(message, progress);
+    };
+    auto shouldCancel = [this]() {
+        return threadShouldExit();
+    };
 
-    updateProgressMessage("Running Demucs inference...");
-    
-    // Process with demucs
-    auto out_targets = demucscpp::demucs_inference(*mModel, audioData, 
-        [this](float progress, const std::string& message) {
-            if (threadShouldExit())
+    if (options.flushAfterEveryChunk)
+        updateProgressMessage("Stems are playable as they appear in " + outputDirectory.getFullPathName());
+
+    // A whole-file run can be auditioned from memory while its stems are encoded
+    juce::StringArray stemNames;
+    for (int stem = 0; stem < mEnsemble->getNumStems(); ++stem)
+        stemNames.add(mEnsemble->getStemName(stem));
+
+    const auto result = mSeparator->process(mSelectedFile, outputDirectory, onProgress, shouldCancel,
+        [this](juce::int64 numSamplesWritten) {
+            mPlayableRangeView.setWrittenEnd(numSamplesWritten);
+        },
+        [this, stemNames](std::shared_ptr<const Eigen::Tensor3dXf> stems) {
+            juce::MessageManager::callAsync([safeThis = juce::Component::SafePointer<MainComponent>(this),
+                                             stems = std::move(stems), stemNames]()
             {
-                throw std::runtime_error("Processing cancelled by user");
-            }
-            juce::MessageManager::callAsync([this, message, progress]() {
-                updateProgressMessage(message, progress);
+                if (safeThis != nullptr)
+                    safeThis->mStemPlayer.setStems(stems, StemSeparator::kSampleRate, stemNames);
             });
         });
-    
-    if (threadShouldExit())
+
+    updateProgressMessage("Scratch allocations: " + juce::String(result.scratchAllocations));
+
+    if (options.cache != nullptr)
+        updateProgressMessage("Reused " + juce::String(result.numCachedSegments) + " of "
+                              + juce::String(result.numSegments) + " segments from the cache");
+
+   #if DEMUCS_JUCE_TRACING
+    const auto traceFile = outputDirectory.getChildFile(mSelectedFile.getFileNameWithoutExtension() + "_trace.json");
+    if (traceSession->writeChromeTrace(traceFile))
+        updateProgressMessage("Trace written to " + traceFile.getFullPathName());
+   #endif
+
+    juce::MessageManager::callAsync([safeThis = juce::Component::SafePointer<MainComponent>(this),
+                                     stages = traceSession->summarise(), inputFile = mSelectedFile, outputDirectory,
+                                     numStems = mEnsemble->getNumStems()]() mutable
     {
-        throw std::runtime_error("Processing cancelled by user");
+        if (safeThis == nullptr)
+            return;
+
+        safeThis->mTraceSummary.setStages(std::move(stages));
+        safeThis->playStemFiles(inputFile, outputDirectory, numStems);
+        safeThis->resetProcessingState();
+    });
+}
+
+void MainComponent::processOnServer()
+{
+    // Connected on first use and kept, the server holds the model and the cache
+    if (mServerClient == nullptr || !mServerClient->isConnected())
+    {
+        mServerClient = std::make_unique<SeparationClient>();
+        if (!mServerClient->connect())
+            throw std::runtime_error("No DemucsServer of this user running on port " + std::to_string(SeparationProtocol::kDefaultPort));
     }
 
-    updateProgressMessage("Saving separated tracks...");
+    StemSeparator::Options options;
+    options.streaming = mStreamingEnabled;
+    options.numChunkWorkers = mNumChunkWorkers;
+    options.outputFormat = mOutputFormat;
+    options.keepSourceSampleRate = mKeepSourceRate;
+
+    updateProgressMessage("Sending " + mSelectedFile.getFileName() + " to DemucsServer");
+    const auto outputDirectory = StemSeparator::getDefaultOutputDirectory(mSelectedFile);
+    const auto result = mServerClient->separate(mSelectedFile, outputDirectory, options, mCacheEnabled,
+        [this](float progress, const juce::String& message) {
+            updateProgressMessage(message, progress);
+        },
+        [this]() {
+            return threadShouldExit();
+        });
 
-    // Create output directory
-    auto outputDir = mSelectedFile.getParentDirectory().getChildFile(mSelectedFile.getFileNameWithoutExtension() + "_stems");
-    outputDir.createDirectory();
+    updateProgressMessage("Server separated " + juce::String(result.audioSeconds, 1) + " s of audio in "
+                          + juce::String(result.wallSeconds, 1) + " s");
 
-    // Save each target
-    juce::WavAudioFormat wavFormat;
-    for (int target = 0; target < kNumStems; ++target)
+    // The server's model decides the stem count, its files are all there is to go by
+    juce::MessageManager::callAsync([safeThis = juce::Component::SafePointer<MainComponent>(this),
+                                     inputFile = mSelectedFile, outputDirectory]()
     {
-        if (threadShouldExit())
-        {
-            throw std::runtime_error("Processing cancelled by user");
-        }
+        if (safeThis == nullptr)
+            return;
 
-        auto outputFile = outputDir.getChildFile(
-            mSelectedFile.getFileNameWithoutExtension() + juce::String("_") + STEM_NAMES[target] + ".wav");
+        safeThis->playStemFiles(inputFile, outputDirectory, StemSeparator::kNumStems);
+        safeThis->resetProcessingState();
+    });
+}
 
-        std::unique_ptr<juce::AudioFormatWriter> writer(
-            wavFormat.createWriterFor(new juce::FileOutputStream(outputFile),
-                                    44100, 2, 16, {}, 0));
-        
-        if (writer)
-        {
-            juce::AudioBuffer<float> outBuffer(2, numSamples);
-            for (int ch = 0; ch < 2; ++ch)
-            {
-                float* channelData = outBuffer.getWritePointer(ch);
-                for (int i = 0; i < numSamples; ++i)
-                {
-                    channelData[i] = out_targets(target, ch, i);
-                }
-            }
-            
-            writer->writeFromAudioSampleBuffer(outBuffer, 0, numSamples);
-        }
-        
-        updateProgressMessage("Saved " + juce::String(STEM_NAMES[target]));
+void MainComponent::playStemFiles(const juce::File& inputFile, const juce::File& outputDirectory, int numStems)
+{
+    juce::Array<juce::File> files;
+    juce::StringArray names;
+    for (int stem = 0; stem < numStems; ++stem)
+    {
+        const auto file = StemSeparator::findStemFile(inputFile, outputDirectory, stem);
+        if (!file.existsAsFile())
+            break;
+
+        files.add(file);
+        names.add(StemSeparator::STEM_NAMES[stem]);
     }
 
-    updateProgressMessage("Processing complete!", 1.0f);
-    
-    juce::MessageManager::callAsync([this]()
+    try
     {
-        resetProcessingState();
-    });
+        mStemPlayer.setStemFiles(files, names);
+    }
+    catch (const std::exception& e)
+    {
+        updateProgressMessage("Stems can't be played: " + juce::String(e.what()));
+    }
 }
 
 void MainComponent::updateProgressMessage(const juce::String& message, float progress)
 {
-    juce::MessageManager::callAsync([this, message, progress]()
+    mTelemetry.push(message, progress);
+}
+
+void MainComponent::timerCallback()
+{
+    juce::StringArray lines;
+    mTelemetry.drain([&lines](const Telemetry::Record& record)
     {
-        mStatusLabel.setText(message, juce::dontSendNotification);
-        mLogArea.moveCaretToEnd();
-        mLogArea.insertTextAtCaret(message + "\n");
-        
-        if (progress >= 0.0f)
-        {
-            mProgress = progress;
-        }
+        lines.add(record.getText());
     });
+
+    const int numDropped = mTelemetry.getNumDropped();
+    if (numDropped != mNumDroppedShown)
+    {
+        lines.add("(" + juce::String(numDropped - mNumDroppedShown) + " messages dropped)");
+        mNumDroppedShown = numDropped;
+    }
+
+    if (!lines.isEmpty())
+    {
+        mStatusLabel.setText(lines[lines.size() - 1], juce::dontSendNotification);
+        appendToLog(lines);
+    }
+
+    const float progress = mTelemetry.getProgress();
+    if (progress >= 0.0f)
+        mProgress = progress;
+}
+
+void MainComponent::appendToLog(const juce::StringArray& lines)
+{
+    for (const auto& line : lines)
+        mLogLines.push_back(line);
+
+    // Trimming re-lays out the whole editor, so let the log run a quarter over before doing it
+    if (mLogLines.size() > (size_t) (kMaxLogLines + kMaxLogLines / 4))
+    {
+        while (mLogLines.size() > (size_t) kMaxLogLines)
+            mLogLines.pop_front();
+
+        juce::String text;
+        for (const auto& line : mLogLines)
+            text << line << "\n";
+
+        mLogArea.setText(text, false);
+        mLogArea.moveCaretToEnd();
+        return;
+    }
+
+    mLogArea.moveCaretToEnd();
+    mLogArea.insertTextAtCaret(lines.joinIntoString("\n") + "\n");
 }
 
 void MainComponent::resetProcessingState()
 {
     mIsProcessing = false;
+    mTelemetry.resetProgress();
     mProgress = 0.0;
     mProcessButton.setButtonText("Process");
     mProcessButton.setEnabled(true);
     mOpenButton.setEnabled(true);
+    mModelBox.setEnabled(true);
+
+    if (mPendingPreset != nullptr)
+    {
+        mPreset = std::exchange(mPendingPreset, nullptr);
+        loadModel();
+    }
 } 
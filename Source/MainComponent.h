@@ -2,10 +2,21 @@
 
 #include <JuceHeader.h>
 #include "model.hpp"
+#include "JobQueueComponent.h"
 #include "ModelDownloader.h"
+#include "ModelLoader.h"
+#include "ModelRegistry.h"
+#include "PlayableRangeView.h"
+#include "SeparationClient.h"
+#include "StemPlayerComponent.h"
+#include "StemSeparator.h"
+#include "Telemetry.h"
+#include "TraceSummaryTable.h"
+#include <deque>
 
 class MainComponent : public juce::Component,
-                     public juce::Thread
+                     public juce::Thread,
+                     private juce::Timer
 {
 public:
     MainComponent();
@@ -16,31 +27,76 @@ public:
 
 private:
     void run() override; // Thread
+    void timerCallback() override; // Timer
     void processAudioFile();
+    void processOnServer();
     void updateProgressMessage(const juce::String& message, float progress = -1.f);
     void loadModel();
+    void updateModelBox();
+    void downloadPreset(const ModelRegistry::Preset& preset);
     void resetProcessingState();
+    void appendToLog(const juce::StringArray& lines);
+    void playStemFiles(const juce::File& inputFile, const juce::File& outputDirectory, int numStems);
+    void startJobQueue();
 
     juce::TextButton mOpenButton { "Open Audio File" };
     juce::TextButton mProcessButton { "Process" };
+    juce::TextButton mQueueButton { "Add to Queue" };
+    juce::ToggleButton mStreamingToggle { "Low memory (streaming)" };
+    juce::ToggleButton mCacheToggle { "Reuse cached stems" };
+    juce::ToggleButton mPreviewToggle { "Playable while separating" };
+    juce::ToggleButton mSourceRateToggle { "Write stems at the input's rate" };
+    juce::ToggleButton mServerToggle { "Separate on DemucsServer" };
+    juce::ToggleButton mAutoThreadsToggle { "Tune threads for this CPU" };
+    PlayableRangeView mPlayableRangeView;
+    juce::ComboBox mChunkWorkersBox;
+    juce::ComboBox mOutputFormatBox;
+    juce::ComboBox mModelBox;
+    TraceSummaryTable mTraceSummary;
+    StemPlayerComponent mStemPlayer;
     juce::TextEditor mLogArea;
     juce::Label mStatusLabel { {}, "Status: Ready" };
     juce::ProgressBar mProgressBar { mProgress };
     double mProgress { 0.0 };
 
+    // Any thread reports through here, the timer shows it at a fixed rate
+    Telemetry mTelemetry;
+    int mNumDroppedShown { 0 };
+
+    // The log keeps the most recent lines only
+    static constexpr int kMaxLogLines = 2000;
+    std::deque<juce::String> mLogLines;
+
     juce::File mSelectedFile;
-    juce::File mModelFile;
-    std::unique_ptr<demucscpp::demucs_model> mModel;
+    juce::int64 mSelectedFileLength { 0 };
+    const ModelRegistry::Preset* mPreset { nullptr };
+
+    // Downloaded while a file was processing, loaded once it is done
+    const ModelRegistry::Preset* mPendingPreset { nullptr };
+    std::shared_ptr<const ModelEnsemble> mEnsemble;
+    std::unique_ptr<StemSeparator> mSeparator;
+    std::shared_ptr<StemCache> mCache;
+    std::unique_ptr<SeparationClient> mServerClient;
+
+    // Calibrated on the processing thread the first time it's needed after a model load
+    std::shared_ptr<const ThreadTuner::Plan> mThreadPlan;
+
+    // Declared after the model so the queue stops running before the model goes away
+    std::unique_ptr<JobQueue> mJobQueue;
+    std::unique_ptr<JobQueueComponent> mJobQueueComponent;
 
     std::unique_ptr<juce::FileChooser> mFileChooser;
     std::unique_ptr<ModelDownloader> mDownloader;
 
     std::atomic<bool> mIsProcessing { false };
-
-    static constexpr int kNumStems = 6;
-    static constexpr const char* STEM_NAMES[kNumStems] = { 
-        "drums", "bass", "other", "vocals", "guitar", "piano" 
-    };
+    std::atomic<bool> mStreamingEnabled { false };
+    std::atomic<bool> mCacheEnabled { true };
+    std::atomic<bool> mPreviewEnabled { false };
+    std::atomic<bool> mKeepSourceRate { false };
+    std::atomic<bool> mUseServer { false };
+    std::atomic<bool> mAutoThreads { false };
+    std::atomic<int> mNumChunkWorkers { 1 };
+    std::atomic<StemSeparator::OutputFormat> mOutputFormat { StemSeparator::OutputFormat::wav16 };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 }; 
@@ -0,0 +1,426 @@
+#include "ModelDownloader.h"
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace
+{
+    constexpr const char* kDefaultBaseUrl = "https://huggingface.co/datasets/Retrobear/demucs.cpp/resolve/main";
+    constexpr int kReadBytes = 64 * 1024;
+
+    struct RemoteFile
+    {
+        juce::int64 bytes { -1 };
+        bool supportsRanges { false };
+    };
+
+    juce::String formatMegabytes(juce::int64 bytes)
+    {
+        return juce::String(static_cast<double>(bytes) / (1024.0 * 1024.0), 1) + " MB";
+    }
+
+    // range is "<first>-<last>" or empty for the whole file
+    std::unique_ptr<juce::InputStream> openStream(const juce::URL& url, const juce::String& range, int timeoutMilliseconds,
+                                                  int& statusCode, juce::StringPairArray* responseHeaders = nullptr)
+    {
+        statusCode = 0;
+        return url.createInputStream(juce::URL::InputStreamOptions(juce::URL::ParameterHandling::inAddress)
+                                         .withExtraHeaders(range.isNotEmpty() ? "Range: bytes=" + range : juce::String())
+                                         .withConnectionTimeoutMs(timeoutMilliseconds)
+                                         .withStatusCode(&statusCode)
+                                         .withResponseHeaders(responseHeaders));
+    }
+
+    // Asks for the first byte: a 206 carries the size in Content-Range, a 200 means the
+    // server ignores ranges and sends the whole file
+    RemoteFile probe(const juce::URL& url, int timeoutMilliseconds)
+    {
+        int statusCode = 0;
+        juce::StringPairArray headers;
+        const auto stream = openStream(url, "0-0", timeoutMilliseconds, statusCode, &headers);
+
+        if (stream == nullptr)
+            throw std::runtime_error("Could not connect to " + url.toString(false).toStdString());
+
+        RemoteFile remote;
+        if (statusCode == 206)
+        {
+            remote.bytes = headers["Content-Range"].fromLastOccurrenceOf("/", false, false).getLargeIntValue();
+            remote.supportsRanges = remote.bytes > 0;
+        }
+        else if (statusCode == 200)
+        {
+            remote.bytes = stream->getTotalLength();
+        }
+        else
+        {
+            throw std::runtime_error("HTTP " + std::to_string(statusCode) + " for " + url.toString(false).toStdString());
+        }
+
+        if (remote.bytes <= 0)
+            throw std::runtime_error("The server didn't report the size of " + url.toString(false).toStdString());
+
+        return remote;
+    }
+
+    // Best effort, the manifest is optional unless Options::requireChecksum is set
+    void addManifestChecksums(const ModelDownloader::Options& options, std::map<juce::String, juce::String>& checksums)
+    {
+        int statusCode = 0;
+        const auto stream = openStream(juce::URL(options.baseUrl + "/manifest.json"), {}, options.timeoutMilliseconds, statusCode);
+        if (stream == nullptr || statusCode != 200)
+            return;
+
+        const auto manifest = juce::JSON::parse(stream->readEntireStreamAsString());
+        if (auto* object = manifest.getDynamicObject())
+            for (const auto& property : object->getProperties())
+                checksums.emplace(property.name.toString(), property.value.toString().trim());
+    }
+
+    // <name>.part.json lists the finished blocks of <name>.part. It only counts for the
+    // same URL, size and block size.
+    std::set<int> loadDoneBlocks(const juce::File& stateFile, const juce::File& partFile, const juce::URL& url,
+                                 juce::int64 bytes, juce::int64 blockBytes)
+    {
+        std::set<int> done;
+        if (!partFile.existsAsFile() || !stateFile.existsAsFile())
+            return done;
+
+        const auto state = juce::JSON::parse(stateFile);
+        if (state.getProperty("url", {}).toString() != url.toString(false)
+            || static_cast<juce::int64>(state.getProperty("bytes", 0)) != bytes
+            || static_cast<juce::int64>(state.getProperty("blockBytes", 0)) != blockBytes)
+            return done;
+
+        if (const auto* blocks = state.getProperty("done", {}).getArray())
+            for (const auto& block : *blocks)
+                done.insert(static_cast<int>(block));
+
+        return done;
+    }
+
+    void saveDoneBlocks(const juce::File& stateFile, const juce::URL& url, juce::int64 bytes, juce::int64 blockBytes,
+                        const std::set<int>& done)
+    {
+        juce::Array<juce::var> blocks;
+        for (const auto block : done)
+            blocks.add(block);
+
+        auto* object = new juce::DynamicObject();
+        object->setProperty("url", url.toString(false));
+        object->setProperty("bytes", bytes);
+        object->setProperty("blockBytes", blockBytes);
+        object->setProperty("done", blocks);
+
+        // Written next to the state file and renamed, so a crash never leaves half of it
+        juce::TemporaryFile temporary(stateFile);
+        if (temporary.getFile().replaceWithText(juce::JSON::toString(juce::var(object), true)))
+            temporary.overwriteTargetFileWithTemporary();
+    }
+
+    void sleepUnless(const std::atomic<bool>& abort, int milliseconds)
+    {
+        for (int slept = 0; slept < milliseconds && !abort; slept += 100)
+            juce::Thread::sleep(100);
+    }
+
+    void downloadFile(const juce::String& fileName,
+                      const ModelDownloader::Options& options,
+                      const juce::String& expectedChecksum,
+                      const std::function<void(float fileProgress, const juce::String& message)>& report,
+                      const ModelDownloader::CancelCallback& shouldCancel)
+    {
+        const juce::URL url(options.baseUrl + "/" + juce::URL::addEscapeChars(fileName, false));
+        const auto destination = options.directory.getChildFile(fileName);
+        const auto partFile = options.directory.getChildFile(fileName + ".part");
+        const auto stateFile = options.directory.getChildFile(fileName + ".part.json");
+
+        report(0.0f, "Connecting to " + url.getDomain());
+        const auto remote = probe(url, options.timeoutMilliseconds);
+
+        const auto blockBytes = remote.supportsRanges ? juce::jmax<juce::int64>(kReadBytes, options.blockBytes) : remote.bytes;
+        const int numBlocks = static_cast<int>((remote.bytes + blockBytes - 1) / blockBytes);
+
+        auto done = remote.supportsRanges ? loadDoneBlocks(stateFile, partFile, url, remote.bytes, blockBytes) : std::set<int>();
+        if (done.empty())
+        {
+            partFile.deleteFile();
+            stateFile.deleteFile();
+        }
+
+        auto getBlockLength = [&](int block)
+        {
+            return juce::jmin(blockBytes, remote.bytes - static_cast<juce::int64>(block) * blockBytes);
+        };
+
+        std::vector<int> pending;
+        juce::int64 resumedBytes = 0;
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            if (done.count(block) != 0)
+                resumedBytes += getBlockLength(block);
+            else
+                pending.push_back(block);
+        }
+
+        const int numConnections = juce::jlimit(1, juce::jmax(1, static_cast<int>(pending.size())),
+                                                remote.supportsRanges ? options.numConnections : 1);
+
+        report(static_cast<float>(resumedBytes) / static_cast<float>(remote.bytes),
+               (resumedBytes > 0 ? "Resuming at " + formatMegabytes(resumedBytes) + " of " : "Downloading ")
+                   + formatMegabytes(remote.bytes) + " over " + juce::String(numConnections)
+                   + (numConnections == 1 ? " connection" : " connections"));
+
+        // One handle shared by every connection: JUCE opens files for writing without
+        // sharing on Windows, and separate buffered streams on one file would interleave
+        // their flushes. Seek and write happen together under writeLock.
+        auto output = std::make_unique<juce::FileOutputStream>(partFile);
+        if (output->failedToOpen())
+            throw std::runtime_error("Could not write " + partFile.getFullPathName().toStdString());
+
+        std::mutex writeLock;
+
+        std::atomic<juce::int64> received { resumedBytes };
+        std::atomic<int> nextPending { 0 };
+        std::atomic<bool> abort { false };
+        std::mutex lock;
+        std::string error;
+        int numRunning = numConnections;
+        juce::WaitableEvent finished;
+
+        // Every connection writes its blocks at the block's offset
+        auto fetchBlock = [&](int block)
+        {
+            const auto start = static_cast<juce::int64>(block) * blockBytes;
+            const auto length = getBlockLength(block);
+
+            int statusCode = 0;
+            const auto stream = openStream(url, remote.supportsRanges ? juce::String(start) + "-" + juce::String(start + length - 1) : juce::String(),
+                                           options.timeoutMilliseconds, statusCode);
+            if (stream == nullptr || statusCode != (remote.supportsRanges ? 206 : 200))
+                return false;
+
+            juce::HeapBlock<char> buffer(kReadBytes);
+            juce::int64 blockReceived = 0;
+            while (blockReceived < length && !abort)
+            {
+                const int numRead = stream->read(buffer.get(), static_cast<int>(juce::jmin<juce::int64>(kReadBytes, length - blockReceived)));
+                if (numRead <= 0)
+                    break;
+
+                {
+                    const std::lock_guard<std::mutex> guard(writeLock);
+                    if (!output->setPosition(start + blockReceived) || !output->write(buffer.get(), static_cast<size_t>(numRead)))
+                        break;
+                }
+
+                blockReceived += numRead;
+                received += numRead;
+            }
+
+            if (blockReceived == length)
+            {
+                // On disk before the block is recorded as done
+                const std::lock_guard<std::mutex> guard(writeLock);
+                output->flush();
+                if (!output->getStatus().failed())
+                    return true;
+            }
+
+            received -= blockReceived;
+            return false;
+        };
+
+        juce::ThreadPool pool(numConnections);
+        for (int connection = 0; connection < numConnections; ++connection)
+        {
+            pool.addJob([&]
+            {
+                for (int index = nextPending++; index < static_cast<int>(pending.size()) && !abort; index = nextPending++)
+                {
+                    const int block = pending[(size_t) index];
+
+                    bool fetched = false;
+                    for (int attempt = 1; attempt <= options.maxAttempts && !fetched && !abort; ++attempt)
+                    {
+                        fetched = fetchBlock(block);
+                        if (!fetched && attempt < options.maxAttempts)
+                            sleepUnless(abort, juce::jmin(8000, 500 << attempt));
+                    }
+
+                    const std::lock_guard<std::mutex> guard(lock);
+                    if (!fetched)
+                    {
+                        if (!abort && error.empty())
+                            error = "Failed to download " + fileName.toStdString() + " after "
+                                  + std::to_string(options.maxAttempts) + " attempts, it resumes from "
+                                  + formatMegabytes(received).toStdString() + " next time";
+                        abort = true;
+                        break;
+                    }
+
+                    done.insert(block);
+                    if (remote.supportsRanges)
+                        saveDoneBlocks(stateFile, url, remote.bytes, blockBytes, done);
+                }
+
+                const std::lock_guard<std::mutex> guard(lock);
+                if (--numRunning == 0)
+                    finished.signal();
+            });
+        }
+
+        // Progress and cancellation are handled here, the connections only move bytes
+        while (!finished.wait(250))
+        {
+            if (shouldCancel && shouldCancel())
+                abort = true;
+
+            const auto bytes = received.load();
+            report(static_cast<float>(bytes) / static_cast<float>(remote.bytes),
+                   formatMegabytes(bytes) + " / " + formatMegabytes(remote.bytes));
+        }
+
+        if (shouldCancel && shouldCancel())
+            throw std::runtime_error("Download cancelled by user");
+
+        // Closed before the file is checked and moved, which Windows needs
+        output->flush();
+        const bool writeFailed = output->getStatus().failed();
+        output.reset();
+
+        if (writeFailed)
+            throw std::runtime_error("Could not write " + partFile.getFullPathName().toStdString());
+
+        if (!error.empty())
+            throw std::runtime_error(error);
+
+        auto discard = [&](const std::string& reason)
+        {
+            partFile.deleteFile();
+            stateFile.deleteFile();
+            throw std::runtime_error(reason + ": " + fileName.toStdString());
+        };
+
+        if (partFile.getSize() != remote.bytes)
+            discard("Downloaded size doesn't match");
+
+        if (expectedChecksum.isNotEmpty())
+        {
+            report(1.0f, "Verifying SHA-256");
+
+            juce::FileInputStream input(partFile);
+            if (input.failedToOpen() || !juce::SHA256(input).toHexString().equalsIgnoreCase(expectedChecksum))
+                discard("SHA-256 doesn't match the manifest");
+        }
+
+        if (!partFile.replaceFileIn(destination))
+            throw std::runtime_error("Could not move the download into place: " + destination.getFullPathName().toStdString());
+
+        stateFile.deleteFile();
+        report(1.0f, expectedChecksum.isNotEmpty() ? "Verified" : "Done, not in the manifest so only the size was checked");
+    }
+}
+
+ModelDownloader::ModelDownloader(CompletionCallback onComplete, ProgressCallback onProgress)
+    : ModelDownloader({ getDefaultModelFile().getFileName() }, Options(), std::move(onComplete), std::move(onProgress))
+{
+}
+
+ModelDownloader::ModelDownloader(juce::StringArray fileNames, Options options,
+                                 CompletionCallback onComplete, ProgressCallback onProgress)
+    : Thread("ModelDownloader"),
+      mFileNames(std::move(fileNames)),
+      mOptions(std::move(options)),
+      mOnComplete(std::move(onComplete)),
+      mOnProgress(std::move(onProgress))
+{
+}
+
+ModelDownloader::~ModelDownloader()
+{
+    stopThread(10000);
+}
+
+juce::String ModelDownloader::getDefaultBaseUrl()
+{
+    return juce::SystemStats::getEnvironmentVariable("DEMUCS_MODEL_URL", kDefaultBaseUrl).trimCharactersAtEnd("/");
+}
+
+void ModelDownloader::download(const juce::StringArray& fileNames, const Options& options,
+                               ProgressCallback onProgress, CancelCallback shouldCancel)
+{
+    if (!options.directory.createDirectory())
+        throw std::runtime_error("Failed to create model directory: " + options.directory.getFullPathName().toStdString());
+
+    juce::StringArray missing;
+    for (const auto& fileName : fileNames)
+        if (!options.directory.getChildFile(fileName).existsAsFile())
+            missing.add(fileName);
+
+    auto checksums = options.checksums;
+    for (const auto& fileName : missing)
+    {
+        if (checksums.count(fileName) == 0)
+        {
+            addManifestChecksums(options, checksums);
+            break;
+        }
+    }
+
+    // Checked up front, so nothing is fetched that couldn't be accepted
+    if (options.requireChecksum)
+        for (const auto& fileName : missing)
+            if (checksums[fileName].isEmpty())
+                throw std::runtime_error("No checksum for " + fileName.toStdString() + " in " + options.baseUrl.toStdString() + "/manifest.json");
+
+    for (int i = 0; i < missing.size(); ++i)
+    {
+        const auto& fileName = missing[i];
+        const auto prefix = (missing.size() > 1 ? "[" + juce::String(i + 1) + "/" + juce::String(missing.size()) + "] " : juce::String())
+                          + fileName + ": ";
+
+        downloadFile(fileName, options, checksums[fileName],
+            [&](float fileProgress, const juce::String& message) {
+                if (onProgress)
+                    onProgress((static_cast<float>(i) + fileProgress) / static_cast<float>(missing.size()), prefix + message);
+            },
+            shouldCancel);
+    }
+}
+
+void ModelDownloader::run()
+{
+    try
+    {
+        download(mFileNames, mOptions,
+            [this](float progress, const juce::String& message) { reportProgress(progress, message); },
+            [this] { return threadShouldExit(); });
+        success = true;
+    }
+    catch (const std::exception& e)
+    {
+        success = false;
+        errorMessage = e.what();
+    }
+
+    if (mOnComplete)
+    {
+        juce::MessageManager::callAsync([this]()
+        {
+            mOnComplete(success, errorMessage);
+        });
+    }
+}
+
+void ModelDownloader::reportProgress(float progress, const juce::String& message)
+{
+    if (mOnProgress)
+    {
+        juce::MessageManager::callAsync([this, progress, message]()
+        {
+            mOnProgress(progress, message);
+        });
+    }
+}
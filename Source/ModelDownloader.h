@@ -2,20 +2,51 @@
 
 #include <JuceHeader.h>
 #include <functional>
+#include <map>
 
+// Fetches model files into the model directory. Files are split into blocks that are
+// requested with HTTP ranges over several connections and written to <name>.part, with
+// the finished blocks recorded next to it, so an interrupted download resumes where it
+// stopped. A file is only renamed into place once its size and, when the manifest lists
+// it, its SHA-256 match. Servers without range support get one plain connection.
 class ModelDownloader : public juce::Thread
 {
 public:
     using CompletionCallback = std::function<void(bool wasSuccessful, const juce::String& error)>;
     using ProgressCallback = std::function<void(float progress, const juce::String& message)>;
+    using CancelCallback = std::function<bool()>;
 
-    ModelDownloader(CompletionCallback onComplete, ProgressCallback onProgress) 
-        : Thread("ModelDownloader"),
-          mOnComplete(std::move(onComplete)),
-          mOnProgress(std::move(onProgress))
+    struct Options
     {
-        modelUrl = "https://huggingface.co/datasets/Retrobear/demucs.cpp/resolve/main/ggml-model-htdemucs-6s-f16.bin";
-    }
+        // Files are fetched from <baseUrl>/<file name>
+        juce::String baseUrl { getDefaultBaseUrl() };
+        juce::File directory { getModelDirectory() };
+
+        int numConnections { 4 };
+        juce::int64 blockBytes { 8 * 1024 * 1024 };
+        int maxAttempts { 5 };
+        int timeoutMilliseconds { 15000 };
+
+        // Expected SHA-256 (hex) by file name. Files missing here are looked up in
+        // <baseUrl>/manifest.json, a JSON object of the same shape.
+        std::map<juce::String, juce::String> checksums;
+
+        // Fail instead of accepting a file that no manifest lists
+        bool requireChecksum { false };
+    };
+
+    // Downloads the default model
+    ModelDownloader(CompletionCallback onComplete, ProgressCallback onProgress);
+
+    // Downloads the files that aren't in options.directory yet. Callbacks run on the message thread.
+    ModelDownloader(juce::StringArray fileNames, Options options, CompletionCallback onComplete, ProgressCallback onProgress);
+    ~ModelDownloader() override;
+
+    // The same, blocking, with callbacks on the calling thread. Throws std::runtime_error
+    // on failure or when shouldCancel returns true; finished files stay in place and
+    // unfinished ones resume next time.
+    static void download(const juce::StringArray& fileNames, const Options& options,
+                         ProgressCallback onProgress = {}, CancelCallback shouldCancel = {});
 
     static juce::File getModelDirectory()
     {
@@ -28,166 +59,23 @@ public:
         return getModelDirectory().getChildFile("ggml-model-htdemucs-6s-f16.bin");
     }
 
-    void run() override
-    {
-        DBG("ModelDownloader: Starting download process");
-        
-        auto modelDir = getModelDirectory();
-        DBG("ModelDownloader: Model directory path: " + modelDir.getFullPathName());
-        
-        if (!modelDir.exists())
-        {
-            DBG("ModelDownloader: Creating model directory");
-            reportProgress(0.0f, "Creating model directory...");
-            if (!modelDir.createDirectory())
-            {
-                DBG("ModelDownloader: Failed to create directory");
-                success = false;
-                errorMessage = "Failed to create model directory: " + modelDir.getFullPathName();
-                return;
-            }
-        }
-
-        auto destFile = getDefaultModelFile();
-        DBG("ModelDownloader: Destination file path: " + destFile.getFullPathName());
-        
-        reportProgress(0.0f, "Connecting to server...");
-        DBG("ModelDownloader: Connecting to URL: " + modelUrl);
-        
-        juce::URL url(modelUrl);
-        auto stream = url.createInputStream(false);
-        if (stream == nullptr)
-        {
-            DBG("ModelDownloader: Failed to create input stream");
-            success = false;
-            errorMessage = "Failed to connect to download server";
-            return;
-        }
-
-        const int64 totalSize = stream->getTotalLength();
-        const float totalSizeMB = totalSize / (1024.0f * 1024.0f);
-        
-        DBG("ModelDownloader: Total file size: " + juce::String(totalSizeMB, 1) + " MB");
-        reportProgress(0.0f, "Starting download (" + juce::String(totalSizeMB, 1) + " MB)...");
-        
-        juce::FileOutputStream outputStream(destFile);
-        if (outputStream.failedToOpen())
-        {
-            DBG("ModelDownloader: Failed to create output file: " + destFile.getFullPathName());
-            success = false;
-            errorMessage = "Failed to create output file: " + destFile.getFullPathName();
-            return;
-        }
-
-        juce::MemoryBlock buffer(8192);
-        int64 downloaded = 0;
-        int lastPercentage = 0;
-        int readAttempts = 0;
-        const int maxReadAttempts = 3;
-
-        while (!threadShouldExit())
-        {
-            const int numRead = stream->read(buffer.getData(), buffer.getSize());
-            if (numRead < 0)
-            {
-                DBG("ModelDownloader: Read error occurred");
-                break;
-            }
-            else if (numRead == 0)
-            {
-                readAttempts++;
-                DBG("ModelDownloader: Zero bytes read (attempt " + juce::String(readAttempts) + " of " + juce::String(maxReadAttempts) + ")");
-                if (readAttempts >= maxReadAttempts)
-                {
-                    DBG("ModelDownloader: Max read attempts reached");
-                    break;
-                }
-                juce::Thread::sleep(1000); // Wait a second before retry
-                continue;
-            }
-
-            readAttempts = 0; // Reset counter on successful read
-            
-            if (!outputStream.write(buffer.getData(), numRead))
-            {
-                DBG("ModelDownloader: Failed to write to output file");
-                success = false;
-                errorMessage = "Failed to write to output file";
-                return;
-            }
-
-            downloaded += numRead;
-            DBG("ModelDownloader: Downloaded " + juce::String(downloaded / (1024.0f * 1024.0f), 1) + " MB");
-
-            if (totalSize > 0)
-            {
-                const float progress = downloaded / (double)totalSize;
-                int currentPercentage = static_cast<int>(progress * 100);
-                if (currentPercentage / 10 > lastPercentage / 10)
-                {
-                    const float downloadedMB = downloaded / (1024.0f * 1024.0f);
-                    auto progressMsg = juce::String(currentPercentage) + "% completed (" + 
-                                     juce::String(downloadedMB, 1) + " MB / " + 
-                                     juce::String(totalSizeMB, 1) + " MB)";
-                    DBG("ModelDownloader: " + progressMsg);
-                    reportProgress(progress, progressMsg);
-                    lastPercentage = currentPercentage;
-                }
-            }
-        }
-
-        if (threadShouldExit())
-        {
-            DBG("ModelDownloader: Download cancelled by user");
-            reportProgress(1.0f, "Download cancelled");
-            success = false;
-            errorMessage = "Download cancelled by user";
-        }
-        else if (downloaded == totalSize)
-        {
-            DBG("ModelDownloader: Download completed successfully");
-            reportProgress(1.0f, "Download completed successfully");
-            success = true;
-        }
-        else
-        {
-            DBG("ModelDownloader: Download incomplete. Expected: " + juce::String(totalSize) + 
-                " bytes, Got: " + juce::String(downloaded) + " bytes");
-            success = false;
-            errorMessage = "Download incomplete or corrupted";
-        }
-
-        outputStream.flush();
-        
-        // 完了通知
-        if (mOnComplete)
-        {
-            DBG("ModelDownloader: Sending completion callback");
-            juce::MessageManager::callAsync([this]()
-            {
-                mOnComplete(success, errorMessage);
-            });
-        }
-    }
+    // The demucs.cpp model repository, or $DEMUCS_MODEL_URL, e.g. a local mirror
+    static juce::String getDefaultBaseUrl();
+
+    void run() override;
 
     bool wasSuccessful() const { return success; }
     const juce::String& getError() const { return errorMessage; }
 
 private:
-    void reportProgress(float progress, const juce::String& message)
-    {
-        if (mOnProgress)
-        {
-            juce::MessageManager::callAsync([this, progress, message]()
-            {
-                mOnProgress(progress, message);
-            });
-        }
-    }
+    void reportProgress(float progress, const juce::String& message);
 
-    juce::String modelUrl;
+    juce::StringArray mFileNames;
+    Options mOptions;
     bool success = false;
     juce::String errorMessage;
     CompletionCallback mOnComplete;
     ProgressCallback mOnProgress;
-}; 
\ No newline at end of file
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ModelDownloader)
+};
@@ -0,0 +1,175 @@
+#include <JuceHeader.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "ModelDownloader.h"
+
+namespace
+{
+    // Serves one file over HTTP with byte ranges, as the model repository does, slowly
+    // enough that the downloader's connections overlap
+    class RangeServer : private juce::Thread
+    {
+    public:
+        RangeServer(const juce::String& fileName, const juce::MemoryBlock& data)
+            : Thread("RangeServer"), mPath("/" + fileName), mData(data)
+        {
+            if (mSocket.createListener(0, "127.0.0.1"))
+                startThread();
+        }
+
+        ~RangeServer() override
+        {
+            signalThreadShouldExit();
+            mSocket.close();
+            stopThread(5000);
+
+            for (auto& connection : mConnections)
+                connection.join();
+        }
+
+        int getPort() const { return mSocket.getBoundPort(); }
+        int getNumRangeRequests() const { return mNumRangeRequests; }
+        int getMaxConcurrentRequests() const { return mMaxConcurrentRequests; }
+
+    private:
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                auto* client = mSocket.waitForNextConnection();
+                if (client == nullptr)
+                    break;
+
+                mConnections.emplace_back([this, client] { serve(std::unique_ptr<juce::StreamingSocket>(client)); });
+            }
+        }
+
+        void serve(std::unique_ptr<juce::StreamingSocket> client)
+        {
+            juce::String request;
+            while (!request.endsWith("\r\n\r\n"))
+            {
+                char c = 0;
+                if (client->read(&c, 1, true) != 1)
+                    return;
+                request += c;
+            }
+
+            const auto lines = juce::StringArray::fromLines(request);
+            const auto path = lines[0].fromFirstOccurrenceOf(" ", false, false).upToFirstOccurrenceOf(" ", false, false);
+            if (path != mPath)
+            {
+                send(*client, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+                return;
+            }
+
+            const auto total = static_cast<juce::int64>(mData.getSize());
+            juce::int64 first = 0;
+            juce::int64 last = total - 1;
+            bool isRange = false;
+
+            for (const auto& line : lines)
+            {
+                if (line.startsWithIgnoreCase("Range: bytes="))
+                {
+                    const auto range = line.fromFirstOccurrenceOf("=", false, false).trim();
+                    first = range.upToFirstOccurrenceOf("-", false, false).getLargeIntValue();
+                    last = juce::jmin(total - 1, range.fromFirstOccurrenceOf("-", false, false).getLargeIntValue());
+                    isRange = true;
+                }
+            }
+
+            const int concurrent = ++mConcurrentRequests;
+            for (int previous = mMaxConcurrentRequests; concurrent > previous;)
+                if (mMaxConcurrentRequests.compare_exchange_weak(previous, concurrent))
+                    break;
+
+            if (isRange)
+                ++mNumRangeRequests;
+
+            const auto length = last - first + 1;
+            send(*client, juce::String(isRange ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n")
+                          + (isRange ? "Content-Range: bytes " + juce::String(first) + "-" + juce::String(last) + "/" + juce::String(total) + "\r\n" : juce::String())
+                          + "Content-Length: " + juce::String(length) + "\r\n"
+                          + "Connection: close\r\n\r\n");
+
+            const auto* bytes = static_cast<const char*>(mData.getData());
+            for (juce::int64 sent = 0; sent < length && !threadShouldExit();)
+            {
+                const int numBytes = static_cast<int>(juce::jmin<juce::int64>(16 * 1024, length - sent));
+                if (client->write(bytes + first + sent, numBytes) != numBytes)
+                    break;
+
+                sent += numBytes;
+                juce::Thread::sleep(1);
+            }
+
+            --mConcurrentRequests;
+        }
+
+        static void send(juce::StreamingSocket& client, const juce::String& text)
+        {
+            client.write(text.toRawUTF8(), static_cast<int>(text.getNumBytesAsUTF8()));
+        }
+
+        const juce::String mPath;
+        const juce::MemoryBlock mData;
+        juce::StreamingSocket mSocket;
+        std::vector<std::thread> mConnections;
+
+        std::atomic<int> mNumRangeRequests { 0 };
+        std::atomic<int> mConcurrentRequests { 0 };
+        std::atomic<int> mMaxConcurrentRequests { 0 };
+    };
+}
+
+class ModelDownloaderTests : public juce::UnitTest
+{
+public:
+    ModelDownloaderTests() : juce::UnitTest("ModelDownloader", "DemucsJUCE") {}
+
+    void runTest() override
+    {
+        beginTest("Several connections write one file");
+
+        // Not a multiple of the block size, so the last block is short
+        juce::MemoryBlock data(3 * 1024 * 1024 + 12345);
+        juce::Random(42).fillBitsRandomly(data.getData(), data.getSize());
+
+        const juce::String fileName("model.bin");
+        RangeServer server(fileName, data);
+        expectGreaterThan(server.getPort(), 0, "The test server didn't start");
+
+        const auto directory = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                   .getNonexistentChildFile("ModelDownloaderTests", {});
+        const juce::ScopeGuard removeDirectory { [directory] { directory.deleteRecursively(); } };
+
+        ModelDownloader::Options options;
+        options.baseUrl = "http://127.0.0.1:" + juce::String(server.getPort());
+        options.directory = directory;
+        options.numConnections = 4;
+        options.blockBytes = 64 * 1024;
+        options.maxAttempts = 2;
+        options.checksums[fileName] = juce::SHA256(data).toHexString();
+        options.requireChecksum = true;
+
+        try
+        {
+            ModelDownloader::download({ fileName }, options);
+        }
+        catch (const std::exception& e)
+        {
+            expect(false, e.what());
+        }
+
+        juce::MemoryBlock downloaded;
+        expect(directory.getChildFile(fileName).loadFileAsData(downloaded), "The file wasn't moved into place");
+        expect(downloaded == data, "The downloaded file differs");
+        expect(!directory.getChildFile(fileName + ".part").exists(), "The part file was left behind");
+        expectGreaterThan(server.getNumRangeRequests(), 1);
+        expectGreaterThan(server.getMaxConcurrentRequests(), 1, "The connections never overlapped");
+    }
+};
+
+static ModelDownloaderTests modelDownloaderTests;
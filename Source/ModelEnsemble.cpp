@@ -0,0 +1,115 @@
+#include "ModelEnsemble.h"
+#include "StemSeparator.h"
+#include "StemTensor.h"
+
+ModelEnsemble::ModelEnsemble(std::vector<Member> members)
+    : mMembers(std::move(members))
+{
+    if (mMembers.empty())
+        throw std::runtime_error("An ensemble needs at least one model");
+
+    mNumStems = getNumStems(*mMembers.front().model);
+
+    for (const auto& member : mMembers)
+    {
+        if (getNumStems(*member.model) != mNumStems)
+            throw std::runtime_error("Ensemble members separate into different stems: " + member.name.toStdString());
+
+        if (!member.stemWeights.empty() && static_cast<int>(member.stemWeights.size()) != mNumStems)
+            throw std::runtime_error("Expected " + std::to_string(mNumStems) + " stem weights for " + member.name.toStdString());
+    }
+
+    for (int stem = 0; stem < mNumStems; ++stem)
+    {
+        float total = 0.0f;
+        for (int member = 0; member < getNumMembers(); ++member)
+            total += getWeight(member, stem);
+
+        if (total <= 0.0f)
+            throw std::runtime_error("No ensemble member contributes to the " + getStemName(stem).toStdString() + " stem");
+    }
+}
+
+std::shared_ptr<const ModelEnsemble> ModelEnsemble::wrap(const demucscpp::demucs_model& model)
+{
+    Member member;
+    member.name = "model";
+    member.model = std::shared_ptr<const demucscpp::demucs_model>(&model, [](const demucscpp::demucs_model*) {});
+
+    std::vector<Member> members;
+    members.push_back(std::move(member));
+    return std::make_shared<const ModelEnsemble>(std::move(members));
+}
+
+juce::Array<juce::File> ModelEnsemble::getModelFiles() const
+{
+    juce::Array<juce::File> files;
+    for (const auto& member : mMembers)
+        files.add(member.file);
+    return files;
+}
+
+juce::String ModelEnsemble::getStemName(int stem) const
+{
+    // demucs orders sources the same way for 4 and 6 stems, the 6-stem models add guitar and piano
+    jassert(juce::isPositiveAndBelow(stem, mNumStems));
+    return StemSeparator::STEM_NAMES[stem];
+}
+
+juce::String ModelEnsemble::getWeightsTag() const
+{
+    if (mMembers.size() == 1 && mMembers.front().stemWeights.empty())
+        return {};
+
+    juce::StringArray weights;
+    for (int member = 0; member < getNumMembers(); ++member)
+        for (int stem = 0; stem < mNumStems; ++stem)
+            weights.add(juce::String(getWeight(member, stem)));
+
+    return weights.joinIntoString(",");
+}
+
+Eigen::Tensor3dXf ModelEnsemble::combine(const std::vector<Eigen::Tensor3dXf>& memberStems) const
+{
+    jassert(static_cast<int>(memberStems.size()) == getNumMembers());
+
+    const auto numChannels = memberStems.front().dimension(1);
+    const auto numSamples = memberStems.front().dimension(2);
+    Eigen::Tensor3dXf combined(mNumStems, numChannels, numSamples);
+    combined.setZero();
+
+    for (int stem = 0; stem < mNumStems; ++stem)
+    {
+        float total = 0.0f;
+        for (int member = 0; member < getNumMembers(); ++member)
+            total += getWeight(member, stem);
+
+        for (int member = 0; member < getNumMembers(); ++member)
+        {
+            const auto& stems = memberStems[(size_t) member];
+            jassert(stems.dimension(1) == numChannels && stems.dimension(2) == numSamples);
+
+            const float gain = getWeight(member, stem) / total;
+            if (gain == 0.0f)
+                continue;
+
+            for (int ch = 0; ch < static_cast<int>(numChannels); ++ch)
+                juce::FloatVectorOperations::addWithMultiply(StemTensor::getChannel(combined, stem, ch),
+                                                             StemTensor::getChannel(stems, stem, ch),
+                                                             gain, static_cast<int>(numSamples));
+        }
+    }
+
+    return combined;
+}
+
+int ModelEnsemble::getNumStems(const demucscpp::demucs_model& model)
+{
+    return model.is_4sources ? 4 : 6;
+}
+
+float ModelEnsemble::getWeight(int member, int stem) const
+{
+    const auto& weights = mMembers[(size_t) member].stemWeights;
+    return weights.empty() ? 1.0f : weights[(size_t) stem];
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+#include "model.hpp"
+
+// One or more demucs models whose stems are averaged with per-stem weights, like a
+// demucs bag of models. A single model is an ensemble of one. Members have to separate
+// into the same stems; the stem count and names come from the models.
+class ModelEnsemble
+{
+public:
+    struct Member
+    {
+        juce::String name;
+        juce::File file;
+        std::shared_ptr<const demucscpp::demucs_model> model;
+
+        // One weight per stem, empty for 1 everywhere. A weight of 0 leaves the stem
+        // to the other members, e.g. for models fine-tuned on a single stem.
+        std::vector<float> stemWeights;
+    };
+
+    // Throws std::runtime_error if there are no members, their stem counts differ or a
+    // stem ends up with no weight at all
+    explicit ModelEnsemble(std::vector<Member> members);
+
+    // An ensemble of one borrowed model, which has to outlive it
+    static std::shared_ptr<const ModelEnsemble> wrap(const demucscpp::demucs_model& model);
+
+    int getNumMembers() const { return static_cast<int>(mMembers.size()); }
+    const Member& getMember(int index) const { return mMembers[(size_t) index]; }
+    juce::Array<juce::File> getModelFiles() const;
+
+    int getNumStems() const { return mNumStems; }
+    juce::String getStemName(int stem) const;
+
+    // Identifies the weights for cache keys, empty for a single model
+    juce::String getWeightsTag() const;
+
+    // Weighted average of the members' stems, one tensor per member in member order
+    Eigen::Tensor3dXf combine(const std::vector<Eigen::Tensor3dXf>& memberStems) const;
+
+    static int getNumStems(const demucscpp::demucs_model& model);
+
+private:
+    float getWeight(int member, int stem) const;
+
+    std::vector<Member> mMembers;
+    int mNumStems { 0 };
+};
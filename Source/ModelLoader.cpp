@@ -0,0 +1,36 @@
+#include "ModelLoader.h"
+#include "ResourceUsage.h"
+
+juce::String ModelLoader::Stats::toString() const
+{
+    return "Model " + modelFile.getFileName()
+         + " loaded in " + juce::String(loadSeconds, 2) + " s"
+         + " (file " + ResourceUsage::formatBytes(fileBytes)
+         + ", resident +" + ResourceUsage::formatBytes(getResidentBytesAdded())
+         + ", process " + ResourceUsage::formatBytes(residentBytesAfter) + ")";
+}
+
+std::unique_ptr<demucscpp::demucs_model> ModelLoader::load(const juce::File& modelFile, Stats* stats)
+{
+    if (!modelFile.existsAsFile())
+        throw std::runtime_error("Model file not found: " + modelFile.getFullPathName().toStdString());
+
+    Stats loadStats;
+    loadStats.modelFile = modelFile;
+    loadStats.fileBytes = modelFile.getSize();
+    loadStats.residentBytesBefore = ResourceUsage::getResidentBytes();
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    auto model = std::make_unique<demucscpp::demucs_model>();
+    if (!demucscpp::load_demucs_model(modelFile.getFullPathName().toStdString(), model.get()))
+        throw std::runtime_error("Failed to load model");
+
+    loadStats.loadSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    loadStats.residentBytesAfter = ResourceUsage::getResidentBytes();
+
+    if (stats != nullptr)
+        *stats = loadStats;
+
+    return model;
+}
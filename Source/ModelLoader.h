@@ -0,0 +1,30 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include "model.hpp"
+
+// Loads a demucs model file and records what the load cost
+class ModelLoader
+{
+public:
+    struct Stats
+    {
+        juce::File modelFile;
+        juce::int64 fileBytes { 0 };
+        double loadSeconds { 0.0 };
+        juce::int64 residentBytesBefore { -1 };
+        juce::int64 residentBytesAfter { -1 };
+
+        // Memory the loaded weights added to the process, -1 if unknown
+        juce::int64 getResidentBytesAdded() const
+        {
+            return residentBytesBefore >= 0 && residentBytesAfter >= 0 ? residentBytesAfter - residentBytesBefore : -1;
+        }
+
+        juce::String toString() const;
+    };
+
+    // Throws std::runtime_error if the file is missing or demucs.cpp can't parse it
+    static std::unique_ptr<demucscpp::demucs_model> load(const juce::File& modelFile, Stats* stats = nullptr);
+};
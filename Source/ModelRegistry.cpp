@@ -0,0 +1,106 @@
+#include "ModelRegistry.h"
+#include "ModelDownloader.h"
+
+namespace
+{
+    std::shared_ptr<const ModelEnsemble> loadMembers(const juce::Array<juce::File>& files,
+                                                     const std::vector<std::vector<float>>& stemWeights,
+                                                     std::vector<ModelLoader::Stats>* stats)
+    {
+        std::vector<ModelEnsemble::Member> members;
+        for (int i = 0; i < files.size(); ++i)
+        {
+            ModelLoader::Stats loadStats;
+
+            ModelEnsemble::Member member;
+            member.name = files[i].getFileNameWithoutExtension();
+            member.file = files[i];
+            member.model = ModelLoader::load(files[i], &loadStats);
+            if ((size_t) i < stemWeights.size())
+                member.stemWeights = stemWeights[(size_t) i];
+
+            members.push_back(std::move(member));
+            if (stats != nullptr)
+                stats->push_back(loadStats);
+        }
+
+        return std::make_shared<const ModelEnsemble>(std::move(members));
+    }
+}
+
+const std::vector<ModelRegistry::Preset>& ModelRegistry::getPresets()
+{
+    // Each fine-tuned htdemucs_ft model is only used for the stem it was tuned on,
+    // like the demucs bag of models does
+    static const std::vector<Preset> presets {
+        { "htdemucs_6s", "Hybrid Transformer, 6 stems",
+          { "ggml-model-htdemucs-6s-f16.bin" }, {} },
+        { "htdemucs", "Hybrid Transformer, 4 stems",
+          { "ggml-model-htdemucs-4s-f16.bin" }, {} },
+        { "htdemucs_ft", "Fine-tuned bag of 4 models, 4 stems",
+          { "ggml-model-htdemucs_ft_drums-4s-f16.bin", "ggml-model-htdemucs_ft_bass-4s-f16.bin",
+            "ggml-model-htdemucs_ft_other-4s-f16.bin", "ggml-model-htdemucs_ft_vocals-4s-f16.bin" },
+          { { 1.0f, 0.0f, 0.0f, 0.0f },
+            { 0.0f, 1.0f, 0.0f, 0.0f },
+            { 0.0f, 0.0f, 1.0f, 0.0f },
+            { 0.0f, 0.0f, 0.0f, 1.0f } } },
+    };
+
+    return presets;
+}
+
+const ModelRegistry::Preset* ModelRegistry::findPreset(const juce::String& name)
+{
+    for (const auto& preset : getPresets())
+        if (preset.name.equalsIgnoreCase(name))
+            return &preset;
+
+    return nullptr;
+}
+
+const ModelRegistry::Preset& ModelRegistry::getDefaultPreset()
+{
+    const auto defaultFileName = ModelDownloader::getDefaultModelFile().getFileName();
+    for (const auto& preset : getPresets())
+        if (preset.fileNames.size() == 1 && preset.fileNames[0] == defaultFileName)
+            return preset;
+
+    jassertfalse;
+    return getPresets().front();
+}
+
+std::vector<const ModelRegistry::Preset*> ModelRegistry::getAvailablePresets(const juce::File& directory)
+{
+    std::vector<const Preset*> available;
+    for (const auto& preset : getPresets())
+        if (getMissingFiles(preset, directory).isEmpty())
+            available.push_back(&preset);
+
+    return available;
+}
+
+juce::StringArray ModelRegistry::getMissingFiles(const Preset& preset, const juce::File& directory)
+{
+    juce::StringArray missing;
+    for (const auto& fileName : preset.fileNames)
+        if (!directory.getChildFile(fileName).existsAsFile())
+            missing.add(fileName);
+
+    return missing;
+}
+
+std::shared_ptr<const ModelEnsemble> ModelRegistry::load(const Preset& preset, const juce::File& directory,
+                                                         std::vector<ModelLoader::Stats>* stats)
+{
+    juce::Array<juce::File> files;
+    for (const auto& fileName : preset.fileNames)
+        files.add(directory.getChildFile(fileName));
+
+    return loadMembers(files, preset.stemWeights, stats);
+}
+
+std::shared_ptr<const ModelEnsemble> ModelRegistry::load(const juce::Array<juce::File>& modelFiles,
+                                                         std::vector<ModelLoader::Stats>* stats)
+{
+    return loadMembers(modelFiles, {}, stats);
+}
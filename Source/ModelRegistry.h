@@ -0,0 +1,42 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+#include "ModelEnsemble.h"
+#include "ModelLoader.h"
+
+// The demucs models the app knows about, by the names demucs uses for them. A preset is
+// one model file or a bag of them; all files live in ModelDownloader::getModelDirectory().
+class ModelRegistry
+{
+public:
+    struct Preset
+    {
+        juce::String name;
+        juce::String description;
+        juce::StringArray fileNames;
+
+        // Per member, empty for equal weights. See ModelEnsemble::Member::stemWeights.
+        std::vector<std::vector<float>> stemWeights;
+    };
+
+    static const std::vector<Preset>& getPresets();
+    static const Preset* findPreset(const juce::String& name);
+
+    // The preset that matches ModelDownloader::getDefaultModelFile()
+    static const Preset& getDefaultPreset();
+
+    // Presets whose files are all in the directory
+    static std::vector<const Preset*> getAvailablePresets(const juce::File& directory);
+    static juce::StringArray getMissingFiles(const Preset& preset, const juce::File& directory);
+
+    // Load every member, one load per file. Throws std::runtime_error like ModelLoader::load,
+    // or if the members don't fit together.
+    static std::shared_ptr<const ModelEnsemble> load(const Preset& preset, const juce::File& directory,
+                                                     std::vector<ModelLoader::Stats>* stats = nullptr);
+
+    // Equal-weight ensemble of arbitrary model files, a single file is a plain model
+    static std::shared_ptr<const ModelEnsemble> load(const juce::Array<juce::File>& modelFiles,
+                                                     std::vector<ModelLoader::Stats>* stats = nullptr);
+};
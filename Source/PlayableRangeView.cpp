@@ -0,0 +1,43 @@
+#include "PlayableRangeView.h"
+
+PlayableRangeView::PlayableRangeView()
+{
+    startTimerHz(10);
+}
+
+void PlayableRangeView::reset(juce::int64 totalSamples)
+{
+    mTotalSamples = totalSamples;
+    mWrittenEnd = 0;
+}
+
+void PlayableRangeView::paint(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds().toFloat();
+    auto bar = bounds.removeFromLeft(bounds.getWidth() - 220.0f);
+
+    g.setColour(getLookAndFeel().findColour(juce::ListBox::backgroundColourId));
+    g.fillRect(bar);
+
+    const auto total = mTotalSamples.load();
+    if (total > 0)
+    {
+        const auto written = juce::jlimit<juce::int64>(0, total, mWrittenEnd.load());
+        g.setColour(juce::Colours::limegreen.withAlpha(0.8f));
+        g.fillRect(bar.withWidth(bar.getWidth() * static_cast<float>(written) / static_cast<float>(total)));
+    }
+
+    g.setColour(getLookAndFeel().findColour(juce::Label::textColourId));
+    g.setFont(13.0f);
+    g.drawText("green: stems written", bounds.reduced(8.0f, 0.0f), juce::Justification::centredLeft);
+}
+
+void PlayableRangeView::timerCallback()
+{
+    const std::array<juce::int64, 2> positions { mTotalSamples.load(), mWrittenEnd.load() };
+    if (positions != mPainted)
+    {
+        mPainted = positions;
+        repaint();
+    }
+}
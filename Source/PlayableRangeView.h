@@ -0,0 +1,29 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+// Shows how far along the file the stems have been written. With the files flushed after
+// every chunk, that's the part that can already be played. The position can be set from
+// any thread.
+class PlayableRangeView : public juce::Component,
+                          private juce::Timer
+{
+public:
+    PlayableRangeView();
+
+    void reset(juce::int64 totalSamples);
+    void setWrittenEnd(juce::int64 sample) { mWrittenEnd = sample; }
+
+    void paint(juce::Graphics& g) override;
+
+private:
+    void timerCallback() override;
+
+    std::atomic<juce::int64> mTotalSamples { 0 };
+    std::atomic<juce::int64> mWrittenEnd { 0 };
+    std::array<juce::int64, 2> mPainted {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlayableRangeView)
+};
@@ -0,0 +1,52 @@
+#include "PluginEditor.h"
+
+DemucsPluginEditor::DemucsPluginEditor(DemucsPluginProcessor& processor)
+    : AudioProcessorEditor(processor),
+      mProcessor(processor)
+{
+    for (int stem = 0; stem < StemSeparator::kNumStems; ++stem)
+    {
+        auto* slider = mGainSliders.add(new juce::Slider(juce::Slider::LinearVertical, juce::Slider::TextBoxBelow));
+        slider->setTextBoxStyle(juce::Slider::TextBoxBelow, false, 70, 20);
+        addAndMakeVisible(slider);
+
+        auto* label = mGainLabels.add(new juce::Label({}, StemSeparator::STEM_NAMES[stem]));
+        label->setJustificationType(juce::Justification::centred);
+        addAndMakeVisible(label);
+
+        mGainAttachments.add(new SliderAttachment(mProcessor.getParameters(),
+                                                  DemucsPluginProcessor::getGainParameterId(stem),
+                                                  *slider));
+    }
+
+    addAndMakeVisible(mStatusLabel);
+
+    setSize(540, 320);
+    timerCallback();
+    startTimerHz(4);
+}
+
+void DemucsPluginEditor::paint(juce::Graphics& g)
+{
+    g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
+}
+
+void DemucsPluginEditor::resized()
+{
+    auto area = getLocalBounds().reduced(20);
+    mStatusLabel.setBounds(area.removeFromBottom(30));
+    area.removeFromBottom(10);
+
+    const int columnWidth = area.getWidth() / StemSeparator::kNumStems;
+    for (int stem = 0; stem < StemSeparator::kNumStems; ++stem)
+    {
+        auto column = area.removeFromLeft(columnWidth);
+        mGainLabels[stem]->setBounds(column.removeFromTop(24));
+        mGainSliders[stem]->setBounds(column);
+    }
+}
+
+void DemucsPluginEditor::timerCallback()
+{
+    mStatusLabel.setText(mProcessor.getSeparator().getStatusText(), juce::dontSendNotification);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+class DemucsPluginEditor : public juce::AudioProcessorEditor,
+                           private juce::Timer
+{
+public:
+    explicit DemucsPluginEditor(DemucsPluginProcessor& processor);
+    ~DemucsPluginEditor() override = default;
+
+    void paint(juce::Graphics&) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+
+    using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
+
+    DemucsPluginProcessor& mProcessor;
+    juce::OwnedArray<juce::Slider> mGainSliders;
+    juce::OwnedArray<juce::Label> mGainLabels;
+    juce::OwnedArray<SliderAttachment> mGainAttachments;
+    juce::Label mStatusLabel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DemucsPluginEditor)
+};
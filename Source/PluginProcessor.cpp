@@ -0,0 +1,99 @@
+#include "PluginProcessor.h"
+#include "ModelDownloader.h"
+#include "PluginEditor.h"
+
+DemucsPluginProcessor::DemucsPluginProcessor()
+    : AudioProcessor(BusesProperties()
+                         .withInput("Input", juce::AudioChannelSet::stereo(), true)
+                         .withOutput("Output", juce::AudioChannelSet::stereo(), true)),
+      mParameters(*this, nullptr, "DemucsPlugin", createParameterLayout()),
+      mSeparator(ModelDownloader::getDefaultModelFile())
+{
+    for (int stem = 0; stem < StemSeparator::kNumStems; ++stem)
+        mGainParameters[(size_t) stem] = mParameters.getRawParameterValue(getGainParameterId(stem));
+}
+
+juce::String DemucsPluginProcessor::getGainParameterId(int stem)
+{
+    return juce::String(StemSeparator::STEM_NAMES[stem]) + "_gain";
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout DemucsPluginProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+
+    for (int stem = 0; stem < StemSeparator::kNumStems; ++stem)
+    {
+        const auto name = juce::String(StemSeparator::STEM_NAMES[stem]);
+        layout.add(std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID { getGainParameterId(stem), 1 },
+            name.substring(0, 1).toUpperCase() + name.substring(1),
+            juce::NormalisableRange<float> { kMinGainDecibels, 12.0f, 0.1f },
+            0.0f,
+            juce::AudioParameterFloatAttributes().withLabel("dB")));
+    }
+
+    return layout;
+}
+
+void DemucsPluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
+{
+    mMaximumBlockSize = samplesPerBlock;
+    mSeparator.prepare(sampleRate, samplesPerBlock);
+    setLatencySamples(mSeparator.getLatencySamples());
+}
+
+void DemucsPluginProcessor::releaseResources()
+{
+    mSeparator.release();
+}
+
+bool DemucsPluginProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
+{
+    return layouts.getMainInputChannelSet() == juce::AudioChannelSet::stereo()
+        && layouts.getMainOutputChannelSet() == juce::AudioChannelSet::stereo();
+}
+
+void DemucsPluginProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    if (mMaximumBlockSize <= 0)
+        return;
+
+    LiveSeparator::StemGains gains;
+    for (int stem = 0; stem < StemSeparator::kNumStems; ++stem)
+        gains[(size_t) stem] = juce::Decibels::decibelsToGain(mGainParameters[(size_t) stem]->load(), kMinGainDecibels);
+
+    // Hosts may exceed the announced block size now and then
+    const int numSamples = buffer.getNumSamples();
+    for (int offset = 0; offset < numSamples; offset += mMaximumBlockSize)
+    {
+        const int numThisTime = juce::jmin(mMaximumBlockSize, numSamples - offset);
+        juce::AudioBuffer<float> slice(buffer.getArrayOfWritePointers(), StemSeparator::kNumChannels, offset, numThisTime);
+        mSeparator.process(slice, numThisTime, gains);
+    }
+}
+
+juce::AudioProcessorEditor* DemucsPluginProcessor::createEditor()
+{
+    return new DemucsPluginEditor(*this);
+}
+
+void DemucsPluginProcessor::getStateInformation(juce::MemoryBlock& destData)
+{
+    if (auto xml = mParameters.copyState().createXml())
+        copyXmlToBinary(*xml, destData);
+}
+
+void DemucsPluginProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+    if (auto xml = getXmlFromBinary(data, sizeInBytes))
+        if (xml->hasTagName(mParameters.state.getType()))
+            mParameters.replaceState(juce::ValueTree::fromXml(*xml));
+}
+
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new DemucsPluginProcessor();
+}
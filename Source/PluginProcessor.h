@@ -0,0 +1,55 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LiveSeparator.h"
+
+// Live stem separation as a plugin. Input is separated with a fixed latency and the stems
+// are mixed back together with one gain per stem, e.g. vocals down for a backing track.
+class DemucsPluginProcessor : public juce::AudioProcessor
+{
+public:
+    DemucsPluginProcessor();
+    ~DemucsPluginProcessor() override = default;
+
+    void prepareToPlay(double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+    bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
+    void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    using AudioProcessor::processBlock;
+
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override { return true; }
+
+    const juce::String getName() const override { return JucePlugin_Name; }
+    bool acceptsMidi() const override { return false; }
+    bool producesMidi() const override { return false; }
+    bool isMidiEffect() const override { return false; }
+    double getTailLengthSeconds() const override { return 0.0; }
+
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const juce::String getProgramName(int) override { return {}; }
+    void changeProgramName(int, const juce::String&) override {}
+
+    void getStateInformation(juce::MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+    juce::AudioProcessorValueTreeState& getParameters() { return mParameters; }
+    const LiveSeparator& getSeparator() const { return mSeparator; }
+
+    static juce::String getGainParameterId(int stem);
+
+    // Gains at or below this are treated as muted
+    static constexpr float kMinGainDecibels = -60.0f;
+
+private:
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+    juce::AudioProcessorValueTreeState mParameters;
+    std::array<std::atomic<float>*, StemSeparator::kNumStems> mGainParameters {};
+    LiveSeparator mSeparator;
+    int mMaximumBlockSize { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DemucsPluginProcessor)
+};
@@ -0,0 +1,146 @@
+#include "PolyphaseResampler.h"
+#include <Eigen/Core>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+    // Zero crossings of the sinc on each side at the filter cutoff, and the cutoff as a
+    // fraction of the lower Nyquist frequency. Together with the Kaiser window that keeps
+    // images and aliases around -100 dB with flat response up to about 20 kHz at 44.1 kHz.
+    constexpr double kZeroCrossings = 24.0;
+    constexpr double kRolloff = 0.94;
+    constexpr double kKaiserBeta = 10.0;
+
+    double besselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 50 && term > sum * 1.0e-12; ++k)
+        {
+            const double half = x / (2.0 * k);
+            term *= half * half;
+            sum += term;
+        }
+        return sum;
+    }
+
+    double sinc(double x)
+    {
+        return std::abs(x) < 1.0e-9 ? 1.0 : std::sin(juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+    }
+
+    juce::int64 floorDivide(juce::int64 numerator, juce::int64 denominator)
+    {
+        const auto quotient = numerator / denominator;
+        return (numerator % denominator != 0 && numerator < 0) ? quotient - 1 : quotient;
+    }
+}
+
+PolyphaseResampler::PolyphaseResampler(double sourceRate, double targetRate)
+    : mSourceRate(sourceRate),
+      mTargetRate(targetRate)
+{
+    jassert(sourceRate > 0.0 && targetRate > 0.0);
+
+    const auto source = static_cast<juce::int64>(std::llround(sourceRate));
+    const auto target = static_cast<juce::int64>(std::llround(targetRate));
+    const auto divisor = std::gcd(source, target);
+    mUp = target / divisor;
+    mDown = source / divisor;
+
+    if (isIdentity())
+    {
+        mUp = mDown = 1;
+        return;
+    }
+
+    mNumPhases = static_cast<int>(juce::jmin(mUp, static_cast<juce::int64>(kMaxPhases)));
+
+    const double cutoff = juce::jmin(1.0, static_cast<double>(mUp) / static_cast<double>(mDown)) * kRolloff;
+    mHalfTaps = static_cast<int>(std::ceil(kZeroCrossings / cutoff));
+    mNumTaps = mHalfTaps * 2;
+
+    const double windowNorm = besselI0(kKaiserBeta);
+    mCoefficients.resize(static_cast<size_t>(mNumPhases + 1) * static_cast<size_t>(mNumTaps));
+
+    for (int phase = 0; phase <= mNumPhases; ++phase)
+    {
+        float* row = mCoefficients.data() + static_cast<size_t>(phase) * static_cast<size_t>(mNumTaps);
+        const double fraction = static_cast<double>(phase) / mNumPhases;
+
+        double sum = 0.0;
+        for (int tap = 0; tap < mNumTaps; ++tap)
+        {
+            const double x = (tap - mHalfTaps + 1) - fraction;
+            const double ratio = juce::jlimit(-1.0, 1.0, x / mHalfTaps);
+            const double value = cutoff * sinc(cutoff * x) * besselI0(kKaiserBeta * std::sqrt(1.0 - ratio * ratio)) / windowNorm;
+            row[tap] = static_cast<float>(value);
+            sum += value;
+        }
+
+        // Unity gain at DC for every phase
+        for (int tap = 0; tap < mNumTaps; ++tap)
+            row[tap] = static_cast<float>(row[tap] / sum);
+    }
+}
+
+juce::int64 PolyphaseResampler::getOutputLength(juce::int64 inputLength) const
+{
+    return (inputLength * mUp + mDown - 1) / mDown;
+}
+
+juce::int64 PolyphaseResampler::getNumOutputReady(juce::int64 numInput) const
+{
+    if (isIdentity())
+        return numInput;
+
+    // Output n needs input up to floor(n * down / up) + halfTaps
+    const auto available = numInput - mHalfTaps;
+    return available > 0 ? (available * mUp + mDown - 1) / mDown : 0;
+}
+
+juce::Range<juce::int64> PolyphaseResampler::getInputRange(juce::int64 outputStart, int numOutput) const
+{
+    if (isIdentity())
+        return { outputStart, outputStart + numOutput };
+
+    const auto first = floorDivide(outputStart * mDown, mUp) - mHalfTaps + 1;
+    const auto last = floorDivide((outputStart + juce::jmax(1, numOutput) - 1) * mDown, mUp) + mHalfTaps;
+    return { first, last + 1 };
+}
+
+void PolyphaseResampler::process(const float* input, juce::int64 inputStart,
+                                 float* output, juce::int64 outputStart, int numOutput) const
+{
+    if (isIdentity())
+    {
+        juce::FloatVectorOperations::copy(output, input + (outputStart - inputStart), numOutput);
+        return;
+    }
+
+    for (int i = 0; i < numOutput; ++i)
+        output[i] = computeSample(input, inputStart, outputStart + i);
+}
+
+float PolyphaseResampler::computeSample(const float* input, juce::int64 inputStart, juce::int64 outputIndex) const
+{
+    const auto position = outputIndex * mDown;
+    const auto inputIndex = floorDivide(position, mUp);
+    const auto remainder = position - inputIndex * mUp;
+
+    using Taps = Eigen::Map<const Eigen::VectorXf>;
+    const Taps samples(input + (inputIndex - mHalfTaps + 1 - inputStart), mNumTaps);
+    auto row = [this](int phase) { return Taps(mCoefficients.data() + static_cast<size_t>(phase) * static_cast<size_t>(mNumTaps), mNumTaps); };
+
+    if (mUp <= kMaxPhases)
+        return row(static_cast<int>(remainder)).dot(samples);
+
+    // More output positions than phases, blend the two nearest ones
+    const double phasePosition = static_cast<double>(remainder) * mNumPhases / static_cast<double>(mUp);
+    const int phase = static_cast<int>(phasePosition);
+    const auto weight = static_cast<float>(phasePosition - phase);
+    const float current = row(phase).dot(samples);
+    const float next = row(phase + 1).dot(samples);
+    return current + weight * (next - current);
+}
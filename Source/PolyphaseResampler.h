@@ -0,0 +1,54 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+
+// Windowed-sinc polyphase resampler for a fixed pair of sample rates. It keeps no state:
+// output sample n is computed from the input around n * sourceRate / targetRate, so any
+// output range can be produced from the matching input range (getInputRange) and chunks
+// resampled separately join up exactly like a single pass would.
+//
+// Rates with a small rational ratio (44.1 <-> 48/88.2/96/192 kHz and the like) use one
+// filter phase per output position. Other ratios interpolate between kMaxPhases phases.
+class PolyphaseResampler
+{
+public:
+    PolyphaseResampler(double sourceRate, double targetRate);
+
+    bool isIdentity() const { return mUp == mDown; }
+    double getSourceRate() const { return mSourceRate; }
+    double getTargetRate() const { return mTargetRate; }
+
+    juce::int64 getOutputLength(juce::int64 inputLength) const;
+
+    // Output samples that can be computed once the first numInput input samples are known
+    juce::int64 getNumOutputReady(juce::int64 numInput) const;
+
+    // Input samples that output samples [outputStart, outputStart + numOutput) depend on.
+    // The range may reach below zero or past the end of the input, which reads as silence.
+    juce::Range<juce::int64> getInputRange(juce::int64 outputStart, int numOutput) const;
+
+    // input holds the samples of getInputRange(outputStart, numOutput), starting with
+    // input sample inputStart
+    void process(const float* input, juce::int64 inputStart,
+                 float* output, juce::int64 outputStart, int numOutput) const;
+
+    static constexpr int kMaxPhases = 1024;
+
+private:
+    float computeSample(const float* input, juce::int64 inputStart, juce::int64 outputIndex) const;
+
+    double mSourceRate;
+    double mTargetRate;
+
+    // Output runs at mUp / mDown times the input rate
+    juce::int64 mUp { 1 };
+    juce::int64 mDown { 1 };
+
+    int mNumPhases { 1 };
+    int mHalfTaps { 1 };
+    int mNumTaps { 2 };
+
+    // mNumPhases + 1 rows of mNumTaps, the extra row lets interpolated phases look one ahead
+    std::vector<float> mCoefficients;
+};
@@ -0,0 +1,79 @@
+#include "ResamplingAudioWriter.h"
+
+ResamplingAudioWriter::ResamplingAudioWriter(std::unique_ptr<juce::AudioFormatWriter> dest, double sourceRate)
+    : AudioFormatWriter(nullptr, dest->getFormatName(), sourceRate, static_cast<unsigned int>(dest->getNumChannels()), 32),
+      mDest(std::move(dest)),
+      mResampler(sourceRate, mDest->getSampleRate())
+{
+    usesFloatingPointData = true;
+
+    mBufferStart = mResampler.getInputRange(0, 1).getStart();
+    mNumBuffered = static_cast<int>(-mBufferStart);
+    mInput.setSize(static_cast<int>(numChannels), juce::jmax(1, mNumBuffered));
+    mInput.clear();
+}
+
+ResamplingAudioWriter::~ResamplingAudioWriter()
+{
+    // Pad with the silence after the last sample and write the rest
+    const auto numOutput = mResampler.getOutputLength(mNumInput);
+    if (numOutput > mNumOutput)
+    {
+        const auto end = mResampler.getInputRange(mNumOutput, static_cast<int>(numOutput - mNumOutput)).getEnd();
+        const auto numPadding = static_cast<int>(juce::jmax(static_cast<juce::int64>(0), end - (mBufferStart + mNumBuffered)));
+
+        mInput.setSize(mInput.getNumChannels(), mNumBuffered + numPadding, true, false, true);
+        mInput.clear(mNumBuffered, numPadding);
+        mNumBuffered += numPadding;
+        writeReady(numOutput);
+    }
+}
+
+bool ResamplingAudioWriter::write(const int** samplesToWrite, int numSamples)
+{
+    mInput.setSize(mInput.getNumChannels(), mNumBuffered + numSamples, true, false, true);
+    for (int ch = 0; ch < mInput.getNumChannels(); ++ch)
+        mInput.copyFrom(ch, mNumBuffered, reinterpret_cast<const float*>(samplesToWrite[ch]), numSamples);
+
+    mNumBuffered += numSamples;
+    mNumInput += numSamples;
+    return writeReady(mResampler.getNumOutputReady(mNumInput));
+}
+
+bool ResamplingAudioWriter::flush()
+{
+    return mDest->flush();
+}
+
+bool ResamplingAudioWriter::writeReady(juce::int64 numOutputReady)
+{
+    const auto numOutput = static_cast<int>(numOutputReady - mNumOutput);
+    if (numOutput <= 0)
+        return true;
+
+    const auto inputRange = mResampler.getInputRange(mNumOutput, numOutput);
+    jassert(inputRange.getStart() >= mBufferStart && inputRange.getEnd() <= mBufferStart + mNumBuffered);
+
+    mOutput.setSize(mInput.getNumChannels(), numOutput, false, false, true);
+    for (int ch = 0; ch < mInput.getNumChannels(); ++ch)
+        mResampler.process(mInput.getReadPointer(ch), mBufferStart, mOutput.getWritePointer(ch), mNumOutput, numOutput);
+
+    mNumOutput += numOutput;
+
+    // Drop the input no later output needs
+    const auto keepFrom = mResampler.getInputRange(mNumOutput, 1).getStart();
+    const auto numDropped = static_cast<int>(juce::jlimit(static_cast<juce::int64>(0), static_cast<juce::int64>(mNumBuffered), keepFrom - mBufferStart));
+    if (numDropped > 0)
+    {
+        for (int ch = 0; ch < mInput.getNumChannels(); ++ch)
+        {
+            auto* data = mInput.getWritePointer(ch);
+            std::memmove(data, data + numDropped, static_cast<size_t>(mNumBuffered - numDropped) * sizeof(float));
+        }
+
+        mBufferStart += numDropped;
+        mNumBuffered -= numDropped;
+    }
+
+    return mDest->writeFromAudioSampleBuffer(mOutput, 0, numOutput);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include "PolyphaseResampler.h"
+
+// Takes float audio at sourceRate and writes it to dest at dest's sample rate. Blocks can
+// be any size; output lags the input by the filter length until the writer is destroyed,
+// which writes the rest. flush() only flushes what has been resampled so far.
+class ResamplingAudioWriter : public juce::AudioFormatWriter
+{
+public:
+    ResamplingAudioWriter(std::unique_ptr<juce::AudioFormatWriter> dest, double sourceRate);
+    ~ResamplingAudioWriter() override;
+
+    bool write(const int** samplesToWrite, int numSamples) override;
+    bool flush() override;
+
+private:
+    bool writeReady(juce::int64 numOutputReady);
+
+    std::unique_ptr<juce::AudioFormatWriter> mDest;
+    PolyphaseResampler mResampler;
+
+    // Input from sample mBufferStart on, the part the next output still depends on. It
+    // starts with the silence before the first sample.
+    juce::AudioBuffer<float> mInput;
+    juce::int64 mBufferStart { 0 };
+    int mNumBuffered { 0 };
+    juce::int64 mNumInput { 0 };
+    juce::int64 mNumOutput { 0 };
+    juce::AudioBuffer<float> mOutput;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResamplingAudioWriter)
+};
@@ -0,0 +1,66 @@
+#include "ResourceUsage.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+ #include <psapi.h>
+ #pragma comment(lib, "psapi.lib")
+#elif JUCE_MAC
+ #include <mach/mach.h>
+ #include <sys/resource.h>
+#endif
+
+#if JUCE_LINUX
+namespace
+{
+    juce::int64 readProcStatusKilobytes(const char* key)
+    {
+        juce::StringArray lines;
+        juce::File("/proc/self/status").readLines(lines);
+
+        for (const auto& line : lines)
+            if (line.startsWith(key))
+                return line.fromFirstOccurrenceOf(":", false, false).trim().getLargeIntValue() * 1024;
+
+        return -1;
+    }
+}
+#endif
+
+juce::int64 ResourceUsage::getResidentBytes()
+{
+   #if JUCE_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return static_cast<juce::int64>(counters.WorkingSetSize);
+    return -1;
+   #elif JUCE_MAC
+    mach_task_basic_info_data_t info {};
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+        return static_cast<juce::int64>(info.resident_size);
+    return -1;
+   #elif JUCE_LINUX
+    return readProcStatusKilobytes("VmRSS");
+   #else
+    return -1;
+   #endif
+}
+
+juce::int64 ResourceUsage::getPeakResidentBytes()
+{
+   #if JUCE_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return static_cast<juce::int64>(counters.PeakWorkingSetSize);
+    return -1;
+   #elif JUCE_MAC
+    rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return static_cast<juce::int64>(usage.ru_maxrss); // bytes on macOS
+    return -1;
+   #elif JUCE_LINUX
+    return readProcStatusKilobytes("VmHWM");
+   #else
+    return -1;
+   #endif
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Memory counters for the current process, or -1 where the platform doesn't report them
+struct ResourceUsage
+{
+    static juce::int64 getResidentBytes();
+    static juce::int64 getPeakResidentBytes();
+
+    static juce::String formatBytes(juce::int64 bytes)
+    {
+        if (bytes < 0)
+            return "n/a";
+        return juce::String(bytes / (1024.0 * 1024.0), 1) + " MB";
+    }
+};
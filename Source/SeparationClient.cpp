@@ -0,0 +1,153 @@
+#include "SeparationClient.h"
+
+SeparationClient::SeparationClient()
+    : InterprocessConnection(false, SeparationProtocol::kMagic)
+{
+}
+
+SeparationClient::~SeparationClient()
+{
+    disconnect();
+}
+
+bool SeparationClient::connect(int port, int timeoutMilliseconds)
+{
+    mToken = SeparationProtocol::readTokenFile(port);
+    return mToken.isNotEmpty() && connectToSocket("127.0.0.1", port, timeoutMilliseconds);
+}
+
+StemSeparator::Result SeparationClient::separate(const juce::File& inputFile,
+                                                 const juce::File& outputDirectory,
+                                                 const StemSeparator::Options& options,
+                                                 bool useServerCache,
+                                                 StemSeparator::ProgressCallback onProgress,
+                                                 StemSeparator::CancelCallback shouldCancel,
+                                                 const juce::String& modelName)
+{
+    const auto id = juce::Uuid().toString();
+    auto request = addRequest(id, std::move(onProgress));
+
+    auto message = SeparationProtocol::makeMessage("separate", id);
+    auto* object = message.getDynamicObject();
+    object->setProperty("input", inputFile.getFullPathName());
+    object->setProperty("output", outputDirectory.getFullPathName());
+    object->setProperty("model", modelName);
+    auto optionsVar = SeparationProtocol::optionsToVar(options);
+    optionsVar.getDynamicObject()->setProperty("cache", useServerCache);
+    object->setProperty("options", optionsVar);
+    send(message);
+
+    const auto reply = waitForReply(id, request, shouldCancel, -1);
+    if (reply.getProperty("type", {}).toString() != "done")
+        throw std::runtime_error(reply.getProperty("error", "Separation failed").toString().toStdString());
+
+    return SeparationProtocol::resultFromVar(reply.getProperty("result", {}));
+}
+
+SeparationServer::Stats SeparationClient::getStats(int timeoutMilliseconds)
+{
+    const auto id = juce::Uuid().toString();
+    auto request = addRequest(id, {});
+    send(SeparationProtocol::makeMessage("stats", id));
+
+    const auto reply = waitForReply(id, request, {}, timeoutMilliseconds);
+    if (reply.getProperty("type", {}).toString() != "stats")
+        throw std::runtime_error(reply.getProperty("error", "No stats from server").toString().toStdString());
+
+    return SeparationServer::Stats::fromVar(reply);
+}
+
+void SeparationClient::requestShutdown()
+{
+    send(SeparationProtocol::makeMessage("shutdown"));
+}
+
+void SeparationClient::connectionLost()
+{
+    const std::lock_guard<std::mutex> lock(mLock);
+    for (auto& [id, request] : mRequests)
+    {
+        auto reply = SeparationProtocol::makeMessage("failed", id);
+        reply.getDynamicObject()->setProperty("error", "Lost connection to the separation server");
+        request->reply = reply;
+        request->finished.signal();
+    }
+    mRequests.clear();
+}
+
+void SeparationClient::messageReceived(const juce::MemoryBlock& message)
+{
+    const auto reply = SeparationProtocol::fromMessage(message);
+    const auto type = reply.getProperty("type", {}).toString();
+    const auto id = reply.getProperty("id", {}).toString();
+
+    std::shared_ptr<Request> request;
+    {
+        const std::lock_guard<std::mutex> lock(mLock);
+        const auto it = mRequests.find(id);
+        if (it == mRequests.end())
+            return;
+
+        request = it->second;
+        if (type != "progress")
+            mRequests.erase(it);
+    }
+
+    if (type == "progress")
+    {
+        if (request->onProgress)
+            request->onProgress(reply.getProperty("progress", -1.0f), reply.getProperty("message", {}).toString());
+        return;
+    }
+
+    request->reply = reply;
+    request->finished.signal();
+}
+
+std::shared_ptr<SeparationClient::Request> SeparationClient::addRequest(const juce::String& id,
+                                                                         StemSeparator::ProgressCallback onProgress)
+{
+    if (!isConnected())
+        throw std::runtime_error("Not connected to a separation server");
+
+    auto request = std::make_shared<Request>();
+    request->onProgress = std::move(onProgress);
+
+    const std::lock_guard<std::mutex> lock(mLock);
+    mRequests[id] = request;
+    return request;
+}
+
+juce::var SeparationClient::waitForReply(const juce::String& id, const std::shared_ptr<Request>& request,
+                                         const StemSeparator::CancelCallback& shouldCancel, int timeoutMilliseconds)
+{
+    const auto deadline = juce::Time::getMillisecondCounter() + static_cast<juce::uint32>(juce::jmax(0, timeoutMilliseconds));
+    bool cancelSent = false;
+
+    while (!request->finished.wait(100))
+    {
+        if (!cancelSent && shouldCancel && shouldCancel())
+        {
+            send(SeparationProtocol::makeMessage("cancel", id));
+            cancelSent = true;
+        }
+
+        if (timeoutMilliseconds >= 0 && juce::Time::getMillisecondCounter() >= deadline)
+        {
+            const std::lock_guard<std::mutex> lock(mLock);
+            mRequests.erase(id);
+            throw std::runtime_error("The separation server didn't reply in time");
+        }
+    }
+
+    return request->reply;
+}
+
+void SeparationClient::send(const juce::var& message)
+{
+    message.getDynamicObject()->setProperty("token", mToken);
+
+    const juce::ScopedLock lock(mSendLock);
+    if (!sendMessage(SeparationProtocol::toMessage(message)))
+        throw std::runtime_error("Could not reach the separation server");
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "SeparationServer.h"
+
+// Thin client of a SeparationServer. separate() blocks like StemSeparator::process(), so
+// several threads can each run a job over the same connection.
+class SeparationClient : private juce::InterprocessConnection
+{
+public:
+    SeparationClient();
+    ~SeparationClient() override;
+
+    // False if no server listens on the port or its token file can't be read, which is the
+    // case for a server another user started
+    bool connect(int port = SeparationProtocol::kDefaultPort, int timeoutMilliseconds = 2000);
+    bool isConnected() const { return InterprocessConnection::isConnected(); }
+
+    // The files have to be visible to the server, which runs on the same machine.
+    // options.cache is ignored, useServerCache decides about the server's own cache.
+    // Throws std::runtime_error if the job fails, is cancelled or the connection drops.
+    StemSeparator::Result separate(const juce::File& inputFile,
+                                   const juce::File& outputDirectory,
+                                   const StemSeparator::Options& options,
+                                   bool useServerCache,
+                                   StemSeparator::ProgressCallback onProgress = {},
+                                   StemSeparator::CancelCallback shouldCancel = {},
+                                   const juce::String& modelName = {});
+
+    SeparationServer::Stats getStats(int timeoutMilliseconds = 2000);
+    void requestShutdown();
+
+private:
+    struct Request
+    {
+        juce::WaitableEvent finished;
+        juce::var reply;
+        StemSeparator::ProgressCallback onProgress;
+    };
+
+    void connectionMade() override {}
+    void connectionLost() override;
+    void messageReceived(const juce::MemoryBlock& message) override;
+
+    std::shared_ptr<Request> addRequest(const juce::String& id, StemSeparator::ProgressCallback onProgress);
+    juce::var waitForReply(const juce::String& id, const std::shared_ptr<Request>& request,
+                           const StemSeparator::CancelCallback& shouldCancel, int timeoutMilliseconds);
+    void send(const juce::var& message);
+
+    std::mutex mLock;
+    std::map<juce::String, std::shared_ptr<Request>> mRequests;
+    juce::CriticalSection mSendLock;
+    juce::String mToken;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SeparationClient)
+};
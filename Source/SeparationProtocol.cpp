@@ -0,0 +1,148 @@
+#include "SeparationProtocol.h"
+#include <random>
+
+#if !JUCE_WINDOWS
+ #include <sys/stat.h>
+#endif
+
+namespace SeparationProtocol
+{
+    juce::var optionsToVar(const StemSeparator::Options& options)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("streaming", options.streaming);
+        object->setProperty("chunkSeconds", options.chunkSeconds);
+        object->setProperty("overlapSeconds", options.overlapSeconds);
+        object->setProperty("chunkWorkers", options.numChunkWorkers);
+        object->setProperty("halfChunks", options.halfPrecisionPendingChunks);
+        object->setProperty("flush", options.flushAfterEveryChunk);
+        object->setProperty("skipSilence", options.skipSilence);
+        object->setProperty("silenceThresholdDb", options.silenceThresholdDb);
+        object->setProperty("silenceToOther", options.silenceToOther);
+        object->setProperty("format", StemSeparator::OUTPUT_FORMAT_NAMES[static_cast<int>(options.outputFormat)]);
+        object->setProperty("sourceRate", options.keepSourceSampleRate);
+        return juce::var(object);
+    }
+
+    StemSeparator::Options optionsFromVar(const juce::var& value)
+    {
+        StemSeparator::Options options;
+        options.streaming = value.getProperty("streaming", options.streaming);
+        options.chunkSeconds = value.getProperty("chunkSeconds", options.chunkSeconds);
+        options.overlapSeconds = value.getProperty("overlapSeconds", options.overlapSeconds);
+        options.numChunkWorkers = value.getProperty("chunkWorkers", options.numChunkWorkers);
+        options.halfPrecisionPendingChunks = value.getProperty("halfChunks", options.halfPrecisionPendingChunks);
+        options.flushAfterEveryChunk = value.getProperty("flush", options.flushAfterEveryChunk);
+        options.skipSilence = value.getProperty("skipSilence", options.skipSilence);
+        options.silenceThresholdDb = value.getProperty("silenceThresholdDb", options.silenceThresholdDb);
+        options.silenceToOther = value.getProperty("silenceToOther", options.silenceToOther);
+        StemSeparator::parseOutputFormat(value.getProperty("format", {}).toString(), options.outputFormat);
+        options.keepSourceSampleRate = value.getProperty("sourceRate", options.keepSourceSampleRate);
+
+        // Each worker runs its own inference, more than there are cores only costs memory
+        const int maxChunkWorkers = juce::SystemStats::getNumCpus();
+        if (options.numChunkWorkers < 1 || options.numChunkWorkers > maxChunkWorkers)
+            throw std::runtime_error("chunkWorkers must be between 1 and " + std::to_string(maxChunkWorkers));
+
+        if (options.chunkSeconds <= options.overlapSeconds * 2.0)
+            throw std::runtime_error("chunkSeconds must be longer than twice the overlap");
+
+        return options;
+    }
+
+    juce::var resultToVar(const StemSeparator::Result& result)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("input", result.inputFile.getFullPathName());
+        object->setProperty("output", result.outputDirectory.getFullPathName());
+        object->setProperty("audioSeconds", result.audioSeconds);
+        object->setProperty("wallSeconds", result.wallSeconds);
+        object->setProperty("sourceSampleRate", result.sourceSampleRate);
+        object->setProperty("sourceChannels", result.sourceChannels);
+        object->setProperty("scratchAllocations", result.scratchAllocations);
+        object->setProperty("segments", result.numSegments);
+        object->setProperty("cachedSegments", result.numCachedSegments);
+        object->setProperty("silentSegments", result.numSilentSegments);
+        object->setProperty("silentSeconds", result.silentSeconds);
+        object->setProperty("segmentSeconds", result.segmentSeconds);
+        return juce::var(object);
+    }
+
+    StemSeparator::Result resultFromVar(const juce::var& value)
+    {
+        StemSeparator::Result result;
+        result.inputFile = juce::File(value.getProperty("input", {}).toString());
+        result.outputDirectory = juce::File(value.getProperty("output", {}).toString());
+        result.audioSeconds = value.getProperty("audioSeconds", 0.0);
+        result.wallSeconds = value.getProperty("wallSeconds", 0.0);
+        result.sourceSampleRate = value.getProperty("sourceSampleRate", 0.0);
+        result.sourceChannels = value.getProperty("sourceChannels", 0);
+        result.scratchAllocations = value.getProperty("scratchAllocations", 0);
+        result.numSegments = value.getProperty("segments", 0);
+        result.numCachedSegments = value.getProperty("cachedSegments", 0);
+        result.numSilentSegments = value.getProperty("silentSegments", 0);
+        result.silentSeconds = value.getProperty("silentSeconds", 0.0);
+        result.segmentSeconds = value.getProperty("segmentSeconds", 0.0);
+        return result;
+    }
+
+    juce::String makeToken()
+    {
+        std::random_device device;
+        juce::String token;
+        for (int i = 0; i < 8; ++i)
+            token << juce::String::toHexString(static_cast<int>(device())).paddedLeft('0', 8);
+        return token;
+    }
+
+    juce::File getTokenFile(int port)
+    {
+        return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile("DemucsJUCE/server_" + juce::String(port) + ".token");
+    }
+
+    void writeTokenFile(int port, const juce::String& token)
+    {
+        const auto file = getTokenFile(port);
+        if (!file.create())
+            throw std::runtime_error("Could not create " + file.getFullPathName().toStdString());
+
+        // Owner only before the token goes in. On Windows the application data folder
+        // already belongs to the user.
+       #if !JUCE_WINDOWS
+        if (::chmod(file.getFullPathName().toRawUTF8(), S_IRUSR | S_IWUSR) != 0)
+            throw std::runtime_error("Could not restrict access to " + file.getFullPathName().toStdString());
+       #endif
+
+        // Written in place, replacing the file would drop its permissions
+        juce::FileOutputStream stream(file);
+        if (!stream.openedOk() || !stream.setPosition(0) || stream.truncate().failed()
+            || !stream.writeText(token, false, false, nullptr))
+            throw std::runtime_error("Could not write " + file.getFullPathName().toStdString());
+    }
+
+    juce::String readTokenFile(int port)
+    {
+        return getTokenFile(port).loadFileAsString().trim();
+    }
+
+    juce::MemoryBlock toMessage(const juce::var& value)
+    {
+        const auto json = juce::JSON::toString(value, true);
+        return juce::MemoryBlock(json.toRawUTF8(), json.getNumBytesAsUTF8());
+    }
+
+    juce::var fromMessage(const juce::MemoryBlock& message)
+    {
+        return juce::JSON::parse(message.toString());
+    }
+
+    juce::var makeMessage(const juce::String& type, const juce::String& id)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("type", type);
+        if (id.isNotEmpty())
+            object->setProperty("id", id);
+        return juce::var(object);
+    }
+}
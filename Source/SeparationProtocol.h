@@ -0,0 +1,45 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "StemSeparator.h"
+
+// Messages between DemucsServer and its clients. Every InterprocessConnection message is
+// one JSON object with a "type"; job messages carry the client-chosen job "id".
+//
+//   client -> server   separate {id, input, output, model, options}, cancel {id}, stats, shutdown
+//   server -> client   progress {id, progress, message}, done {id, result}, failed {id, error}, stats {...}
+//
+// Jobs name files on the shared filesystem, so the server only listens on localhost. Every
+// client message also carries the server's "token", which it writes to a file only its own
+// user can read, so other users on the machine can't send it jobs.
+namespace SeparationProtocol
+{
+    constexpr int kDefaultPort = 52741;
+    constexpr juce::uint32 kMagic = 0x31534d44; // "DMS1"
+
+    // Everything but the cache. Requests set a "cache" flag instead, whether the server
+    // should use its own stem cache (default true).
+    juce::var optionsToVar(const StemSeparator::Options& options);
+
+    // Throws std::runtime_error for options the server won't run, such as more chunk
+    // workers than it has cores
+    StemSeparator::Options optionsFromVar(const juce::var& value);
+
+    juce::var resultToVar(const StemSeparator::Result& result);
+    StemSeparator::Result resultFromVar(const juce::var& value);
+
+    // A random token per server start, and the file clients read it from, one per port
+    juce::String makeToken();
+    juce::File getTokenFile(int port);
+
+    // Throws std::runtime_error if the file can't be written
+    void writeTokenFile(int port, const juce::String& token);
+
+    // Empty if there's no token file, or it can't be read
+    juce::String readTokenFile(int port);
+
+    juce::MemoryBlock toMessage(const juce::var& value);
+    juce::var fromMessage(const juce::MemoryBlock& message);
+
+    juce::var makeMessage(const juce::String& type, const juce::String& id = {});
+}
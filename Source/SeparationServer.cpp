@@ -0,0 +1,475 @@
+#include "SeparationServer.h"
+#include <algorithm>
+#include <cmath>
+
+class SeparationServer::Connection : public juce::InterprocessConnection
+{
+public:
+    explicit Connection(SeparationServer& owner)
+        : InterprocessConnection(false, SeparationProtocol::kMagic),
+          mOwner(owner)
+    {
+    }
+
+    ~Connection() override
+    {
+        disconnect();
+    }
+
+    void send(const juce::var& message)
+    {
+        const juce::ScopedLock lock(mSendLock);
+        sendMessage(SeparationProtocol::toMessage(message));
+    }
+
+    void connectionMade() override {}
+
+    void connectionLost() override
+    {
+        mOwner.handleConnectionLost(*this);
+    }
+
+    void messageReceived(const juce::MemoryBlock& message) override
+    {
+        mOwner.handleMessage(*this, SeparationProtocol::fromMessage(message));
+    }
+
+private:
+    SeparationServer& mOwner;
+    juce::CriticalSection mSendLock;
+};
+
+class SeparationServer::Worker : public juce::Thread
+{
+public:
+    Worker(SeparationServer& owner, int index)
+        : Thread("DemucsServerWorker" + juce::String(index)),
+          mOwner(owner),
+          mIndex(index)
+    {
+    }
+
+    void run() override
+    {
+        if (mOwner.mThreadPlan != nullptr)
+            ThreadTuner::applyToCurrentThread(*mOwner.mThreadPlan, mIndex);
+
+        std::shared_ptr<Job> job;
+        while (mOwner.takeJob(job, *this))
+        {
+            process(*job);
+            job.reset();
+        }
+    }
+
+private:
+    void process(Job& job)
+    {
+        auto& separator = mSeparators[job.model];
+        if (separator == nullptr)
+            separator = std::make_unique<StemSeparator>(job.model->ensemble);
+
+        // Shared encoder threads, and this worker's cores split between its chunk workers
+        auto options = job.options;
+        options.writePool = mOwner.mWritePool;
+        if (mOwner.mThreadPlan != nullptr)
+            options.threadPlan = std::make_shared<const ThreadTuner::Plan>(
+                ThreadTuner::splitWorker(*mOwner.mThreadPlan, mIndex, options.numChunkWorkers));
+
+        separator->setOptions(options);
+
+        try
+        {
+            const auto result = separator->process(job.inputFile, job.outputDirectory,
+                [&job](float progress, const juce::String& message) {
+                    auto update = SeparationProtocol::makeMessage("progress", job.id);
+                    update.getDynamicObject()->setProperty("progress", progress);
+                    update.getDynamicObject()->setProperty("message", message);
+                    job.connection->send(update);
+                },
+                [this, &job]() {
+                    return job.cancelled || threadShouldExit();
+                });
+
+            auto reply = SeparationProtocol::makeMessage("done", job.id);
+            reply.getDynamicObject()->setProperty("result", SeparationProtocol::resultToVar(result));
+            job.connection->send(reply);
+            mOwner.finishJob(job, true, result.audioSeconds, result.wallSeconds);
+        }
+        catch (const std::exception& e)
+        {
+            fail(job, e.what());
+        }
+        catch (...)
+        {
+            fail(job, "Separation failed");
+        }
+    }
+
+    void fail(const Job& job, const juce::String& error)
+    {
+        auto reply = SeparationProtocol::makeMessage("failed", job.id);
+        reply.getDynamicObject()->setProperty("error", error);
+        job.connection->send(reply);
+        mOwner.finishJob(job, false, 0.0, 0.0);
+    }
+
+    SeparationServer& mOwner;
+    const int mIndex;
+
+    // One warm separator per model this worker has run, with its scratch memory
+    std::map<const Model*, std::unique_ptr<StemSeparator>> mSeparators;
+};
+
+juce::var SeparationServer::Stats::toVar() const
+{
+    auto* object = new juce::DynamicObject();
+    object->setProperty("queued", numQueued);
+    object->setProperty("running", numRunning);
+    object->setProperty("completed", numCompleted);
+    object->setProperty("failed", numFailed);
+    object->setProperty("p50LatencySeconds", p50LatencySeconds);
+    object->setProperty("p99LatencySeconds", p99LatencySeconds);
+    object->setProperty("realtimeFactor", realtimeFactor);
+    return juce::var(object);
+}
+
+SeparationServer::Stats SeparationServer::Stats::fromVar(const juce::var& value)
+{
+    Stats stats;
+    stats.numQueued = value.getProperty("queued", 0);
+    stats.numRunning = value.getProperty("running", 0);
+    stats.numCompleted = value.getProperty("completed", 0);
+    stats.numFailed = value.getProperty("failed", 0);
+    stats.p50LatencySeconds = value.getProperty("p50LatencySeconds", 0.0);
+    stats.p99LatencySeconds = value.getProperty("p99LatencySeconds", 0.0);
+    stats.realtimeFactor = value.getProperty("realtimeFactor", 0.0);
+    return stats;
+}
+
+juce::String SeparationServer::Stats::toString() const
+{
+    return "queued " + juce::String(numQueued) + ", running " + juce::String(numRunning)
+         + ", completed " + juce::String(numCompleted) + ", failed " + juce::String(numFailed)
+         + ", latency p50 " + juce::String(p50LatencySeconds, 2) + " s / p99 " + juce::String(p99LatencySeconds, 2) + " s"
+         + ", RTF " + juce::String(realtimeFactor, 3);
+}
+
+SeparationServer::SeparationServer(std::vector<Model> models, int numWorkers)
+    : mModels(std::move(models)),
+      mNumWorkers(juce::jmax(1, numWorkers))
+{
+    jassert(!mModels.empty());
+}
+
+SeparationServer::~SeparationServer()
+{
+    stop();
+}
+
+bool SeparationServer::start(int port)
+{
+    // Set before the first connection can read it, written out once the port is ours so a
+    // second server can't replace the token of the one already running
+    mToken = SeparationProtocol::makeToken();
+    if (!beginWaitingForSocket(port, "127.0.0.1"))
+        return false;
+
+    try
+    {
+        SeparationProtocol::writeTokenFile(port, mToken);
+        mTokenFile = SeparationProtocol::getTokenFile(port);
+    }
+    catch (const std::exception&)
+    {
+        InterprocessConnectionServer::stop();
+        throw;
+    }
+
+    for (int i = 0; i < mNumWorkers; ++i)
+    {
+        mWorkers.add(new Worker(*this, i));
+        mWorkers.getLast()->startThread();
+    }
+
+    return true;
+}
+
+void SeparationServer::stop()
+{
+    InterprocessConnectionServer::stop();
+
+    if (mTokenFile != juce::File())
+        mTokenFile.deleteFile();
+    mTokenFile = juce::File();
+
+    {
+        const std::lock_guard<std::mutex> lock(mLock);
+        mStopping = true;
+        for (auto& job : mRunning)
+            job->cancelled = true;
+    }
+    mJobAvailable.notify_all();
+
+    for (auto* worker : mWorkers)
+        worker->stopThread(-1);
+    mWorkers.clear();
+
+    std::vector<std::shared_ptr<Connection>> connections;
+    std::vector<std::shared_ptr<Connection>> lost;
+    {
+        const std::lock_guard<std::mutex> lock(mLock);
+        connections.swap(mConnections);
+        lost.swap(mLostConnections);
+        mQueue.clear();
+    }
+
+    for (auto& connection : connections)
+        connection->disconnect();
+}
+
+SeparationServer::Stats SeparationServer::getStats() const
+{
+    const std::lock_guard<std::mutex> lock(mLock);
+
+    auto stats = mTotals;
+    stats.numQueued = static_cast<int>(mQueue.size());
+    stats.numRunning = static_cast<int>(mRunning.size());
+    stats.realtimeFactor = mTotalAudioSeconds > 0.0 ? mTotalWallSeconds / mTotalAudioSeconds : 0.0;
+
+    if (!mLatencies.empty())
+    {
+        std::vector<double> sorted(mLatencies.begin(), mLatencies.end());
+        std::sort(sorted.begin(), sorted.end());
+        const auto last = static_cast<double>(sorted.size() - 1);
+        stats.p50LatencySeconds = sorted[static_cast<size_t>(std::ceil(last * 0.5))];
+        stats.p99LatencySeconds = sorted[static_cast<size_t>(std::ceil(last * 0.99))];
+    }
+
+    return stats;
+}
+
+bool SeparationServer::waitForShutdownRequest(int timeoutMilliseconds)
+{
+    return mShutdownRequested.wait(timeoutMilliseconds);
+}
+
+juce::InterprocessConnection* SeparationServer::createConnectionObject()
+{
+    const std::lock_guard<std::mutex> lock(mLock);
+    mConnections.push_back(std::make_shared<Connection>(*this));
+    return mConnections.back().get();
+}
+
+void SeparationServer::handleMessage(Connection& connection, const juce::var& message)
+{
+    const auto type = message.getProperty("type", {}).toString();
+    const auto id = message.getProperty("id", {}).toString();
+
+    if (message.getProperty("token", {}).toString() != mToken)
+    {
+        auto reply = SeparationProtocol::makeMessage("failed", id);
+        reply.getDynamicObject()->setProperty("error", "Wrong or missing server token");
+        connection.send(reply);
+        return;
+    }
+
+    if (type == "separate")
+    {
+        auto job = std::make_shared<Job>();
+        job->id = id;
+        job->connection = findConnection(connection);
+        job->receivedMilliseconds = juce::Time::getMillisecondCounterHiRes();
+
+        if (job->connection == nullptr)
+            return;
+
+        try
+        {
+            // The server has its own working directory, so only absolute paths make sense
+            const auto input = message.getProperty("input", {}).toString();
+            const auto output = message.getProperty("output", {}).toString();
+            if (!juce::File::isAbsolutePath(input) || (output.isNotEmpty() && !juce::File::isAbsolutePath(output)))
+                throw std::runtime_error("Paths have to be absolute");
+
+            job->inputFile = juce::File(input);
+            job->outputDirectory = output.isNotEmpty() ? juce::File(output) : StemSeparator::getDefaultOutputDirectory(job->inputFile);
+
+            if (!job->inputFile.existsAsFile())
+                throw std::runtime_error("Input file not found: " + input.toStdString());
+
+            if (!isAllowedOutputDirectory(job->inputFile, job->outputDirectory))
+                throw std::runtime_error("Output directory has to be in the input's folder or under an output root of the server: "
+                                         + job->outputDirectory.getFullPathName().toStdString());
+
+            const auto modelName = message.getProperty("model", {}).toString();
+            if (modelName.isEmpty())
+                job->model = &mModels.front();
+
+            for (const auto& model : mModels)
+                if (model.name == modelName)
+                    job->model = &model;
+
+            if (job->model == nullptr)
+                throw std::runtime_error("Unknown model: " + modelName.toStdString());
+
+            job->options = SeparationProtocol::optionsFromVar(message.getProperty("options", {}));
+            if (message.getProperty("options", {}).getProperty("cache", true))
+                job->options.cache = job->model->cache;
+        }
+        catch (const std::exception& e)
+        {
+            auto reply = SeparationProtocol::makeMessage("failed", id);
+            reply.getDynamicObject()->setProperty("error", juce::String(e.what()));
+            connection.send(reply);
+            return;
+        }
+
+        {
+            const std::lock_guard<std::mutex> lock(mLock);
+            mQueue.push_back(std::move(job));
+        }
+        mJobAvailable.notify_one();
+    }
+    else if (type == "cancel")
+    {
+        std::shared_ptr<Job> removed;
+        {
+            const std::lock_guard<std::mutex> lock(mLock);
+            for (auto it = mQueue.begin(); it != mQueue.end(); ++it)
+            {
+                if ((*it)->id == id && (*it)->connection.get() == &connection)
+                {
+                    removed = *it;
+                    mQueue.erase(it);
+                    break;
+                }
+            }
+
+            for (auto& job : mRunning)
+                if (job->id == id && job->connection.get() == &connection)
+                    job->cancelled = true;
+        }
+
+        if (removed != nullptr)
+        {
+            auto reply = SeparationProtocol::makeMessage("failed", id);
+            reply.getDynamicObject()->setProperty("error", "Processing cancelled by user");
+            connection.send(reply);
+        }
+    }
+    else if (type == "stats")
+    {
+        auto reply = getStats().toVar();
+        reply.getDynamicObject()->setProperty("type", "stats");
+        reply.getDynamicObject()->setProperty("id", id);
+        connection.send(reply);
+    }
+    else if (type == "shutdown")
+    {
+        mShutdownRequested.signal();
+    }
+}
+
+void SeparationServer::handleConnectionLost(Connection& connection)
+{
+    {
+        const std::lock_guard<std::mutex> lock(mLock);
+
+        // Deleting a connection waits for its thread, which is this one, so a worker does it
+        const auto it = std::find_if(mConnections.begin(), mConnections.end(),
+                                     [&connection](const auto& candidate) { return candidate.get() == &connection; });
+        if (it != mConnections.end())
+        {
+            mLostConnections.push_back(*it);
+            mConnections.erase(it);
+        }
+
+        mQueue.erase(std::remove_if(mQueue.begin(), mQueue.end(),
+                                    [&connection](const auto& job) { return job->connection.get() == &connection; }),
+                     mQueue.end());
+
+        for (auto& job : mRunning)
+            if (job->connection.get() == &connection)
+                job->cancelled = true;
+    }
+    mJobAvailable.notify_one();
+}
+
+bool SeparationServer::takeJob(std::shared_ptr<Job>& job, Worker& worker)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    for (;;)
+    {
+        mJobAvailable.wait(lock, [this, &worker] {
+            return mStopping || worker.threadShouldExit() || !mQueue.empty() || !mLostConnections.empty();
+        });
+
+        if (mStopping || worker.threadShouldExit())
+            return false;
+
+        if (mLostConnections.empty())
+            break;
+
+        // Outside the lock, their threads may still be waiting for it
+        auto lost = std::move(mLostConnections);
+        mLostConnections.clear();
+        lock.unlock();
+        lost.clear();
+        lock.lock();
+    }
+
+    job = mQueue.front();
+    mQueue.pop_front();
+    mRunning.push_back(job);
+    return true;
+}
+
+void SeparationServer::finishJob(const Job& job, bool succeeded, double audioSeconds, double wallSeconds)
+{
+    const std::lock_guard<std::mutex> lock(mLock);
+
+    mRunning.erase(std::remove_if(mRunning.begin(), mRunning.end(),
+                                  [&job](const auto& running) { return running.get() == &job; }),
+                   mRunning.end());
+
+    if (!succeeded)
+    {
+        ++mTotals.numFailed;
+        return;
+    }
+
+    ++mTotals.numCompleted;
+    mTotalAudioSeconds += audioSeconds;
+    mTotalWallSeconds += wallSeconds;
+
+    mLatencies.push_back((juce::Time::getMillisecondCounterHiRes() - job.receivedMilliseconds) / 1000.0);
+    if (static_cast<int>(mLatencies.size()) > kLatencyWindow)
+        mLatencies.pop_front();
+}
+
+std::shared_ptr<SeparationServer::Connection> SeparationServer::findConnection(const Connection& connection) const
+{
+    const std::lock_guard<std::mutex> lock(mLock);
+    for (const auto& candidate : mConnections)
+        if (candidate.get() == &connection)
+            return candidate;
+
+    return {};
+}
+
+bool SeparationServer::isAllowedOutputDirectory(const juce::File& inputFile, const juce::File& outputDirectory) const
+{
+    // Writing stems replaces files of the same name, and ".." could step out of any root
+    if (juce::StringArray::fromTokens(outputDirectory.getFullPathName(), juce::File::getSeparatorString(), {}).contains(".."))
+        return false;
+
+    auto isWithin = [&outputDirectory](const juce::File& root)
+    {
+        return outputDirectory == root || outputDirectory.isAChildOf(root);
+    };
+
+    return isWithin(inputFile.getParentDirectory())
+        || std::any_of(mOutputRoots.begin(), mOutputRoots.end(), isWithin);
+}
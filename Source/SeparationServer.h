@@ -0,0 +1,121 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "SeparationProtocol.h"
+#include "StemSeparator.h"
+
+// Keeps models resident and separates files for SeparationClients over a localhost
+// socket, see SeparationProtocol. Only clients that send the token from the server's
+// token file are served. Jobs from every connection share one queue and a pool
+// of workers, each with its own StemSeparator per model, so concurrent requests run on
+// warm separators without any process start or model load.
+class SeparationServer : private juce::InterprocessConnectionServer
+{
+public:
+    // A single model or an ensemble, see ModelRegistry
+    struct Model
+    {
+        juce::String name;
+        std::shared_ptr<const ModelEnsemble> ensemble;
+        std::shared_ptr<StemCache> cache;
+    };
+
+    struct Stats
+    {
+        int numQueued { 0 };
+        int numRunning { 0 };
+        juce::int64 numCompleted { 0 };
+        juce::int64 numFailed { 0 };
+
+        // Request latency, receipt to completion, over the last kLatencyWindow jobs
+        double p50LatencySeconds { 0.0 };
+        double p99LatencySeconds { 0.0 };
+
+        // Total separation wall time over total audio duration
+        double realtimeFactor { 0.0 };
+
+        juce::var toVar() const;
+        static Stats fromVar(const juce::var& value);
+        juce::String toString() const;
+    };
+
+    // The first model is the default for requests that don't name one
+    SeparationServer(std::vector<Model> models, int numWorkers);
+    ~SeparationServer() override;
+
+    // Workers pin themselves to the plan's cores, call before start(). See ThreadTuner.
+    void setThreadPlan(std::shared_ptr<const ThreadTuner::Plan> plan) { mThreadPlan = std::move(plan); }
+
+    // Stems go to the input file's folder or below it, or below one of these roots.
+    // Requests for any other output directory fail. Call before start().
+    void setOutputRoots(juce::Array<juce::File> roots) { mOutputRoots = std::move(roots); }
+
+    // Listens on 127.0.0.1 only and writes the token file for the port. Returns false if
+    // the port is taken, throws std::runtime_error if the token file can't be written.
+    bool start(int port);
+    void stop();
+
+    Stats getStats() const;
+
+    // True once a client sent "shutdown"
+    bool waitForShutdownRequest(int timeoutMilliseconds);
+
+    static constexpr int kLatencyWindow = 1000;
+
+private:
+    class Connection;
+    class Worker;
+
+    struct Job
+    {
+        juce::String id;
+        std::shared_ptr<Connection> connection;
+        juce::File inputFile;
+        juce::File outputDirectory;
+        const Model* model { nullptr };
+        StemSeparator::Options options;
+        double receivedMilliseconds { 0.0 };
+        std::atomic<bool> cancelled { false };
+    };
+
+    juce::InterprocessConnection* createConnectionObject() override;
+
+    void handleMessage(Connection& connection, const juce::var& message);
+    void handleConnectionLost(Connection& connection);
+    bool takeJob(std::shared_ptr<Job>& job, Worker& worker);
+    void finishJob(const Job& job, bool succeeded, double audioSeconds, double wallSeconds);
+    std::shared_ptr<Connection> findConnection(const Connection& connection) const;
+    bool isAllowedOutputDirectory(const juce::File& inputFile, const juce::File& outputDirectory) const;
+
+    std::vector<Model> mModels;
+    const int mNumWorkers;
+    std::shared_ptr<const ThreadTuner::Plan> mThreadPlan;
+    juce::Array<juce::File> mOutputRoots;
+    juce::String mToken;
+    juce::File mTokenFile;
+    std::shared_ptr<juce::ThreadPool> mWritePool { std::make_shared<juce::ThreadPool>(StemSeparator::kNumStems) };
+    juce::OwnedArray<Worker> mWorkers;
+
+    mutable std::mutex mLock;
+    std::condition_variable mJobAvailable;
+    std::vector<std::shared_ptr<Connection>> mConnections;
+    std::vector<std::shared_ptr<Connection>> mLostConnections; // to be deleted by a worker
+    std::deque<std::shared_ptr<Job>> mQueue;
+    std::vector<std::shared_ptr<Job>> mRunning;
+    bool mStopping { false };
+
+    Stats mTotals;
+    std::deque<double> mLatencies;
+    double mTotalAudioSeconds { 0.0 };
+    double mTotalWallSeconds { 0.0 };
+
+    juce::WaitableEvent mShutdownRequested { true };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SeparationServer)
+};
@@ -0,0 +1,300 @@
+#include <JuceHeader.h>
+#include <iostream>
+#include <memory>
+#include "ModelDownloader.h"
+#include "ModelLoader.h"
+#include "ModelRegistry.h"
+#include "SeparationClient.h"
+#include "SeparationServer.h"
+
+namespace
+{
+    struct ServerOptions
+    {
+        juce::Array<juce::File> modelFiles;
+        juce::StringArray presets;
+        int port { SeparationProtocol::kDefaultPort };
+        int numWorkers { juce::jmax(1, juce::SystemStats::getNumPhysicalCpus() / 2) };
+        bool numWorkersGiven { false };
+        bool autoThreads { false };
+        bool recalibrateThreads { false };
+        juce::File cacheDirectory;
+        juce::Array<juce::File> outputRoots;
+        juce::int64 cacheMaxBytes { StemCache::kDefaultMaxBytes };
+        bool printStats { false };
+        bool shutdown { false };
+    };
+
+    juce::String getPresetNames()
+    {
+        juce::StringArray names;
+        for (const auto& preset : ModelRegistry::getPresets())
+            names.add(preset.name);
+        return names.joinIntoString(", ");
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: DemucsServer [options]\n"
+                  << "\n"
+                  << "Keeps models loaded and separates files for DemucsBatch --server and the app.\n"
+                  << "\n"
+                  << "Options:\n"
+                  << "  --model <file>        Model to keep loaded, repeat for several; requests pick one by file name\n"
+                  << "                        (default: " << ModelDownloader::getDefaultModelFile().getFullPathName() << ")\n"
+                  << "  --ensemble <name>     Preset from the model folder to keep loaded, requests pick it by name:\n"
+                  << "                        " << getPresetNames() << "\n"
+                  << "  --port <n>            Port on 127.0.0.1 (default: " << SeparationProtocol::kDefaultPort << ")\n"
+                  << "  --workers <n>         Files separated at once (default: half the physical cores)\n"
+                  << "  --auto-threads        Pick the worker count and BLAS threads per worker from a calibration run\n"
+                  << "                        cached for this machine, and pin workers to their cores (with --workers: split evenly)\n"
+                  << "  --recalibrate         Run the --auto-threads calibration again\n"
+                  << "  --cache <dir>         Stem cache, one subfolder per model (default: the app's cache)\n"
+                  << "  --cache-size <MB>     Size limit for each model's cache (default: 4096)\n"
+                  << "  --output-root <dir>   Also accept output directories under <dir>, repeat for several\n"
+                  << "                        (default: only the input file's folder and below)\n"
+                  << "\n"
+                  << "Talking to a running server:\n"
+                  << "  --stats               Print queue depth, latency percentiles and realtime factor\n"
+                  << "  --shutdown            Ask the server to exit\n"
+                  << "  --help                Show this message\n";
+    }
+
+    ServerOptions parseArguments(const juce::ArgumentList& args)
+    {
+        ServerOptions options;
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+
+            auto nextValue = [&]()
+            {
+                if (i + 1 >= args.size())
+                    throw std::runtime_error("Missing value for " + arg.text.toStdString());
+                return args[++i].text;
+            };
+
+            auto nextFile = [&]()
+            {
+                return juce::File::getCurrentWorkingDirectory().getChildFile(nextValue().unquoted());
+            };
+
+            if (arg == "--model")
+            {
+                options.modelFiles.add(nextFile());
+            }
+            else if (arg == "--ensemble")
+            {
+                const auto name = nextValue();
+                if (ModelRegistry::findPreset(name) == nullptr)
+                    throw std::runtime_error("Unknown ensemble " + name.toStdString() + ", expected one of " + getPresetNames().toStdString());
+                options.presets.add(name);
+            }
+            else if (arg == "--port")
+            {
+                options.port = nextValue().getIntValue();
+                if (options.port <= 0 || options.port > 65535)
+                    throw std::runtime_error("--port must be between 1 and 65535");
+            }
+            else if (arg == "--workers")
+            {
+                options.numWorkers = nextValue().getIntValue();
+                options.numWorkersGiven = true;
+                if (options.numWorkers < 1)
+                    throw std::runtime_error("--workers must be at least 1");
+            }
+            else if (arg == "--auto-threads")
+            {
+                options.autoThreads = true;
+            }
+            else if (arg == "--recalibrate")
+            {
+                options.autoThreads = true;
+                options.recalibrateThreads = true;
+            }
+            else if (arg == "--cache")
+            {
+                options.cacheDirectory = nextFile();
+            }
+            else if (arg == "--cache-size")
+            {
+                options.cacheMaxBytes = nextValue().getLargeIntValue() * 1024 * 1024;
+                if (options.cacheMaxBytes <= 0)
+                    throw std::runtime_error("--cache-size must be positive");
+            }
+            else if (arg == "--output-root")
+            {
+                options.outputRoots.add(nextFile());
+            }
+            else if (arg == "--stats")
+            {
+                options.printStats = true;
+            }
+            else if (arg == "--shutdown")
+            {
+                options.shutdown = true;
+            }
+            else
+            {
+                throw std::runtime_error("Unknown option: " + arg.text.toStdString());
+            }
+        }
+
+        if (options.modelFiles.isEmpty() && options.presets.isEmpty())
+            options.modelFiles.add(ModelDownloader::getDefaultModelFile());
+
+        return options;
+    }
+
+    int runClientCommand(const ServerOptions& options)
+    {
+        SeparationClient client;
+        if (!client.connect(options.port))
+        {
+            std::cerr << "Error: no server of this user on port " << options.port << std::endl;
+            return 1;
+        }
+
+        try
+        {
+            if (options.printStats)
+                std::cout << client.getStats().toString() << std::endl;
+
+            if (options.shutdown)
+                client.requestShutdown();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    ServerOptions options;
+    try
+    {
+        options = parseArguments(args);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+
+    if (options.printStats || options.shutdown)
+        return runClientCommand(options);
+
+    const auto cacheRoot = options.cacheDirectory != juce::File() ? options.cacheDirectory : StemCache::getDefaultDirectory();
+
+    std::vector<SeparationServer::Model> models;
+    auto addModel = [&](const juce::String& name, std::shared_ptr<const ModelEnsemble> ensemble,
+                        const std::vector<ModelLoader::Stats>& stats)
+    {
+        for (const auto& modelStats : stats)
+            std::cout << modelStats.toString() << std::endl;
+
+        SeparationServer::Model model;
+        model.name = name;
+        model.cache = std::make_shared<StemCache>(cacheRoot.getChildFile(name), ensemble->getModelFiles(),
+                                                  ensemble->getWeightsTag(), options.cacheMaxBytes);
+        model.ensemble = std::move(ensemble);
+        models.push_back(std::move(model));
+    };
+
+    try
+    {
+        for (const auto& file : options.modelFiles)
+        {
+            std::cout << "Loading model " << file.getFullPathName() << std::endl;
+            std::vector<ModelLoader::Stats> stats;
+            auto ensemble = ModelRegistry::load(juce::Array<juce::File> { file }, &stats);
+            addModel(file.getFileNameWithoutExtension(), std::move(ensemble), stats);
+        }
+
+        for (const auto& name : options.presets)
+        {
+            const auto& preset = *ModelRegistry::findPreset(name);
+            std::cout << "Loading " << preset.name << " (" << preset.description << ")" << std::endl;
+            std::vector<ModelLoader::Stats> stats;
+            auto ensemble = ModelRegistry::load(preset, ModelDownloader::getModelDirectory(), &stats);
+            addModel(preset.name, std::move(ensemble), stats);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+
+    std::shared_ptr<const ThreadTuner::Plan> threadPlan;
+    if (options.autoThreads)
+    {
+        const auto topology = ThreadTuner::Topology::detect();
+        std::cout << "CPU: " << topology.toString() << std::endl;
+
+        try
+        {
+            auto plan = options.numWorkersGiven
+                ? ThreadTuner::makePlan(topology, options.numWorkers)
+                : ThreadTuner::getTunedPlan(*models.front().ensemble->getMember(0).model, topology, options.recalibrateThreads,
+                                            [](const juce::String& message) { std::cout << message << std::endl; });
+
+            options.numWorkers = plan.numWorkers;
+            threadPlan = std::make_shared<const ThreadTuner::Plan>(std::move(plan));
+            std::cout << "Threads: " << threadPlan->toString() << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    SeparationServer server(std::move(models), options.numWorkers);
+    server.setThreadPlan(threadPlan);
+    server.setOutputRoots(options.outputRoots);
+    try
+    {
+        if (!server.start(options.port))
+        {
+            std::cerr << "Error: could not listen on port " << options.port << std::endl;
+            return 2;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+
+    std::cout << "Listening on 127.0.0.1:" << options.port << " with " << options.numWorkers << " worker(s), token in "
+              << SeparationProtocol::getTokenFile(options.port).getFullPathName() << std::endl;
+
+    // A stats line whenever something changed, until a client asks for shutdown
+    juce::String lastStats;
+    while (!server.waitForShutdownRequest(5000))
+    {
+        const auto stats = server.getStats().toString();
+        if (stats != lastStats)
+            std::cout << stats << std::endl;
+        lastStats = stats;
+    }
+
+    std::cout << "Shutting down" << std::endl;
+    server.stop();
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include "StemCache.h"
+#include "HalfFloat.h"
+#include <limits>
+
+namespace
+{
+    constexpr const char* kFileExtension = ".stems";
+    constexpr int kMagic = 0x31435344; // "DSC1"
+
+    // Anything that changes the stems for the same model and samples belongs in here
+    constexpr const char* kSettingsTag = "demucs_inference/44100/stereo/fp16-v1";
+
+    // InputStream::read takes an int byte count
+    bool fitsInOneRead(size_t numValues)
+    {
+        return numValues * sizeof(juce::uint16) <= static_cast<size_t>(std::numeric_limits<int>::max());
+    }
+}
+
+StemCache::StemCache(const juce::File& directory, const juce::File& modelFile, juce::int64 maxBytes)
+    : StemCache(directory, juce::Array<juce::File> { modelFile }, {}, maxBytes)
+{
+}
+
+StemCache::StemCache(const juce::File& directory, const juce::Array<juce::File>& modelFiles,
+                     const juce::String& weightsTag, juce::int64 maxBytes)
+    : mDirectory(directory),
+      mModelFiles(modelFiles),
+      mWeightsTag(weightsTag),
+      mMaxBytes(maxBytes)
+{
+    if (mModelFiles.isEmpty())
+        throw std::runtime_error("The stem cache needs a model file");
+
+    if (!mDirectory.createDirectory())
+        throw std::runtime_error("Could not create cache directory: " + mDirectory.getFullPathName().toStdString());
+
+    for (const auto& file : mDirectory.findChildFiles(juce::File::findFiles, false, juce::String("*") + kFileExtension))
+    {
+        Entry entry;
+        entry.bytes = file.getSize();
+        entry.lastUsed = file.getLastModificationTime().toMilliseconds();
+        mEntries[file.getFileNameWithoutExtension()] = entry;
+        mStats.bytes += entry.bytes;
+    }
+
+    const std::lock_guard<std::mutex> lock(mLock);
+    evictLocked();
+}
+
+juce::File StemCache::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+           .getChildFile("DemucsJUCE/stem_cache");
+}
+
+juce::String StemCache::makeKey(const Eigen::MatrixXf& audio)
+{
+    std::call_once(mModelHashOnce, [this]
+    {
+        juce::MemoryOutputStream hashes;
+        for (const auto& file : mModelFiles)
+        {
+            juce::FileInputStream stream(file);
+            if (stream.failedToOpen())
+                throw std::runtime_error("Could not read model file: " + file.getFullPathName().toStdString());
+
+            hashes << juce::SHA256(stream).getRawData();
+        }
+
+        // A single model keeps its plain file hash, so existing entries stay valid
+        if (mModelFiles.size() == 1 && mWeightsTag.isEmpty())
+        {
+            mModelHash = hashes.getMemoryBlock();
+            return;
+        }
+
+        hashes.writeString(mWeightsTag);
+        mModelHash = juce::SHA256(hashes.getData(), hashes.getDataSize()).getRawData();
+    });
+
+    const juce::SHA256 samplesHash(audio.data(), static_cast<size_t>(audio.size()) * sizeof(float));
+
+    juce::MemoryOutputStream keyData;
+    keyData << mModelHash << samplesHash.getRawData();
+    keyData.writeString(kSettingsTag);
+    keyData.writeInt(static_cast<int>(audio.rows()));
+    keyData.writeInt64(static_cast<juce::int64>(audio.cols()));
+
+    return juce::SHA256(keyData.getData(), keyData.getDataSize()).toHexString();
+}
+
+bool StemCache::load(const juce::String& key, Eigen::Tensor3dXf& stems)
+{
+    {
+        const std::lock_guard<std::mutex> lock(mLock);
+        if (mEntries.find(key) == mEntries.end())
+        {
+            ++mStats.misses;
+            return false;
+        }
+    }
+
+    juce::FileInputStream stream(getEntryFile(key));
+    bool valid = stream.openedOk() && stream.readInt() == kMagic;
+
+    const int numStems = valid ? stream.readInt() : 0;
+    const int numChannels = valid ? stream.readInt() : 0;
+    const int numSamples = valid ? stream.readInt() : 0;
+    const auto numValues = static_cast<size_t>(numStems) * static_cast<size_t>(numChannels) * static_cast<size_t>(numSamples);
+    valid = valid && numValues > 0 && fitsInOneRead(numValues)
+                  && stream.getNumBytesRemaining() == static_cast<juce::int64>(numValues * sizeof(juce::uint16));
+
+    if (valid)
+    {
+        juce::HeapBlock<juce::uint16> halfStems(numValues);
+        valid = stream.read(halfStems.get(), static_cast<int>(numValues * sizeof(juce::uint16)))
+                    == static_cast<int>(numValues * sizeof(juce::uint16));
+
+        if (valid)
+        {
+            stems.resize(numStems, numChannels, numSamples);
+            HalfFloat::toFloat(halfStems.get(), stems.data(), numValues);
+        }
+    }
+
+    const std::lock_guard<std::mutex> lock(mLock);
+    if (!valid)
+    {
+        // Truncated or foreign file, drop it and recompute
+        auto it = mEntries.find(key);
+        if (it != mEntries.end())
+        {
+            mStats.bytes -= it->second.bytes;
+            mEntries.erase(it);
+        }
+        getEntryFile(key).deleteFile();
+        ++mStats.misses;
+        return false;
+    }
+
+    touch(key);
+    ++mStats.hits;
+    return true;
+}
+
+void StemCache::store(const juce::String& key, const Eigen::Tensor3dXf& stems)
+{
+    const auto numValues = static_cast<size_t>(stems.size());
+    if (!fitsInOneRead(numValues))
+        return;
+
+    juce::HeapBlock<juce::uint16> halfStems(numValues);
+    HalfFloat::fromFloat(stems.data(), halfStems.get(), numValues);
+
+    // Written next to the final file and renamed, so readers never see a partial entry
+    const auto file = getEntryFile(key);
+    juce::TemporaryFile temporary(file);
+    {
+        juce::FileOutputStream stream(temporary.getFile());
+        if (stream.failedToOpen())
+            return;
+
+        stream.writeInt(kMagic);
+        stream.writeInt(static_cast<int>(stems.dimension(0)));
+        stream.writeInt(static_cast<int>(stems.dimension(1)));
+        stream.writeInt(static_cast<int>(stems.dimension(2)));
+        stream.write(halfStems.get(), numValues * sizeof(juce::uint16));
+        stream.flush();
+
+        if (stream.getStatus().failed())
+            return;
+    }
+
+    const std::lock_guard<std::mutex> lock(mLock);
+    if (!temporary.overwriteTargetFileWithTemporary())
+        return;
+
+    auto& entry = mEntries[key];
+    mStats.bytes += file.getSize() - entry.bytes;
+    entry.bytes = file.getSize();
+    entry.lastUsed = juce::Time::currentTimeMillis();
+
+    evictLocked();
+}
+
+StemCache::Stats StemCache::getStats() const
+{
+    const std::lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
+
+juce::File StemCache::getEntryFile(const juce::String& key) const
+{
+    return mDirectory.getChildFile(key + kFileExtension);
+}
+
+void StemCache::touch(const juce::String& key)
+{
+    // The modification time doubles as the LRU timestamp for the next session
+    auto it = mEntries.find(key);
+    if (it == mEntries.end())
+        return;
+
+    const auto now = juce::Time::getCurrentTime();
+    it->second.lastUsed = now.toMilliseconds();
+    getEntryFile(key).setLastModificationTime(now);
+}
+
+void StemCache::evictLocked()
+{
+    while (mStats.bytes > mMaxBytes && !mEntries.empty())
+    {
+        auto oldest = mEntries.begin();
+        for (auto it = mEntries.begin(); it != mEntries.end(); ++it)
+            if (it->second.lastUsed < oldest->second.lastUsed)
+                oldest = it;
+
+        getEntryFile(oldest->first).deleteFile();
+        mStats.bytes -= oldest->second.bytes;
+        ++mStats.evictions;
+        mEntries.erase(oldest);
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include "model.hpp"
+
+// On-disk cache of separated segments, keyed by a SHA-256 of the model file(s), the
+// inference settings and the segment's input samples. Resubmitting a track, or an edit of
+// it, only runs inference on the segments whose samples changed. Stems are stored as FP16
+// (see HalfFloat.h), one file per segment, and the least recently used files are deleted
+// once the cache grows past its size limit. Thread safe; one cache can be shared by every
+// separator that runs the same model or ensemble.
+class StemCache
+{
+public:
+    struct Stats
+    {
+        int hits { 0 };
+        int misses { 0 };
+        int evictions { 0 };
+        juce::int64 bytes { 0 };
+    };
+
+    StemCache(const juce::File& directory, const juce::File& modelFile, juce::int64 maxBytes);
+
+    // For an ensemble: every member's file and the weights that combine them, see
+    // ModelEnsemble::getWeightsTag()
+    StemCache(const juce::File& directory, const juce::Array<juce::File>& modelFiles,
+              const juce::String& weightsTag, juce::int64 maxBytes);
+
+    // Hashes the model files on first use, which reads them once
+    juce::String makeKey(const Eigen::MatrixXf& audio);
+
+    bool load(const juce::String& key, Eigen::Tensor3dXf& stems);
+    void store(const juce::String& key, const Eigen::Tensor3dXf& stems);
+
+    Stats getStats() const;
+    const juce::File& getDirectory() const { return mDirectory; }
+
+    static juce::File getDefaultDirectory();
+    static constexpr juce::int64 kDefaultMaxBytes = 4LL * 1024 * 1024 * 1024;
+
+private:
+    struct Entry
+    {
+        juce::int64 bytes { 0 };
+        juce::int64 lastUsed { 0 };
+    };
+
+    juce::File getEntryFile(const juce::String& key) const;
+    void touch(const juce::String& key);
+    void evictLocked();
+
+    const juce::File mDirectory;
+    const juce::Array<juce::File> mModelFiles;
+    const juce::String mWeightsTag;
+    const juce::int64 mMaxBytes;
+
+    std::once_flag mModelHashOnce;
+    juce::MemoryBlock mModelHash;
+
+    mutable std::mutex mLock;
+    std::map<juce::String, Entry> mEntries;
+    Stats mStats;
+};
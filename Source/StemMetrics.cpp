@@ -0,0 +1,106 @@
+#include "StemMetrics.h"
+#include "StemSeparator.h"
+
+double StemMetrics::computeSdr(juce::AudioFormatReader& reference, juce::AudioFormatReader& estimate)
+{
+    constexpr int blockSize = 65536;
+    const int numChannels = static_cast<int>(juce::jmin(reference.numChannels, estimate.numChannels));
+    const auto numSamples = juce::jmin(reference.lengthInSamples, estimate.lengthInSamples);
+
+    juce::AudioBuffer<float> referenceBlock(numChannels, blockSize);
+    juce::AudioBuffer<float> estimateBlock(numChannels, blockSize);
+
+    double signal = 0.0;
+    double distortion = 0.0;
+
+    for (juce::int64 start = 0; start < numSamples; start += blockSize)
+    {
+        const int num = static_cast<int>(juce::jmin(static_cast<juce::int64>(blockSize), numSamples - start));
+        reference.read(&referenceBlock, 0, num, start, true, true);
+        estimate.read(&estimateBlock, 0, num, start, true, true);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const float* ref = referenceBlock.getReadPointer(ch);
+            const float* est = estimateBlock.getReadPointer(ch);
+            for (int i = 0; i < num; ++i)
+            {
+                const double diff = static_cast<double>(ref[i]) - est[i];
+                signal += static_cast<double>(ref[i]) * ref[i];
+                distortion += diff * diff;
+            }
+        }
+    }
+
+    // Small epsilon keeps silent and identical stems finite
+    constexpr double epsilon = 1.0e-12;
+    return 10.0 * std::log10((signal + epsilon) / (distortion + epsilon));
+}
+
+double StemMetrics::Comparison::getMeanSdr() const
+{
+    if (sdr.isEmpty())
+        return 0.0;
+
+    double sum = 0.0;
+    for (auto value : sdr)
+        sum += value;
+    return sum / sdr.size();
+}
+
+juce::String StemMetrics::Comparison::toString() const
+{
+    juce::StringArray parts;
+    for (int i = 0; i < stemNames.size(); ++i)
+        parts.add(stemNames[i] + " " + juce::String(sdr[i], 1));
+
+    return "SDR vs reference (dB): " + parts.joinIntoString(", ") + ", mean " + juce::String(getMeanSdr(), 2);
+}
+
+StemMetrics::Comparison StemMetrics::compareStems(const juce::File& inputFile,
+                                                  const juce::File& referenceDirectory,
+                                                  const juce::File& estimateDirectory)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    Comparison comparison;
+    for (int stem = 0; stem < StemSeparator::kNumStems; ++stem)
+    {
+        const auto referenceFile = StemSeparator::findStemFile(inputFile, referenceDirectory, stem);
+        const auto estimateFile = StemSeparator::findStemFile(inputFile, estimateDirectory, stem);
+
+        // 4-stem models don't write guitar and piano
+        if (!referenceFile.existsAsFile() && !estimateFile.existsAsFile())
+            continue;
+
+        std::unique_ptr<juce::AudioFormatReader> reference(formatManager.createReaderFor(referenceFile));
+        std::unique_ptr<juce::AudioFormatReader> estimate(formatManager.createReaderFor(estimateFile));
+
+        if (!reference)
+            throw std::runtime_error("Missing reference stem: " + referenceFile.getFullPathName().toStdString());
+
+        if (!estimate)
+            throw std::runtime_error("Missing stem: " + estimateFile.getFullPathName().toStdString());
+
+        const auto describe = [&] { return estimateFile.getFileName().toStdString() + " and its reference"; };
+
+        if (reference->sampleRate != estimate->sampleRate)
+            throw std::runtime_error(describe() + " differ in sample rate");
+
+        if (reference->numChannels != estimate->numChannels)
+            throw std::runtime_error(describe() + " differ in channel count");
+
+        if (std::abs(reference->lengthInSamples - estimate->lengthInSamples) > kLengthTolerance)
+            throw std::runtime_error(describe() + " differ in length by "
+                                     + std::to_string(std::abs(reference->lengthInSamples - estimate->lengthInSamples)) + " samples");
+
+        comparison.stemNames.add(StemSeparator::STEM_NAMES[stem]);
+        comparison.sdr.add(computeSdr(*reference, *estimate));
+    }
+
+    if (comparison.stemNames.isEmpty())
+        throw std::runtime_error("No stems in " + estimateDirectory.getFullPathName().toStdString());
+
+    return comparison;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Quality metrics for comparing the stems of two separation runs, e.g. a quantized or
+// reduced-precision path against the FP32 reference
+namespace StemMetrics
+{
+    // Signal-to-distortion ratio of estimate against reference in dB over the length both
+    // have, read block by block
+    double computeSdr(juce::AudioFormatReader& reference, juce::AudioFormatReader& estimate);
+
+    struct Comparison
+    {
+        juce::StringArray stemNames;
+        juce::Array<double> sdr;
+
+        double getMeanSdr() const;
+        juce::String toString() const;
+    };
+
+    // Compares every stem of inputFile in estimateDirectory with the same stem in referenceDirectory.
+    // Throws std::runtime_error if a stem is in only one of the directories, or if the two
+    // differ in sample rate, channel count or by more than kLengthTolerance samples in length.
+    static constexpr int kLengthTolerance = 64;
+    Comparison compareStems(const juce::File& inputFile,
+                            const juce::File& referenceDirectory,
+                            const juce::File& estimateDirectory);
+}
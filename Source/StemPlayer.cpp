@@ -0,0 +1,344 @@
+#include "StemPlayer.h"
+#include "StemTensor.h"
+#include <vector>
+
+namespace
+{
+    constexpr int kScratchSamples = 4096;
+
+    // The tensor demucs_inference returned, read in place
+    class TensorSource : public StemPlayer::Source
+    {
+    public:
+        TensorSource(std::shared_ptr<const Eigen::Tensor3dXf> stems, double sampleRate)
+            : mStems(std::move(stems)), mSampleRate(sampleRate)
+        {
+            if (mStems == nullptr || mStems->dimension(1) != StemSeparator::kNumChannels)
+                throw std::runtime_error("Stems to play have to be stereo");
+        }
+
+        int getNumStems() const override { return static_cast<int>(mStems->dimension(0)); }
+        juce::int64 getLengthInSamples() const override { return StemTensor::getNumSamples(*mStems); }
+        double getSampleRate() const override { return mSampleRate; }
+
+        void getChannels(int stem, juce::int64 start, int, float* const*, const float** channels) override
+        {
+            for (int ch = 0; ch < StemSeparator::kNumChannels; ++ch)
+                channels[ch] = StemTensor::getChannel(*mStems, stem, ch) + start;
+        }
+
+    private:
+        std::shared_ptr<const Eigen::Tensor3dXf> mStems;
+        double mSampleRate;
+    };
+
+    // Stem files: WAV is memory mapped and converted block by block, anything else (FLAC)
+    // is decoded once up front so the audio thread never runs a decoder
+    class FileSource : public StemPlayer::Source
+    {
+    public:
+        explicit FileSource(const juce::Array<juce::File>& files)
+        {
+            if (files.isEmpty())
+                throw std::runtime_error("No stem files to play");
+
+            juce::AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+            juce::WavAudioFormat wavFormat;
+
+            for (const auto& file : files)
+            {
+                Stem stem;
+                if (file.hasFileExtension("wav"))
+                {
+                    stem.mapped.reset(wavFormat.createMemoryMappedReader(file));
+                    if (stem.mapped != nullptr && !stem.mapped->mapEntireFile())
+                        stem.mapped.reset();
+                }
+
+                std::unique_ptr<juce::AudioFormatReader> decoder;
+                juce::AudioFormatReader* reader = stem.mapped.get();
+                if (reader == nullptr)
+                {
+                    decoder.reset(formatManager.createReaderFor(file));
+                    reader = decoder.get();
+                }
+
+                if (reader == nullptr)
+                    throw std::runtime_error("Could not read " + file.getFullPathName().toStdString());
+
+                if (reader->numChannels != (unsigned int) StemSeparator::kNumChannels)
+                    throw std::runtime_error(file.getFileName().toStdString() + " is not a stereo stem file");
+
+                if (mStems.empty())
+                {
+                    mSampleRate = reader->sampleRate;
+                    mLength = reader->lengthInSamples;
+                }
+                else if (reader->sampleRate != mSampleRate)
+                {
+                    throw std::runtime_error("Stem files have different sample rates");
+                }
+
+                mLength = juce::jmin(mLength, reader->lengthInSamples);
+
+                if (decoder != nullptr)
+                {
+                    const int numSamples = static_cast<int>(reader->lengthInSamples);
+                    stem.decoded.setSize(StemSeparator::kNumChannels, numSamples);
+                    reader->read(&stem.decoded, 0, numSamples, 0, true, true);
+                }
+
+                mStems.push_back(std::move(stem));
+            }
+        }
+
+        int getNumStems() const override { return static_cast<int>(mStems.size()); }
+        juce::int64 getLengthInSamples() const override { return mLength; }
+        double getSampleRate() const override { return mSampleRate; }
+
+        void getChannels(int index, juce::int64 start, int numSamples, float* const* scratch, const float** channels) override
+        {
+            auto& stem = mStems[(size_t) index];
+
+            if (stem.mapped != nullptr)
+            {
+                // Refers to the scratch memory, nothing is allocated
+                juce::AudioBuffer<float> destination(scratch, StemSeparator::kNumChannels, numSamples);
+                stem.mapped->read(&destination, 0, numSamples, start, true, true);
+
+                for (int ch = 0; ch < StemSeparator::kNumChannels; ++ch)
+                    channels[ch] = scratch[ch];
+            }
+            else
+            {
+                for (int ch = 0; ch < StemSeparator::kNumChannels; ++ch)
+                    channels[ch] = stem.decoded.getReadPointer(ch, static_cast<int>(start));
+            }
+        }
+
+    private:
+        struct Stem
+        {
+            std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped;
+            juce::AudioBuffer<float> decoded;
+        };
+
+        std::vector<Stem> mStems;
+        juce::int64 mLength { 0 };
+        double mSampleRate { 0.0 };
+    };
+}
+
+StemPlayer::StemPlayer()
+{
+    for (size_t i = 0; i < mGains.size(); ++i)
+    {
+        mGains[i] = 1.0f;
+        mMuted[i] = false;
+        mSoloed[i] = false;
+    }
+
+    mDeviceError = mDeviceManager.initialiseWithDefaultDevices(0, StemSeparator::kNumChannels);
+
+    mSourcePlayer.setSource(this);
+    mDeviceManager.addAudioCallback(&mSourcePlayer);
+}
+
+StemPlayer::~StemPlayer()
+{
+    mDeviceManager.removeAudioCallback(&mSourcePlayer);
+    mSourcePlayer.setSource(nullptr);
+    mDeviceManager.closeAudioDevice();
+}
+
+void StemPlayer::setStems(std::shared_ptr<const Eigen::Tensor3dXf> stems, double sampleRate)
+{
+    setSource(std::make_unique<TensorSource>(std::move(stems), sampleRate));
+}
+
+void StemPlayer::setStemFiles(const juce::Array<juce::File>& files)
+{
+    setSource(std::make_unique<FileSource>(files));
+}
+
+void StemPlayer::clear()
+{
+    setSource(nullptr);
+}
+
+int StemPlayer::getNumStems() const
+{
+    const juce::SpinLock::ScopedLockType lock(mSourceLock);
+    return mSource != nullptr ? mSource->getNumStems() : 0;
+}
+
+juce::int64 StemPlayer::getLengthInSamples() const
+{
+    const juce::SpinLock::ScopedLockType lock(mSourceLock);
+    return mSource != nullptr ? mSource->getLengthInSamples() : 0;
+}
+
+double StemPlayer::getSampleRate() const
+{
+    const juce::SpinLock::ScopedLockType lock(mSourceLock);
+    return mSource != nullptr ? mSource->getSampleRate() : StemSeparator::kSampleRate;
+}
+
+void StemPlayer::play()
+{
+    if (getNumStems() == 0)
+        return;
+
+    if (getPosition() >= getLengthInSamples())
+        setPosition(0);
+
+    mPlaying = true;
+}
+
+void StemPlayer::stop()
+{
+    mPlaying = false;
+}
+
+void StemPlayer::setPosition(juce::int64 sample)
+{
+    sample = juce::jlimit<juce::int64>(0, getLengthInSamples(), sample);
+
+    // Shown right away, applied by the audio thread at the start of its next block
+    mPosition = sample;
+    mPendingSeek = sample;
+}
+
+void StemPlayer::setSource(std::unique_ptr<Source> source)
+{
+    {
+        const juce::SpinLock::ScopedLockType lock(mSourceLock);
+
+        const double seconds = mSource != nullptr ? static_cast<double>(mPosition.load()) / mSource->getSampleRate() : 0.0;
+        std::swap(mSource, source);
+
+        if (mSource != nullptr)
+        {
+            const auto position = juce::jlimit<juce::int64>(0, mSource->getLengthInSamples(),
+                                                            static_cast<juce::int64>(seconds * mSource->getSampleRate() + 0.5));
+            mPosition = position;
+            mPendingSeek = position;
+        }
+        else
+        {
+            mPlaying = false;
+            mPosition = 0;
+            mPendingSeek = -1;
+        }
+
+        updateResamplingRatio();
+    }
+
+    // The previous stems are freed here, outside the lock
+}
+
+void StemPlayer::updateResamplingRatio()
+{
+    mResample = mSource != nullptr && mDeviceSampleRate > 0.0 && mSource->getSampleRate() != mDeviceSampleRate;
+    if (mResample)
+        mResampler.setResamplingRatio(mSource->getSampleRate() / mDeviceSampleRate);
+}
+
+void StemPlayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    const juce::SpinLock::ScopedLockType lock(mSourceLock);
+
+    mDeviceSampleRate = sampleRate;
+    mScratch.setSize(StemSeparator::kNumChannels, juce::jmax(kScratchSamples, samplesPerBlockExpected));
+    mResampler.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    updateResamplingRatio();
+}
+
+void StemPlayer::releaseResources()
+{
+    mResampler.releaseResources();
+}
+
+void StemPlayer::getNextAudioBlock(const juce::AudioSourceChannelInfo& info)
+{
+    const juce::SpinLock::ScopedTryLockType lock(mSourceLock);
+
+    if (!lock.isLocked() || mSource == nullptr || !mPlaying)
+    {
+        info.clearActiveBufferRegion();
+        return;
+    }
+
+    const auto seek = mPendingSeek.exchange(-1);
+    if (seek >= 0)
+    {
+        mPosition = seek;
+        mResampler.flushBuffers();
+    }
+
+    if (mResample)
+        mResampler.getNextAudioBlock(info);
+    else
+        mixStems(*info.buffer, info.startSample, info.numSamples);
+}
+
+void StemPlayer::mixStems(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    buffer.clear(startSample, numSamples);
+
+    if (mSource == nullptr || mScratch.getNumSamples() == 0)
+        return;
+
+    const int numStems = juce::jmin(mSource->getNumStems(), StemSeparator::kNumStems);
+    const int numChannels = juce::jmin(buffer.getNumChannels(), StemSeparator::kNumChannels);
+    const auto length = mSource->getLengthInSamples();
+
+    // Solo wins over mute, as on a mixing desk
+    bool anySoloed = false;
+    for (int stem = 0; stem < numStems; ++stem)
+        anySoloed = anySoloed || mSoloed[(size_t) stem];
+
+    std::array<float, StemSeparator::kNumStems> gains {};
+    for (int stem = 0; stem < numStems; ++stem)
+    {
+        const bool audible = anySoloed ? mSoloed[(size_t) stem].load() : !mMuted[(size_t) stem];
+        gains[(size_t) stem] = audible ? mGains[(size_t) stem].load() : 0.0f;
+    }
+
+    auto position = mPosition.load();
+    while (numSamples > 0 && position < length)
+    {
+        const int blockSamples = static_cast<int>(juce::jmin<juce::int64>(numSamples, mScratch.getNumSamples(), length - position));
+
+        for (int stem = 0; stem < numStems; ++stem)
+        {
+            const float from = mAppliedGains[(size_t) stem];
+            const float to = gains[(size_t) stem];
+            if (from == 0.0f && to == 0.0f)
+                continue;
+
+            const float* channels[StemSeparator::kNumChannels];
+            mSource->getChannels(stem, position, blockSamples, mScratch.getArrayOfWritePointers(), channels);
+
+            // Gain changes ramp over one block so they don't click
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                if (from == to)
+                    juce::FloatVectorOperations::addWithMultiply(buffer.getWritePointer(ch, startSample), channels[ch], to, blockSamples);
+                else
+                    buffer.addFromWithRamp(ch, startSample, channels[ch], blockSamples, from, to);
+            }
+
+            mAppliedGains[(size_t) stem] = to;
+        }
+
+        position += blockSamples;
+        startSample += blockSamples;
+        numSamples -= blockSamples;
+    }
+
+    mPosition = position;
+    if (position >= length)
+        mPlaying = false;
+}
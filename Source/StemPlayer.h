@@ -0,0 +1,119 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include "StemSeparator.h"
+#include "model.hpp"
+
+// Plays separated stems on the default output device with per-stem gain, mute and solo.
+// Stems are mixed straight from where they already are: the tensor demucs returned, so
+// playback can start before the stem files are written, or the stem files themselves,
+// WAV ones memory mapped and others decoded once. Seeking lands on the exact sample.
+// Everything but the audio callback runs on the message thread.
+class StemPlayer : private juce::AudioSource
+{
+public:
+    StemPlayer();
+    ~StemPlayer() override;
+
+    // Empty if the output device opened
+    const juce::String& getDeviceError() const { return mDeviceError; }
+
+    // Replaces whatever was loaded, keeping the position in seconds and whether it plays.
+    // The tensor is a (stem, channel, sample) one as demucs_inference returns it.
+    void setStems(std::shared_ptr<const Eigen::Tensor3dXf> stems, double sampleRate);
+
+    // Throws std::runtime_error if a file can't be read or the files differ in rate
+    void setStemFiles(const juce::Array<juce::File>& files);
+    void clear();
+
+    int getNumStems() const;
+    juce::int64 getLengthInSamples() const;
+    double getSampleRate() const;
+
+    void play();
+    void stop();
+    bool isPlaying() const { return mPlaying.load(); }
+
+    // In samples of the stems, taking effect with the next audio block
+    void setPosition(juce::int64 sample);
+    juce::int64 getPosition() const { return mPosition.load(); }
+
+    // Linear gain
+    void setGain(int stem, float gain) { mGains[(size_t) stem] = gain; }
+    void setMuted(int stem, bool muted) { mMuted[(size_t) stem] = muted; }
+    void setSoloed(int stem, bool soloed) { mSoloed[(size_t) stem] = soloed; }
+
+    // Read-only view of planar stereo stems for the mixer
+    class Source
+    {
+    public:
+        virtual ~Source() = default;
+
+        virtual int getNumStems() const = 0;
+        virtual juce::int64 getLengthInSamples() const = 0;
+        virtual double getSampleRate() const = 0;
+
+        // Points channels at numSamples of the stem from start on, either into memory the
+        // source already holds or into scratch after filling it. Called on the audio thread.
+        virtual void getChannels(int stem, juce::int64 start, int numSamples,
+                                 float* const* scratch, const float** channels) = 0;
+    };
+
+private:
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override;
+
+    void setSource(std::unique_ptr<Source> source);
+    void updateResamplingRatio();
+
+    // Mixes into the buffer at the current position and advances it
+    void mixStems(juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    // Lets the resampler pull from mixStems()
+    class MixerSource : public juce::AudioSource
+    {
+    public:
+        explicit MixerSource(StemPlayer& owner) : mOwner(owner) {}
+
+        void prepareToPlay(int, double) override {}
+        void releaseResources() override {}
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& info) override
+        {
+            mOwner.mixStems(*info.buffer, info.startSample, info.numSamples);
+        }
+
+    private:
+        StemPlayer& mOwner;
+    };
+
+    juce::AudioDeviceManager mDeviceManager;
+    juce::AudioSourcePlayer mSourcePlayer;
+    juce::String mDeviceError;
+
+    MixerSource mMixerSource { *this };
+    juce::ResamplingAudioSource mResampler { &mMixerSource, false, StemSeparator::kNumChannels };
+    double mDeviceSampleRate { 0.0 };
+
+    // Held by the audio thread while it renders a block, swapped on the message thread
+    mutable juce::SpinLock mSourceLock;
+    std::unique_ptr<Source> mSource;
+    bool mResample { false };
+
+    std::atomic<bool> mPlaying { false };
+    std::atomic<juce::int64> mPosition { 0 };
+    std::atomic<juce::int64> mPendingSeek { -1 };
+
+    std::array<std::atomic<float>, StemSeparator::kNumStems> mGains;
+    std::array<std::atomic<bool>, StemSeparator::kNumStems> mMuted;
+    std::array<std::atomic<bool>, StemSeparator::kNumStems> mSoloed;
+
+    // Audio thread only
+    std::array<float, StemSeparator::kNumStems> mAppliedGains {};
+    juce::AudioBuffer<float> mScratch;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemPlayer)
+};
@@ -0,0 +1,256 @@
+#include "StemPlayerComponent.h"
+#include "StemTensor.h"
+
+namespace
+{
+    constexpr int kControlsWidth = 300;
+    constexpr double kMinGainDb = -60.0;
+}
+
+StemPlayerComponent::StemPlayerComponent()
+    : mThumbnailCache(ThumbnailDiskCache::getDefaultDirectory(), StemSeparator::kNumStems * 2, 256)
+{
+    mFormatManager.registerBasicFormats();
+
+    mPlayButton.setEnabled(false);
+    mPlayButton.onClick = [this]()
+    {
+        if (mPlayer.getDeviceError().isNotEmpty())
+        {
+            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Playback",
+                                                   "No audio output: " + mPlayer.getDeviceError());
+            return;
+        }
+
+        if (mPlayer.isPlaying())
+            mPlayer.stop();
+        else
+            mPlayer.play();
+    };
+
+    addAndMakeVisible(mPlayButton);
+    addAndMakeVisible(mTimeLabel);
+
+    startTimerHz(30);
+}
+
+StemPlayerComponent::~StemPlayerComponent()
+{
+    for (auto& row : mRows)
+        row->thumbnail->removeChangeListener(this);
+}
+
+void StemPlayerComponent::setStems(std::shared_ptr<const Eigen::Tensor3dXf> stems, double sampleRate,
+                                   const juce::StringArray& names)
+{
+    mPlayer.setStems(stems, sampleRate);
+    mPlayer.setPosition(0);
+    createRows(names);
+
+    // Drawn from the tensor in one go, no file is read
+    const int numSamples = StemTensor::getNumSamples(*stems);
+    for (size_t i = 0; i < mRows.size() && (Eigen::Index) i < stems->dimension(0); ++i)
+    {
+        float* channels[StemSeparator::kNumChannels];
+        for (int ch = 0; ch < StemSeparator::kNumChannels; ++ch)
+            channels[ch] = const_cast<float*>(StemTensor::getChannel(*stems, (int) i, ch));
+
+        const juce::AudioBuffer<float> block(channels, StemSeparator::kNumChannels, numSamples);
+        mRows[i]->thumbnail->reset(StemSeparator::kNumChannels, sampleRate, numSamples);
+        mRows[i]->thumbnail->addBlock(0, block, 0, numSamples);
+    }
+
+    mTensorSampleRate = sampleRate;
+    repaint();
+}
+
+void StemPlayerComponent::setStemFiles(const juce::Array<juce::File>& files, const juce::StringArray& names)
+{
+    bool sameStems = mTensorSampleRate > 0.0 && !mRows.empty() && static_cast<int>(mRows.size()) == names.size();
+    for (size_t i = 0; sameStems && i < mRows.size(); ++i)
+        sameStems = mRows[i]->name.getText() == names[(int) i];
+
+    mPlayer.setStemFiles(files);
+
+    if (!sameStems)
+    {
+        mPlayer.setPosition(0);
+        createRows(names);
+    }
+
+    // Only when the files hold exactly the stems the thumbnails were drawn from
+    const bool keepThumbnails = sameStems && mPlayer.getSampleRate() == mTensorSampleRate
+                             && mRows.front()->thumbnail->getNumSamplesFinished() == mPlayer.getLengthInSamples();
+    for (size_t i = 0; i < mRows.size() && (int) i < files.size(); ++i)
+    {
+        const juce::FileInputSource source(files[(int) i], true);
+
+        if (keepThumbnails)
+            mThumbnailCache.storeThumb(*mRows[i]->thumbnail, source.hashCode());
+        else
+            mRows[i]->thumbnail->setSource(new juce::FileInputSource(files[(int) i], true));
+    }
+
+    mTensorSampleRate = 0.0;
+    repaint();
+}
+
+void StemPlayerComponent::clear()
+{
+    mPlayer.clear();
+    createRows({});
+    mTensorSampleRate = 0.0;
+    repaint();
+}
+
+void StemPlayerComponent::createRows(const juce::StringArray& names)
+{
+    for (auto& row : mRows)
+        row->thumbnail->removeChangeListener(this);
+    mRows.clear();
+
+    for (int i = 0; i < juce::jmin(names.size(), StemSeparator::kNumStems); ++i)
+    {
+        auto row = std::make_unique<Row>();
+        row->name.setText(names[i], juce::dontSendNotification);
+
+        row->mute.setClickingTogglesState(true);
+        row->mute.setColour(juce::TextButton::buttonOnColourId, juce::Colours::orangered);
+        row->mute.onClick = [this, i, button = &row->mute]() { mPlayer.setMuted(i, button->getToggleState()); };
+
+        row->solo.setClickingTogglesState(true);
+        row->solo.setColour(juce::TextButton::buttonOnColourId, juce::Colours::gold.darker());
+        row->solo.onClick = [this, i, button = &row->solo]() { mPlayer.setSoloed(i, button->getToggleState()); };
+
+        // The bottom of the range is silence
+        row->gain.setRange(kMinGainDb, 6.0, 0.1);
+        row->gain.setValue(0.0, juce::dontSendNotification);
+        row->gain.setTextValueSuffix(" dB");
+        row->gain.setTextBoxStyle(juce::Slider::TextBoxRight, false, 64, 20);
+        row->gain.onValueChange = [this, i, slider = &row->gain]()
+        {
+            mPlayer.setGain(i, juce::Decibels::decibelsToGain(static_cast<float>(slider->getValue()),
+                                                              static_cast<float>(kMinGainDb)));
+        };
+
+        mPlayer.setGain(i, 1.0f);
+        mPlayer.setMuted(i, false);
+        mPlayer.setSoloed(i, false);
+
+        row->thumbnail = std::make_unique<juce::AudioThumbnail>(512, mFormatManager, mThumbnailCache);
+        row->thumbnail->addChangeListener(this);
+
+        for (auto* component : std::initializer_list<juce::Component*> { &row->name, &row->mute, &row->solo, &row->gain })
+            addAndMakeVisible(component);
+
+        mRows.push_back(std::move(row));
+    }
+
+    resized();
+}
+
+void StemPlayerComponent::paint(juce::Graphics& g)
+{
+    const auto background = getLookAndFeel().findColour(juce::ListBox::backgroundColourId);
+    const double lengthSeconds = static_cast<double>(mPlayer.getLengthInSamples()) / mPlayer.getSampleRate();
+
+    for (const auto& row : mRows)
+    {
+        g.setColour(background);
+        g.fillRect(row->waveformBounds);
+
+        if (lengthSeconds > 0.0 && row->thumbnail->getTotalLength() > 0.0)
+        {
+            g.setColour(juce::Colours::lightskyblue);
+            row->thumbnail->drawChannels(g, row->waveformBounds, 0.0, lengthSeconds, 1.0f);
+        }
+    }
+
+    const auto length = mPlayer.getLengthInSamples();
+    if (length > 0 && !mWaveformArea.isEmpty())
+    {
+        const float x = static_cast<float>(mWaveformArea.getX())
+                      + static_cast<float>(mWaveformArea.getWidth()) * static_cast<float>(mPlayer.getPosition()) / static_cast<float>(length);
+        g.setColour(juce::Colours::white);
+        g.drawVerticalLine(juce::roundToInt(x), static_cast<float>(mWaveformArea.getY()), static_cast<float>(mWaveformArea.getBottom()));
+    }
+}
+
+void StemPlayerComponent::resized()
+{
+    auto area = getLocalBounds();
+    auto transport = area.removeFromTop(28);
+
+    mPlayButton.setBounds(transport.removeFromLeft(80));
+    transport.removeFromLeft(10);
+    mTimeLabel.setBounds(transport.removeFromLeft(220));
+
+    area.removeFromTop(6);
+    mWaveformArea = area.withTrimmedLeft(kControlsWidth);
+
+    if (mRows.empty())
+        return;
+
+    const int rowHeight = area.getHeight() / static_cast<int>(mRows.size());
+    for (auto& row : mRows)
+    {
+        auto rowArea = area.removeFromTop(rowHeight).reduced(0, 2);
+        row->waveformBounds = rowArea.withTrimmedLeft(kControlsWidth);
+
+        row->name.setBounds(rowArea.removeFromLeft(70));
+        row->mute.setBounds(rowArea.removeFromLeft(28));
+        rowArea.removeFromLeft(4);
+        row->solo.setBounds(rowArea.removeFromLeft(28));
+        rowArea.removeFromLeft(6);
+        row->gain.setBounds(rowArea.removeFromLeft(kControlsWidth - 70 - 28 - 4 - 28 - 6 - 10));
+    }
+}
+
+void StemPlayerComponent::mouseDown(const juce::MouseEvent& event)
+{
+    if (mWaveformArea.contains(event.getPosition()))
+        seekTo(event.x);
+}
+
+void StemPlayerComponent::mouseDrag(const juce::MouseEvent& event)
+{
+    if (mWaveformArea.contains(event.getMouseDownPosition()))
+        seekTo(event.x);
+}
+
+void StemPlayerComponent::seekTo(int x)
+{
+    const auto length = mPlayer.getLengthInSamples();
+    if (length == 0 || mWaveformArea.getWidth() <= 0)
+        return;
+
+    const double fraction = static_cast<double>(x - mWaveformArea.getX()) / mWaveformArea.getWidth();
+    mPlayer.setPosition(static_cast<juce::int64>(fraction * static_cast<double>(length)));
+    timerCallback();
+}
+
+void StemPlayerComponent::timerCallback()
+{
+    mPlayButton.setEnabled(!mRows.empty());
+    mPlayButton.setButtonText(mPlayer.isPlaying() ? "Pause" : "Play");
+
+    const auto position = mPlayer.getPosition();
+    if (position != mPaintedPosition)
+    {
+        mPaintedPosition = position;
+        mTimeLabel.setText(formatTime(position) + " / " + formatTime(mPlayer.getLengthInSamples()), juce::dontSendNotification);
+        repaint(mWaveformArea);
+    }
+}
+
+void StemPlayerComponent::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    repaint();
+}
+
+juce::String StemPlayerComponent::formatTime(juce::int64 sample) const
+{
+    const double seconds = static_cast<double>(sample) / mPlayer.getSampleRate();
+    const int minutes = static_cast<int>(seconds / 60.0);
+    return juce::String(minutes) + ":" + juce::String(seconds - minutes * 60.0, 3).paddedLeft('0', 6);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+#include "StemPlayer.h"
+#include "ThumbnailDiskCache.h"
+
+// Transport and one row per stem with its waveform, gain, mute and solo. Clicking or
+// dragging on the waveforms seeks to the sample under the mouse.
+class StemPlayerComponent : public juce::Component,
+                            private juce::Timer,
+                            private juce::ChangeListener
+{
+public:
+    StemPlayerComponent();
+    ~StemPlayerComponent() override;
+
+    // Stems straight from inference, playable before their files are written
+    void setStems(std::shared_ptr<const Eigen::Tensor3dXf> stems, double sampleRate, const juce::StringArray& names);
+
+    // Moves playback over to the written files, keeping the position, and frees the stems
+    // from setStems(). Their waveforms are kept and stored on disk for the files.
+    // Throws std::runtime_error if the files can't be played.
+    void setStemFiles(const juce::Array<juce::File>& files, const juce::StringArray& names);
+
+    void clear();
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+    void mouseDown(const juce::MouseEvent& event) override;
+    void mouseDrag(const juce::MouseEvent& event) override;
+
+private:
+    struct Row
+    {
+        juce::Label name;
+        juce::TextButton mute { "M" };
+        juce::TextButton solo { "S" };
+        juce::Slider gain { juce::Slider::LinearHorizontal, juce::Slider::TextBoxRight };
+        std::unique_ptr<juce::AudioThumbnail> thumbnail;
+        juce::Rectangle<int> waveformBounds;
+    };
+
+    void timerCallback() override;
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
+
+    void createRows(const juce::StringArray& names);
+    void seekTo(int x);
+    juce::String formatTime(juce::int64 sample) const;
+
+    StemPlayer mPlayer;
+    juce::AudioFormatManager mFormatManager;
+    ThumbnailDiskCache mThumbnailCache;
+
+    juce::TextButton mPlayButton { "Play" };
+    juce::Label mTimeLabel;
+    std::vector<std::unique_ptr<Row>> mRows;
+    juce::Rectangle<int> mWaveformArea;
+
+    // Rate of the stems the thumbnails were drawn from, 0 when they came from files
+    double mTensorSampleRate { 0.0 };
+    juce::int64 mPaintedPosition { -1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemPlayerComponent)
+};
@@ -0,0 +1,660 @@
+#include "StemSeparator.h"
+#include "ChunkScheduler.h"
+#include "ConvertingAudioReader.h"
+#include "ResamplingAudioWriter.h"
+#include "StemTensor.h"
+#include "Trace.h"
+#include <array>
+
+namespace
+{
+    class ChunkWorkerThread : public juce::Thread
+    {
+    public:
+        ChunkWorkerThread(int index, std::function<void()> work)
+            : Thread("DemucsChunkWorker" + juce::String(index)),
+              mWork(std::move(work))
+        {
+        }
+
+        void run() override { mWork(); }
+
+    private:
+        std::function<void()> mWork;
+    };
+
+    bool isFlac(StemSeparator::OutputFormat format)
+    {
+        return format == StemSeparator::OutputFormat::flac16 || format == StemSeparator::OutputFormat::flac24;
+    }
+
+    int getBitsPerSample(StemSeparator::OutputFormat format)
+    {
+        switch (format)
+        {
+            case StemSeparator::OutputFormat::wav24:
+            case StemSeparator::OutputFormat::flac24:
+                return 24;
+            case StemSeparator::OutputFormat::wavFloat:
+                return 32; // JUCE writes 32-bit WAV as IEEE float
+            case StemSeparator::OutputFormat::wav16:
+            case StemSeparator::OutputFormat::flac16:
+                break;
+        }
+        return 16;
+    }
+
+   #if DEMUCS_JUCE_TRACING
+    constexpr const char* WRITE_SPAN_NAMES[StemSeparator::kNumStems] = {
+        "write/drums", "write/bass", "write/other", "write/vocals", "write/guitar", "write/piano"
+    };
+   #endif
+}
+
+StemSeparator::StemSeparator(const demucscpp::demucs_model& model)
+    : StemSeparator(ModelEnsemble::wrap(model))
+{
+}
+
+StemSeparator::StemSeparator(std::shared_ptr<const ModelEnsemble> ensemble)
+    : mEnsemble(std::move(ensemble)),
+      mNumStems(mEnsemble->getNumStems())
+{
+    mFormatManager.registerBasicFormats();
+
+    if (mEnsemble->getNumMembers() > 1)
+        mMemberPool = std::make_unique<juce::ThreadPool>(mEnsemble->getNumMembers() - 1);
+}
+
+juce::File StemSeparator::getDefaultOutputDirectory(const juce::File& inputFile)
+{
+    return inputFile.getParentDirectory().getChildFile(inputFile.getFileNameWithoutExtension() + "_stems");
+}
+
+juce::File StemSeparator::getStemFile(const juce::File& inputFile, const juce::File& outputDirectory, int stem,
+                                      OutputFormat format)
+{
+    return outputDirectory.getChildFile(
+        inputFile.getFileNameWithoutExtension() + juce::String("_") + STEM_NAMES[stem] + (isFlac(format) ? ".flac" : ".wav"));
+}
+
+juce::File StemSeparator::findStemFile(const juce::File& inputFile, const juce::File& outputDirectory, int stem)
+{
+    for (const auto format : { OutputFormat::wav16, OutputFormat::flac16 })
+    {
+        const auto file = getStemFile(inputFile, outputDirectory, stem, format);
+        if (file.existsAsFile())
+            return file;
+    }
+
+    return getStemFile(inputFile, outputDirectory, stem);
+}
+
+bool StemSeparator::parseOutputFormat(const juce::String& name, OutputFormat& format)
+{
+    for (int i = 0; i < kNumOutputFormats; ++i)
+    {
+        if (name.equalsIgnoreCase(OUTPUT_FORMAT_NAMES[i]))
+        {
+            format = static_cast<OutputFormat>(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+StemSeparator::Result StemSeparator::process(const juce::File& inputFile,
+                                             const juce::File& outputDirectory,
+                                             ProgressCallback onProgress,
+                                             CancelCallback shouldCancel,
+                                             WriteCallback onWritten,
+                                             StemsCallback onSeparated)
+{
+    mOnProgress = std::move(onProgress);
+    mShouldCancel = std::move(shouldCancel);
+    mOnWritten = std::move(onWritten);
+    mOnSeparated = std::move(onSeparated);
+
+    Result result;
+    result.inputFile = inputFile;
+    result.outputDirectory = outputDirectory;
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+    const auto allocationsBefore = getNumScratchAllocations();
+    mNumSegmentsDone = 0;
+    mNumCachedSegments = 0;
+    mNumSilentSegments = 0;
+    mNumSilentSamples = 0;
+    mNumSegmentSamples = 0;
+    mWriteError.clear();
+
+    // Chunk workers and write jobs record into the caller's trace session
+    mTraceSession = Trace::Session::getCurrent();
+    const juce::ScopeGuard releaseTraceSession { [this] { mTraceSession.reset(); } };
+
+    reportProgress(0.0f, "Processing audio file...");
+
+    auto reader = std::unique_ptr<juce::AudioFormatReader>(
+        mFormatManager.createReaderFor(inputFile));
+
+    if (!reader)
+        throw std::runtime_error("Could not load audio file");
+
+    if (reader->sampleRate <= 0.0 || reader->numChannels == 0)
+        throw std::runtime_error("Audio file has no samples");
+
+    result.sourceSampleRate = reader->sampleRate;
+    result.sourceChannels = static_cast<int>(reader->numChannels);
+    result.audioSeconds = reader->lengthInSamples / reader->sampleRate;
+
+    if (ConvertingAudioReader::needsConversion(*reader, kSampleRate))
+    {
+        reportProgress(-1.0f, "Converting " + juce::String(reader->sampleRate / 1000.0, 1) + " kHz, "
+                                  + juce::String(reader->numChannels) + " channel input to 44.1 kHz stereo");
+        reader = std::make_unique<ConvertingAudioReader>(std::move(reader), kSampleRate);
+    }
+
+    const double outputRate = mOptions.keepSourceSampleRate ? result.sourceSampleRate : kSampleRate;
+    auto writers = createStemWriters(inputFile, outputDirectory, outputRate);
+
+    // Destroyed before the writers, so no pool thread is left writing to them
+    const juce::ScopeGuard finishWrites { [this] { waitForStemWrites(); } };
+
+    if (mOptions.streaming)
+        result.numSegments = processStreaming(*reader, writers);
+    else
+        result.numSegments = processWholeFile(*reader, writers);
+
+    result.wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    result.scratchAllocations = getNumScratchAllocations() - allocationsBefore;
+    result.numCachedSegments = mNumCachedSegments;
+    result.numSilentSegments = mNumSilentSegments;
+    result.silentSeconds = static_cast<double>(mNumSilentSamples.load()) / kSampleRate;
+    result.segmentSeconds = static_cast<double>(mNumSegmentSamples.load()) / kSampleRate;
+
+    reportProgress(1.0f, "Processing complete!");
+
+    return result;
+}
+
+int StemSeparator::processWholeFile(juce::AudioFormatReader& reader, StemWriters& writers)
+{
+    const int numSamples = static_cast<int>(reader.lengthInSamples);
+    mArena.prepare(1, kNumChannels, numSamples, 0, 0);
+    const juce::ScopeGuard releaseInput { [this] { mArena.releaseWorkerBuffers(); } };
+    auto& audioData = readIntoArena(reader, 0, numSamples, 0);
+
+    reportProgress(-1.0f, "Running Demucs inference...");
+
+    DEMUCS_TRACE_TIMELINE(inferenceTimeline, "inference/");
+    // Shared, so the stems can be played while they are written
+    const auto out_targets = std::make_shared<Eigen::Tensor3dXf>(separateSegment(audioData,
+        [&](float progress, const std::string& message) {
+            DEMUCS_TRACE_TIMELINE_NEXT(inferenceTimeline, message);
+            throwIfCancelled();
+            reportProgress(progress, message);
+        }));
+    DEMUCS_TRACE_TIMELINE_FINISH(inferenceTimeline);
+
+    throwIfCancelled();
+
+    if (mOnSeparated)
+        mOnSeparated(out_targets);
+
+    reportProgress(-1.0f, "Saving separated tracks...");
+
+    // Stems are written straight from the tensor, all at once
+    const float* channels[kNumStems * kNumChannels];
+    for (int target = 0; target < mNumStems; ++target)
+        for (int ch = 0; ch < kNumChannels; ++ch)
+            channels[target * kNumChannels + ch] = StemTensor::getChannel(*out_targets, target, ch);
+
+    writeStemsAsync(writers, channels, numSamples);
+    waitForStemWrites();
+    throwIfWriteFailed();
+
+    if (mOnWritten)
+        mOnWritten(numSamples);
+
+    return 1;
+}
+
+int StemSeparator::processStreaming(juce::AudioFormatReader& reader, StemWriters& writers)
+{
+    const ChunkPlan plan(reader.lengthInSamples,
+                         juce::roundToInt(mOptions.chunkSeconds * kSampleRate),
+                         juce::roundToInt(mOptions.overlapSeconds * kSampleRate));
+
+    mStitcher.prepare(mNumStems, kNumChannels, plan);
+
+    const int numChunks = plan.getNumChunks();
+    const int numWorkers = juce::jlimit(1, numChunks, mOptions.numChunkWorkers);
+
+    // Allow one finished chunk per worker to wait for stitching before workers stall.
+    // At most that many chunks are claimed but not yet stitched, so that's all the FP16
+    // blocks the arena needs.
+    const int maxAhead = numWorkers * 2;
+    const bool halfPrecision = mOptions.halfPrecisionPendingChunks;
+    mArena.prepare(numWorkers, kNumChannels, plan.getChunkSamples(),
+                   halfPrecision ? (size_t) (mNumStems * kNumChannels * plan.getChunkSamples()) : 0,
+                   halfPrecision ? maxAhead : 0);
+
+    ChunkScheduler scheduler(numChunks, maxAhead, halfPrecision ? &mArena : nullptr);
+    std::mutex readerLock;
+    std::mutex progressLock;
+
+    auto runWorker = [&](int worker)
+    {
+        DEMUCS_TRACE_SESSION(mTraceSession);
+
+        if (mOptions.threadPlan != nullptr)
+            ThreadTuner::applyToCurrentThread(*mOptions.threadPlan, worker);
+
+        try
+        {
+            int index = 0;
+            while (scheduler.claim(index))
+            {
+                const auto chunk = plan.getChunk(index);
+                const auto chunkPrefix = "Chunk " + juce::String(index + 1) + "/" + juce::String(numChunks) + ": ";
+
+                Eigen::MatrixXf* audioData = nullptr;
+                {
+                    const std::lock_guard<std::mutex> lock(readerLock);
+                    audioData = &readIntoArena(reader, chunk.start, chunk.length, worker);
+                }
+
+                DEMUCS_TRACE_TIMELINE(inferenceTimeline, "inference/");
+                auto out_targets = separateSegment(*audioData,
+                    [&, index](float progress, const std::string& message) {
+                        DEMUCS_TRACE_TIMELINE_NEXT(inferenceTimeline, message);
+                        throwIfCancelled();
+                        const std::lock_guard<std::mutex> lock(progressLock);
+                        reportProgress(scheduler.setChunkProgress(index, progress), chunkPrefix + juce::String(message));
+                    });
+                DEMUCS_TRACE_TIMELINE_FINISH(inferenceTimeline);
+
+                scheduler.complete(index, std::move(out_targets));
+            }
+        }
+        catch (...)
+        {
+            scheduler.fail(std::current_exception());
+        }
+    };
+
+    juce::OwnedArray<ChunkWorkerThread> workers;
+    const juce::ScopeGuard stopWorkers { [&]
+    {
+        scheduler.abort();
+        for (auto* worker : workers)
+            worker->waitForThreadToExit(-1);
+    } };
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        workers.add(new ChunkWorkerThread(i, [&runWorker, i] { runWorker(i); }));
+        workers.getLast()->startThread();
+    }
+
+    // Blocks are encoded while the next chunk is awaited. The stitcher reuses its block
+    // buffer, so the previous writes have to be done before the next push.
+    juce::int64 numQueued = 0;
+    juce::int64 numWritten = 0;
+    auto finishBlock = [&]
+    {
+        waitForStemWrites();
+        throwIfWriteFailed();
+
+        if (numWritten == numQueued)
+            return;
+
+        numWritten = numQueued;
+
+        if (mOptions.flushAfterEveryChunk)
+            for (auto* writer : writers)
+                writer->flush();
+
+        if (mOnWritten)
+            mOnWritten(numWritten);
+    };
+
+    Eigen::Tensor3dXf out_targets;
+    for (int index = 0; index < numChunks; ++index)
+    {
+        throwIfCancelled();
+
+        if (!scheduler.takeNext(out_targets))
+            throw std::runtime_error("Processing cancelled by user");
+
+        throwIfCancelled();
+        finishBlock();
+
+        DEMUCS_TRACE_SCOPE("overlap_add");
+        mStitcher.push(plan.getChunk(index), out_targets,
+            [this, &writers, &numQueued](const juce::AudioBuffer<float>& block, int numSamples) {
+                writeStemsAsync(writers, block.getArrayOfReadPointers(), numSamples);
+                numQueued += numSamples;
+            });
+    }
+
+    finishBlock();
+
+    return numChunks;
+}
+
+Eigen::Tensor3dXf StemSeparator::separateSegment(const Eigen::MatrixXf& audio, const InferenceCallback& onProgress)
+{
+    mNumSegmentSamples += audio.cols();
+
+    if (mOptions.skipSilence && isSilent(audio))
+    {
+        ++mNumSilentSegments;
+        mNumSilentSamples += audio.cols();
+        onProgress(1.0f, "Skipped silent segment");
+        ++mNumSegmentsDone;
+        return makeSilentStems(audio);
+    }
+
+    auto* cache = mOptions.cache.get();
+    auto* checkpoints = mOptions.checkpoints.get();
+    juce::String cacheKey;
+
+    if (cache != nullptr || checkpoints != nullptr)
+    {
+        DEMUCS_TRACE_SCOPE("cache_lookup");
+
+        // Keys only depend on the models, the shared cache has usually hashed them already
+        cacheKey = (cache != nullptr ? cache : checkpoints)->makeKey(audio);
+
+        Eigen::Tensor3dXf stems;
+        for (auto* store : { checkpoints, cache })
+        {
+            if (store != nullptr && store->load(cacheKey, stems))
+            {
+                // The shared cache may evict it before the job is done
+                if (store == cache && checkpoints != nullptr)
+                    checkpoints->store(cacheKey, stems);
+
+                ++mNumCachedSegments;
+                ++mNumSegmentsDone;
+                onProgress(1.0f, "Reused cached stems");
+                return stems;
+            }
+        }
+    }
+
+    auto stems = runEnsemble(audio, onProgress);
+
+    if (cache != nullptr || checkpoints != nullptr)
+    {
+        DEMUCS_TRACE_SCOPE("cache_store");
+        for (auto* store : { checkpoints, cache })
+            if (store != nullptr)
+                store->store(cacheKey, stems);
+    }
+
+    ++mNumSegmentsDone;
+    return stems;
+}
+
+Eigen::Tensor3dXf StemSeparator::runEnsemble(const Eigen::MatrixXf& audio, const InferenceCallback& onProgress)
+{
+    const int numMembers = mEnsemble->getNumMembers();
+    if (numMembers == 1)
+        return demucscpp::demucs_inference(*mEnsemble->getMember(0).model, audio, onProgress);
+
+    // All members separate the same decoded segment. The first one runs here and reports
+    // progress for the ensemble, the others stop at their next progress step if it fails.
+    std::vector<Eigen::Tensor3dXf> memberStems((size_t) numMembers);
+    std::vector<float> memberProgress((size_t) numMembers, 0.0f);
+    std::mutex memberLock;
+    std::exception_ptr memberError;
+    std::atomic<bool> abort { false };
+    juce::WaitableEvent othersDone;
+    int numOthersRunning = numMembers - 1;
+
+    auto getProgress = [&]
+    {
+        float total = 0.0f;
+        for (const auto progress : memberProgress)
+            total += progress;
+        return total / static_cast<float>(numMembers);
+    };
+
+    for (int member = 1; member < numMembers; ++member)
+    {
+        mMemberPool->addJob([&, member]
+        {
+            try
+            {
+                memberStems[(size_t) member] = demucscpp::demucs_inference(*mEnsemble->getMember(member).model, audio,
+                    [&, member](float progress, const std::string&) {
+                        if (abort)
+                            throw std::runtime_error("Processing cancelled by user");
+                        const std::lock_guard<std::mutex> lock(memberLock);
+                        memberProgress[(size_t) member] = progress;
+                    });
+            }
+            catch (...)
+            {
+                const std::lock_guard<std::mutex> lock(memberLock);
+                if (!memberError)
+                    memberError = std::current_exception();
+            }
+
+            // Signalled after the lock is released: once woken, the caller returns and
+            // destroys everything this job refers to
+            bool last = false;
+            {
+                const std::lock_guard<std::mutex> lock(memberLock);
+                last = --numOthersRunning == 0;
+            }
+
+            if (last)
+                othersDone.signal();
+        });
+    }
+
+    try
+    {
+        const auto& first = mEnsemble->getMember(0);
+        memberStems[0] = demucscpp::demucs_inference(*first.model, audio,
+            [&](float progress, const std::string& message) {
+                float combined = 0.0f;
+                {
+                    const std::lock_guard<std::mutex> lock(memberLock);
+                    memberProgress[0] = progress;
+                    combined = getProgress();
+                }
+                onProgress(combined, message);
+            });
+
+        // Keep honouring cancellation while the slower members finish
+        while (!othersDone.wait(200))
+        {
+            float combined = 0.0f;
+            {
+                const std::lock_guard<std::mutex> lock(memberLock);
+                combined = getProgress();
+            }
+            onProgress(combined, "Waiting for the other ensemble models");
+        }
+    }
+    catch (...)
+    {
+        abort = true;
+        othersDone.wait(-1);
+        throw;
+    }
+
+    if (memberError)
+        std::rethrow_exception(memberError);
+
+    DEMUCS_TRACE_SCOPE("ensemble_average");
+    return mEnsemble->combine(memberStems);
+}
+
+bool StemSeparator::isSilent(const Eigen::MatrixXf& audio) const
+{
+    DEMUCS_TRACE_SCOPE("silence_check");
+
+    // Both channels at once, the matrix is one contiguous interleaved block
+    const auto range = juce::FloatVectorOperations::findMinAndMax(audio.data(), static_cast<int>(audio.size()));
+    const float peak = juce::jmax(std::abs(range.getStart()), std::abs(range.getEnd()));
+    return juce::Decibels::gainToDecibels(peak) < mOptions.silenceThresholdDb;
+}
+
+Eigen::Tensor3dXf StemSeparator::makeSilentStems(const Eigen::MatrixXf& audio) const
+{
+    const auto numSamples = audio.cols();
+    Eigen::Tensor3dXf stems(mNumStems, kNumChannels, numSamples);
+    stems.setZero();
+
+    if (mOptions.silenceToOther)
+    {
+        constexpr int otherStem = 2;
+        jassert(juce::String(STEM_NAMES[otherStem]) == "other");
+
+        float* channels[kNumChannels];
+        for (int ch = 0; ch < kNumChannels; ++ch)
+            channels[ch] = StemTensor::getChannel(stems, otherStem, ch);
+
+        using Format = juce::AudioData::Format<juce::AudioData::Float32, juce::AudioData::NativeEndian>;
+        juce::AudioData::deinterleaveSamples(juce::AudioData::InterleavedSource<Format> { audio.data(), kNumChannels },
+                                             juce::AudioData::NonInterleavedDest<Format> { channels, kNumChannels },
+                                             static_cast<int>(numSamples));
+    }
+
+    return stems;
+}
+
+StemSeparator::StemWriters StemSeparator::createStemWriters(const juce::File& inputFile,
+                                                             const juce::File& outputDirectory,
+                                                             double sampleRate)
+{
+    if (!outputDirectory.createDirectory())
+        throw std::runtime_error("Could not create output directory: " + outputDirectory.getFullPathName().toStdString());
+
+    const auto format = mOptions.outputFormat;
+    std::unique_ptr<juce::AudioFormat> audioFormat;
+    if (isFlac(format))
+        audioFormat = std::make_unique<juce::FlacAudioFormat>();
+    else
+        audioFormat = std::make_unique<juce::WavAudioFormat>();
+
+    StemWriters writers;
+    for (int target = 0; target < mNumStems; ++target)
+    {
+        auto outputFile = getStemFile(inputFile, outputDirectory, target, format);
+        outputFile.deleteFile();
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(
+            audioFormat->createWriterFor(new juce::FileOutputStream(outputFile),
+                                         sampleRate, kNumChannels, getBitsPerSample(format), {}, 0));
+
+        if (!writer)
+            throw std::runtime_error("Could not create output file: " + outputFile.getFullPathName().toStdString());
+
+        if (sampleRate != kSampleRate)
+            writer = std::make_unique<ResamplingAudioWriter>(std::move(writer), kSampleRate);
+
+        writers.add(writer.release());
+    }
+
+    return writers;
+}
+
+void StemSeparator::writeStemsAsync(StemWriters& writers, const float* const* channels, int numSamples)
+{
+    {
+        const std::lock_guard<std::mutex> lock(mWriteLock);
+        mNumPendingWrites += mNumStems;
+    }
+
+    auto* pool = mOptions.writePool.get();
+    if (pool == nullptr)
+    {
+        if (mOwnWritePool == nullptr)
+            mOwnWritePool = std::make_unique<juce::ThreadPool>(kNumStems);
+
+        pool = mOwnWritePool.get();
+    }
+
+    for (int target = 0; target < mNumStems; ++target)
+    {
+        std::array<const float*, kNumChannels> stemChannels;
+        for (int ch = 0; ch < kNumChannels; ++ch)
+            stemChannels[(size_t) ch] = channels[target * kNumChannels + ch];
+
+        pool->addJob([this, writer = writers[target], stemChannels, numSamples, target]
+        {
+            bool written = false;
+            {
+                DEMUCS_TRACE_SESSION(mTraceSession);
+                DEMUCS_TRACE_SCOPE(WRITE_SPAN_NAMES[target]);
+                written = writer->writeFromFloatArrays(stemChannels.data(), kNumChannels, numSamples);
+            }
+
+            const std::lock_guard<std::mutex> lock(mWriteLock);
+            if (!written && mWriteError.empty())
+                mWriteError = "Failed to write " + std::string(STEM_NAMES[target]) + " stem";
+
+            if (--mNumPendingWrites == 0)
+                mWritesDone.notify_all();
+        });
+    }
+}
+
+void StemSeparator::waitForStemWrites()
+{
+    std::unique_lock<std::mutex> lock(mWriteLock);
+    mWritesDone.wait(lock, [this] { return mNumPendingWrites == 0; });
+}
+
+void StemSeparator::throwIfWriteFailed()
+{
+    const std::lock_guard<std::mutex> lock(mWriteLock);
+    if (!mWriteError.empty())
+        throw std::runtime_error(mWriteError);
+}
+
+Eigen::MatrixXf& StemSeparator::readIntoArena(juce::AudioFormatReader& reader, juce::int64 start, int numSamples, int worker)
+{
+    auto& input = mArena.getInputBuffer(worker, numSamples);
+    {
+        DEMUCS_TRACE_SCOPE("decode");
+        reader.read(&input, 0, numSamples, start, true, true);
+    }
+
+    DEMUCS_TRACE_SCOPE("copy_to_eigen");
+
+    // The column-major 2 x N Eigen matrix is interleaved stereo in memory
+    static_assert(!Eigen::MatrixXf::IsRowMajor, "demucs input is expected to be column-major");
+    using Format = juce::AudioData::Format<juce::AudioData::Float32, juce::AudioData::NativeEndian>;
+
+    auto& audioData = mArena.getAudioMatrix(worker, numSamples);
+    juce::AudioData::interleaveSamples(juce::AudioData::NonInterleavedSource<Format> { input.getArrayOfReadPointers(), kNumChannels },
+                                       juce::AudioData::InterleavedDest<Format> { audioData.data(), kNumChannels },
+                                       numSamples);
+
+    return audioData;
+}
+
+juce::int64 StemSeparator::getNumScratchAllocations() const
+{
+    return mArena.getNumAllocations() + mStitcher.getNumAllocations();
+}
+
+void StemSeparator::reportProgress(float progress, const juce::String& message) const
+{
+    if (mOnProgress)
+        mOnProgress(progress, message);
+}
+
+void StemSeparator::throwIfCancelled() const
+{
+    if (mShouldCancel && mShouldCancel())
+        throw std::runtime_error("Processing cancelled by user");
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "ChunkArena.h"
+#include "ChunkStitcher.h"
+#include "ModelEnsemble.h"
+#include "StemCache.h"
+#include "ThreadTuner.h"
+#include "Trace.h"
+#include "model.hpp"
+
+// Separates one audio file at a time into stems with a shared, read-only model or
+// ensemble of models. The decode/inference/write buffers belong to the separator and are
+// reused between files, so every worker thread should own its own StemSeparator.
+class StemSeparator
+{
+public:
+    using ProgressCallback = std::function<void(float progress, const juce::String& message)>;
+    using CancelCallback = std::function<bool()>;
+    using WriteCallback = std::function<void(juce::int64 numSamplesWritten)>;
+    using StemsCallback = std::function<void(std::shared_ptr<const Eigen::Tensor3dXf> stems)>;
+
+    enum class OutputFormat
+    {
+        wav16,
+        wav24,
+        wavFloat,
+        flac16,
+        flac24
+    };
+
+    struct Options
+    {
+        // Decode, separate and write the file chunk by chunk instead of all at once.
+        // Peak memory then depends on chunkSeconds rather than on the file length.
+        bool streaming { false };
+        double chunkSeconds { 30.0 };
+        double overlapSeconds { 2.0 };
+
+        // Streaming chunks separated concurrently. The result doesn't depend on this,
+        // chunks are always stitched in order.
+        int numChunkWorkers { 1 };
+
+        // Pins streaming chunk worker i to the plan's cores for worker i and sets its BLAS
+        // thread count, see ThreadTuner
+        std::shared_ptr<const ThreadTuner::Plan> threadPlan;
+
+        // Encodes the stems here instead of on a pool of the separator's own, so that the
+        // separators of a batch or server share one set of write threads
+        std::shared_ptr<juce::ThreadPool> writePool;
+
+        // Keep separated chunks that are waiting to be stitched in FP16
+        bool halfPrecisionPendingChunks { false };
+
+        // Streaming: flush the stem files after every chunk so they can be played while
+        // they are still being written
+        bool flushAfterEveryChunk { false };
+
+        // Reuse stems of segments that were separated before. With streaming every chunk
+        // is a segment, so only edited chunks of a resubmitted track are recomputed.
+        std::shared_ptr<StemCache> cache;
+
+        // Like cache, but for the segments of one job that has to be able to resume from
+        // them, so it should never evict (see JobQueue). Segments in either are reused, new
+        // ones go into both. Both have to be made for the same models.
+        std::shared_ptr<StemCache> checkpoints;
+
+        // Segments whose input peak stays below silenceThresholdDb skip demucs. Their stems
+        // are silent, or with silenceToOther the input goes to the "other" stem unchanged.
+        bool skipSilence { false };
+        float silenceThresholdDb { -60.0f };
+        bool silenceToOther { false };
+
+        // Encoding of the stem files
+        OutputFormat outputFormat { OutputFormat::wav16 };
+
+        // Inputs at other rates are resampled to 44.1 kHz for demucs. With this set, the
+        // stems are resampled back and written at the input's rate.
+        bool keepSourceSampleRate { false };
+    };
+
+    struct Result
+    {
+        juce::File inputFile;
+        juce::File outputDirectory;
+        double audioSeconds { 0.0 };
+
+        // Input format, before it was converted to 44.1 kHz stereo
+        double sourceSampleRate { 0.0 };
+        int sourceChannels { 0 };
+        double wallSeconds { 0.0 };
+
+        // Times the separator had to grow its scratch memory for this file. Zero once it
+        // has processed a file with the same chunk settings, apart from a differently
+        // sized last chunk.
+        juce::int64 scratchAllocations { 0 };
+
+        // Segments separated (chunks, or 1 for a whole-file run) and how many came from the cache
+        int numSegments { 0 };
+        int numCachedSegments { 0 };
+
+        // Segments that skipped demucs for being below the silence threshold. Segment
+        // seconds count chunk overlaps twice, like the compute does.
+        int numSilentSegments { 0 };
+        double silentSeconds { 0.0 };
+        double segmentSeconds { 0.0 };
+
+        // Wall time over audio duration, below 1.0 means faster than realtime
+        double getRealtimeFactor() const { return audioSeconds > 0.0 ? wallSeconds / audioSeconds : 0.0; }
+    };
+
+    explicit StemSeparator(const demucscpp::demucs_model& model);
+
+    // Every segment is decoded once and separated by all members at the same time, the
+    // first member on the calling thread and the others on the separator's own threads
+    explicit StemSeparator(std::shared_ptr<const ModelEnsemble> ensemble);
+
+    void setOptions(const Options& options) { mOptions = options; }
+    const Options& getOptions() const { return mOptions; }
+
+    // Counts of the current process() call so far, safe to read from its callbacks
+    int getNumSegmentsDone() const { return mNumSegmentsDone.load(); }
+    int getNumCachedSegments() const { return mNumCachedSegments.load(); }
+
+    // Any sample rate and channel count is accepted and converted on the fly.
+    // Throws std::runtime_error when the file can't be processed or shouldCancel returns true.
+    // A whole-file run hands the separated 44.1 kHz stems to onSeparated before encoding
+    // them; they are only read from then on. Streaming runs never have all of them at once.
+    Result process(const juce::File& inputFile,
+                   const juce::File& outputDirectory,
+                   ProgressCallback onProgress = {},
+                   CancelCallback shouldCancel = {},
+                   WriteCallback onWritten = {},
+                   StemsCallback onSeparated = {});
+
+    static juce::File getDefaultOutputDirectory(const juce::File& inputFile);
+    static juce::File getStemFile(const juce::File& inputFile, const juce::File& outputDirectory, int stem,
+                                  OutputFormat format = OutputFormat::wav16);
+
+    // The stem file of any output format that exists, or the WAV one if none does
+    static juce::File findStemFile(const juce::File& inputFile, const juce::File& outputDirectory, int stem);
+
+    static constexpr int kNumOutputFormats = 5;
+    static constexpr const char* OUTPUT_FORMAT_NAMES[kNumOutputFormats] = {
+        "wav16", "wav24", "float", "flac16", "flac24"
+    };
+    static bool parseOutputFormat(const juce::String& name, OutputFormat& format);
+
+    // Stems of the loaded models, 4 or 6
+    int getNumStems() const { return mEnsemble->getNumStems(); }
+    const ModelEnsemble& getEnsemble() const { return *mEnsemble; }
+
+    static constexpr double kSampleRate = 44100.0;
+    static constexpr int kNumChannels = 2;
+    // demucs source order. 4-stem models produce the first four, kNumStems is the most
+    // any model produces.
+    static constexpr int kNumStems = 6;
+    static constexpr const char* STEM_NAMES[kNumStems] = {
+        "drums", "bass", "other", "vocals", "guitar", "piano"
+    };
+
+private:
+    using StemWriters = juce::OwnedArray<juce::AudioFormatWriter>;
+    using InferenceCallback = std::function<void(float progress, const std::string& message)>;
+
+    // Both return the number of segments they separated
+    int processWholeFile(juce::AudioFormatReader& reader, StemWriters& writers);
+    int processStreaming(juce::AudioFormatReader& reader, StemWriters& writers);
+    StemWriters createStemWriters(const juce::File& inputFile, const juce::File& outputDirectory, double sampleRate);
+
+    // Encodes every stem on its own write pool thread, channels laid out stem * 2 + channel.
+    // The samples have to stay untouched until waitForStemWrites() returns.
+    void writeStemsAsync(StemWriters& writers, const float* const* channels, int numSamples);
+    void waitForStemWrites();
+    void throwIfWriteFailed();
+    Eigen::Tensor3dXf separateSegment(const Eigen::MatrixXf& audio, const InferenceCallback& onProgress);
+    Eigen::Tensor3dXf runEnsemble(const Eigen::MatrixXf& audio, const InferenceCallback& onProgress);
+    bool isSilent(const Eigen::MatrixXf& audio) const;
+    Eigen::Tensor3dXf makeSilentStems(const Eigen::MatrixXf& audio) const;
+    Eigen::MatrixXf& readIntoArena(juce::AudioFormatReader& reader, juce::int64 start, int numSamples, int worker);
+    juce::int64 getNumScratchAllocations() const;
+
+    void reportProgress(float progress, const juce::String& message) const;
+    void throwIfCancelled() const;
+
+    std::shared_ptr<const ModelEnsemble> mEnsemble;
+    const int mNumStems;
+    juce::AudioFormatManager mFormatManager;
+    Options mOptions;
+
+    ProgressCallback mOnProgress;
+    CancelCallback mShouldCancel;
+    WriteCallback mOnWritten;
+    StemsCallback mOnSeparated;
+    std::atomic<int> mNumSegmentsDone { 0 };
+    std::atomic<int> mNumCachedSegments { 0 };
+    std::atomic<int> mNumSilentSegments { 0 };
+    std::atomic<juce::int64> mNumSilentSamples { 0 };
+    std::atomic<juce::int64> mNumSegmentSamples { 0 };
+    std::shared_ptr<Trace::Session> mTraceSession;
+
+    // Scratch memory, grown on demand and kept for the next file
+    ChunkArena mArena;
+    ChunkStitcher mStitcher;
+
+    // Stem encoding runs on Options::writePool or on this, created when first needed,
+    // off the thread that stitches and waits for inference
+    std::unique_ptr<juce::ThreadPool> mOwnWritePool;
+    std::mutex mWriteLock;
+    std::condition_variable mWritesDone;
+    int mNumPendingWrites { 0 };
+    std::string mWriteError;
+
+    // Ensemble members after the first one, shared by the chunk workers
+    std::unique_ptr<juce::ThreadPool> mMemberPool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemSeparator)
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "model.hpp"
+
+// demucs_inference returns a row-major (stem, channel, sample) tensor, so every stem
+// channel is one contiguous, planar run of samples that can be read in place.
+namespace StemTensor
+{
+    static_assert(static_cast<int>(Eigen::Tensor3dXf::Layout) == static_cast<int>(Eigen::RowMajor),
+                  "StemTensor expects demucs.cpp's row-major tensors");
+
+    inline const float* getChannel(const Eigen::Tensor3dXf& stems, int stem, int channel)
+    {
+        return stems.data() + (static_cast<Eigen::Index>(stem) * stems.dimension(1) + channel) * stems.dimension(2);
+    }
+
+    inline float* getChannel(Eigen::Tensor3dXf& stems, int stem, int channel)
+    {
+        return stems.data() + (static_cast<Eigen::Index>(stem) * stems.dimension(1) + channel) * stems.dimension(2);
+    }
+
+    inline int getNumSamples(const Eigen::Tensor3dXf& stems)
+    {
+        return static_cast<int>(stems.dimension(2));
+    }
+}
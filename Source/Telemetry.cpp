@@ -0,0 +1,76 @@
+#include "Telemetry.h"
+
+// A bounded multi-producer queue after Dmitry Vyukov: every cell carries a sequence number
+// that says whether it is free for the producer at a position or holds a record for the
+// consumer, so claiming a cell is a single compare-and-swap and nothing ever waits.
+
+Telemetry::Telemetry(int capacity)
+{
+    const auto size = (size_t) juce::nextPowerOfTwo(juce::jmax(2, capacity));
+    mCells = std::make_unique<Cell[]>(size);
+    mMask = size - 1;
+
+    for (size_t i = 0; i < size; ++i)
+        mCells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool Telemetry::push(const juce::String& message, float progress, int source)
+{
+    if (progress >= 0.0f)
+        mProgress.store(progress, std::memory_order_relaxed);
+
+    auto position = mWritePosition.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+
+    for (;;)
+    {
+        cell = &mCells[position & mMask];
+        const auto sequence = cell->sequence.load(std::memory_order_acquire);
+        const auto difference = (std::ptrdiff_t) sequence - (std::ptrdiff_t) position;
+
+        if (difference == 0)
+        {
+            if (mWritePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+        {
+            // The consumer hasn't freed this cell yet
+            mNumDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            position = mWritePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    auto& record = cell->record;
+    record.milliseconds = juce::Time::getMillisecondCounterHiRes();
+    record.progress = progress;
+    record.source = source;
+    message.copyToUTF8(record.text, (size_t) Record::kMaxTextBytes);
+
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+int Telemetry::drain(const std::function<void(const Record&)>& fn)
+{
+    int numRecords = 0;
+
+    for (;;)
+    {
+        auto& cell = mCells[mReadPosition & mMask];
+        if (cell.sequence.load(std::memory_order_acquire) != mReadPosition + 1)
+            break;
+
+        fn(cell.record);
+
+        cell.sequence.store(mReadPosition + mMask + 1, std::memory_order_release);
+        ++mReadPosition;
+        ++numRecords;
+    }
+
+    return numRecords;
+}
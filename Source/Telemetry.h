@@ -0,0 +1,64 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Bounded ring of progress records between the threads doing the work and the one
+// showing it. Any thread may push without locking or allocating; a single consumer
+// drains the ring at its own pace, e.g. from a timer. When the consumer falls behind,
+// new records are dropped and counted rather than queued without limit, and the latest
+// progress value is kept apart from the ring so it is never lost.
+class Telemetry
+{
+public:
+    struct Record
+    {
+        // Messages longer than this are truncated
+        static constexpr int kMaxTextBytes = 200;
+
+        double milliseconds { 0.0 }; // Time::getMillisecondCounterHiRes() when pushed
+        float progress { -1.0f };    // -1 for messages without progress
+        int source { 0 };            // e.g. the worker that pushed it
+        char text[kMaxTextBytes] {};
+
+        juce::String getText() const { return juce::String::fromUTF8(text); }
+    };
+
+    // capacity is rounded up to a power of two
+    explicit Telemetry(int capacity = 1024);
+
+    // Any thread. Returns false when the ring was full and the message was dropped; the
+    // progress is recorded either way.
+    bool push(const juce::String& message, float progress = -1.0f, int source = 0);
+
+    // Consumer thread only. Calls fn for every record in push order and returns how many.
+    int drain(const std::function<void(const Record&)>& fn);
+
+    // The most recent progress pushed since the last reset, -1 if none
+    float getProgress() const { return mProgress.load(std::memory_order_relaxed); }
+    void resetProgress() { mProgress.store(-1.0f, std::memory_order_relaxed); }
+
+    // Records dropped because the ring was full, since construction
+    int getNumDropped() const { return mNumDropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence { 0 };
+        Record record;
+    };
+
+    std::unique_ptr<Cell[]> mCells;
+    size_t mMask { 0 };
+
+    // Apart, so producers and the consumer don't share a cache line
+    alignas(64) std::atomic<size_t> mWritePosition { 0 };
+    alignas(64) size_t mReadPosition { 0 };
+
+    std::atomic<float> mProgress { -1.0f };
+    std::atomic<int> mNumDropped { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Telemetry)
+};
@@ -0,0 +1,348 @@
+#include "ThreadTuner.h"
+#include <map>
+#include <mutex>
+#include <set>
+#include <tuple>
+
+#if JUCE_LINUX
+ #include <pthread.h>
+ #include <sched.h>
+#endif
+
+extern "C" void openblas_set_num_threads(int numThreads);
+extern "C" int openblas_get_num_threads();
+
+namespace
+{
+    // One htdemucs segment, shorter inputs are padded to it anyway
+    constexpr double kCalibrationSeconds = 7.8;
+
+    void report(const ThreadTuner::ProgressCallback& onProgress, const juce::String& message)
+    {
+        if (onProgress)
+            onProgress(message);
+    }
+
+   #if JUCE_LINUX
+    // "0-3,8-11" as in sysfs cpulist files
+    std::vector<int> parseCpuList(const juce::String& list)
+    {
+        std::vector<int> cpus;
+        for (const auto& part : juce::StringArray::fromTokens(list.trim(), ",", {}))
+        {
+            if (part.containsChar('-'))
+            {
+                const int last = part.fromFirstOccurrenceOf("-", false, false).getIntValue();
+                for (int cpu = part.upToFirstOccurrenceOf("-", false, false).getIntValue(); cpu <= last; ++cpu)
+                    cpus.push_back(cpu);
+            }
+            else if (part.trim().isNotEmpty())
+            {
+                cpus.push_back(part.getIntValue());
+            }
+        }
+        return cpus;
+    }
+   #endif
+
+    Eigen::MatrixXf createCalibrationAudio()
+    {
+        juce::Random random(1234);
+        Eigen::MatrixXf audio(2, juce::roundToInt(kCalibrationSeconds * 44100.0));
+        for (Eigen::Index i = 0; i < audio.size(); ++i)
+            audio.data()[i] = random.nextFloat() * 0.5f - 0.25f;
+        return audio;
+    }
+
+    // Wall time for every worker of the plan separating the audio once, all at the same time
+    double runCandidate(const demucscpp::demucs_model& model, const Eigen::MatrixXf& audio, const ThreadTuner::Plan& plan)
+    {
+        std::mutex lock;
+        int numRunning = plan.numWorkers;
+        std::string error;
+        juce::WaitableEvent finished;
+
+        const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+        juce::ThreadPool pool(plan.numWorkers);
+        for (int worker = 0; worker < plan.numWorkers; ++worker)
+        {
+            pool.addJob([&, worker]
+            {
+                try
+                {
+                    ThreadTuner::applyToCurrentThread(plan, worker);
+                    demucscpp::demucs_inference(model, audio, [](float, const std::string&) {});
+                }
+                catch (const std::exception& e)
+                {
+                    const std::lock_guard<std::mutex> guard(lock);
+                    error = e.what();
+                }
+
+                const std::lock_guard<std::mutex> guard(lock);
+                if (--numRunning == 0)
+                    finished.signal();
+            });
+        }
+
+        finished.wait(-1);
+
+        if (!error.empty())
+            throw std::runtime_error("Calibration failed: " + error);
+
+        return (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    }
+}
+
+ThreadTuner::Topology ThreadTuner::Topology::detect()
+{
+    Topology topology;
+    topology.numLogicalCpus = juce::SystemStats::getNumCpus();
+
+   #if JUCE_LINUX
+    // Only the CPUs this process may use, which is less than the machine in a container
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        std::map<int, int> nodeOfCpu;
+        for (const auto& nodeDirectory : juce::File("/sys/devices/system/node").findChildFiles(juce::File::findDirectories, false, "node*"))
+            for (const auto cpu : parseCpuList(nodeDirectory.getChildFile("cpulist").loadFileAsString()))
+                nodeOfCpu[cpu] = nodeDirectory.getFileName().substring(4).getIntValue();
+
+        // Ordered by node, so consecutive cores stay on one node
+        std::map<std::tuple<int, int, int>, Core> cores;
+        std::set<int> nodes;
+        int numAllowed = 0;
+
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (!CPU_ISSET(cpu, &allowed))
+                continue;
+
+            ++numAllowed;
+            const auto directory = juce::File("/sys/devices/system/cpu/cpu" + juce::String(cpu) + "/topology");
+            const auto coreIdFile = directory.getChildFile("core_id");
+            const int package = directory.getChildFile("physical_package_id").loadFileAsString().getIntValue();
+            const int coreId = coreIdFile.existsAsFile() ? coreIdFile.loadFileAsString().getIntValue() : cpu;
+            const int node = nodeOfCpu.count(cpu) != 0 ? nodeOfCpu[cpu] : 0;
+
+            auto& core = cores[std::make_tuple(node, package, coreId)];
+            core.node = node;
+            core.cpus.push_back(cpu);
+            nodes.insert(node);
+        }
+
+        for (const auto& entry : cores)
+            topology.cores.push_back(entry.second);
+
+        topology.numLogicalCpus = juce::jmax(1, numAllowed);
+        topology.numNodes = juce::jmax(1, static_cast<int>(nodes.size()));
+        topology.canPin = !topology.cores.empty();
+    }
+   #endif
+
+    // Elsewhere only the counts are known and threads aren't pinned
+    if (topology.cores.empty())
+        topology.cores.resize((size_t) juce::jmax(1, juce::SystemStats::getNumPhysicalCpus()));
+
+    return topology;
+}
+
+juce::String ThreadTuner::Topology::getSignature() const
+{
+    return juce::SystemStats::getCpuModel().trim() + "/" + juce::String(getNumCores()) + "c" + juce::String(numLogicalCpus)
+         + "t" + juce::String(numNodes) + "n";
+}
+
+juce::String ThreadTuner::Topology::toString() const
+{
+    return juce::String(getNumCores()) + " cores (" + juce::String(numLogicalCpus) + " logical CPUs) on "
+         + juce::String(numNodes) + (numNodes == 1 ? " NUMA node" : " NUMA nodes");
+}
+
+juce::String ThreadTuner::Plan::toString() const
+{
+    return juce::String(numWorkers) + (numWorkers == 1 ? " worker" : " workers") + " x "
+         + juce::String(blasThreads) + " BLAS " + (blasThreads == 1 ? "thread" : "threads")
+         + (workerCpus.empty() ? ", not pinned" : ", pinned")
+         + (segmentsPerSecond > 0.0 ? ", " + juce::String(segmentsPerSecond, 2) + " segments/s" : juce::String());
+}
+
+ThreadTuner::Plan ThreadTuner::makePlan(const Topology& topology, int numWorkers)
+{
+    Plan plan;
+    plan.numWorkers = juce::jmax(1, numWorkers);
+
+    // More workers than cores share cores with one BLAS thread each
+    const int numCores = topology.getNumCores();
+    const int coresPerWorker = juce::jmax(1, numCores / plan.numWorkers);
+    plan.blasThreads = coresPerWorker;
+
+    if (topology.canPin)
+    {
+        for (int worker = 0; worker < plan.numWorkers; ++worker)
+        {
+            std::vector<int> cpus;
+            for (int core = worker * coresPerWorker; core < (worker + 1) * coresPerWorker; ++core)
+            {
+                const auto& coreCpus = topology.cores[(size_t) (core % numCores)].cpus;
+                cpus.insert(cpus.end(), coreCpus.begin(), coreCpus.end());
+            }
+            plan.workerCpus.push_back(std::move(cpus));
+        }
+    }
+
+    return plan;
+}
+
+ThreadTuner::Plan ThreadTuner::splitWorker(const Plan& plan, int worker, int numWorkers)
+{
+    Plan split;
+    split.numWorkers = juce::jmax(1, numWorkers);
+    split.blasThreads = juce::jmax(1, plan.blasThreads / split.numWorkers);
+
+    if (juce::isPositiveAndBelow(worker, static_cast<int>(plan.workerCpus.size())))
+    {
+        // With fewer CPUs than threads, every thread runs on all of the worker's CPUs
+        const auto& cpus = plan.workerCpus[(size_t) worker];
+        const auto cpusPerWorker = cpus.size() / (size_t) split.numWorkers;
+
+        for (size_t i = 0; i < (size_t) split.numWorkers; ++i)
+            split.workerCpus.push_back(cpusPerWorker == 0 ? cpus
+                                                          : std::vector<int>(cpus.begin() + (std::ptrdiff_t) (i * cpusPerWorker),
+                                                                             cpus.begin() + (std::ptrdiff_t) ((i + 1) * cpusPerWorker)));
+    }
+
+    return split;
+}
+
+ThreadTuner::Plan ThreadTuner::getTunedPlan(const demucscpp::demucs_model& model, const Topology& topology,
+                                            bool recalibrate, ProgressCallback onProgress)
+{
+    const auto cacheFile = getCacheFile();
+    const juce::Identifier key(topology.getSignature());
+    auto cache = juce::JSON::parse(cacheFile);
+
+    if (!recalibrate)
+    {
+        const auto entry = cache.getProperty(key, {});
+        if (entry.isObject())
+        {
+            auto plan = makePlan(topology, entry.getProperty("workers", 1));
+            plan.segmentsPerSecond = entry.getProperty("segmentsPerSecond", 0.0);
+            report(onProgress, "Using the calibrated thread split for this machine: " + plan.toString());
+            return plan;
+        }
+    }
+
+    const auto plan = calibrate(model, topology, onProgress);
+
+    if (!cache.isObject())
+        cache = juce::var(new juce::DynamicObject());
+
+    auto* entry = new juce::DynamicObject();
+    entry->setProperty("workers", plan.numWorkers);
+    entry->setProperty("blasThreads", plan.blasThreads);
+    entry->setProperty("segmentsPerSecond", plan.segmentsPerSecond);
+    cache.getDynamicObject()->setProperty(key, juce::var(entry));
+
+    // Losing the cache only costs another calibration
+    cacheFile.getParentDirectory().createDirectory();
+    juce::TemporaryFile temporary(cacheFile);
+    if (temporary.getFile().replaceWithText(juce::JSON::toString(cache)))
+        temporary.overwriteTargetFileWithTemporary();
+
+    return plan;
+}
+
+ThreadTuner::Plan ThreadTuner::calibrate(const demucscpp::demucs_model& model, const Topology& topology,
+                                         ProgressCallback onProgress)
+{
+    report(onProgress, "Calibrating threads on " + topology.toString());
+
+    const auto audio = createCalibrationAudio();
+
+    // The first inference pays for cold caches and page faults in the weights
+    runCandidate(model, audio, makePlan(topology, 1));
+
+    Plan best;
+    for (int numWorkers = 1; numWorkers <= topology.getNumCores(); numWorkers *= 2)
+    {
+        auto plan = makePlan(topology, numWorkers);
+        const double seconds = runCandidate(model, audio, plan);
+        plan.segmentsPerSecond = seconds > 0.0 ? numWorkers / seconds : 0.0;
+        report(onProgress, "  " + plan.toString());
+
+        if (plan.segmentsPerSecond > best.segmentsPerSecond)
+            best = plan;
+    }
+
+    report(onProgress, "Best thread split: " + best.toString());
+    return best;
+}
+
+void ThreadTuner::applyToCurrentThread(const Plan& plan, int worker)
+{
+    setBlasThreads(plan.blasThreads);
+
+   #if JUCE_LINUX
+    if (juce::isPositiveAndBelow(worker, static_cast<int>(plan.workerCpus.size())) && !plan.workerCpus[(size_t) worker].empty())
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (const auto cpu : plan.workerCpus[(size_t) worker])
+            CPU_SET(cpu, &cpus);
+
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+   #else
+    juce::ignoreUnused(worker);
+   #endif
+}
+
+void ThreadTuner::setBlasThreads(int numThreads)
+{
+    // With the OpenMP build this sets the calling thread's team size, with the pthreads
+    // build the one pool every thread shares
+    openblas_set_num_threads(juce::jmax(1, numThreads));
+}
+
+ThreadTuner::ScopedPlan::ScopedPlan(const Plan& plan, int worker)
+    : mBlasThreads(openblas_get_num_threads())
+{
+   #if JUCE_LINUX
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0)
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &cpus))
+                mCpus.push_back(cpu);
+   #endif
+
+    applyToCurrentThread(plan, worker);
+}
+
+ThreadTuner::ScopedPlan::~ScopedPlan()
+{
+    setBlasThreads(mBlasThreads);
+
+   #if JUCE_LINUX
+    if (!mCpus.empty())
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (const auto cpu : mCpus)
+            CPU_SET(cpu, &cpus);
+
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+   #endif
+}
+
+juce::File ThreadTuner::getCacheFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+           .getChildFile("DemucsJUCE/thread_plans.json");
+}
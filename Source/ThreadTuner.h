@@ -0,0 +1,95 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <vector>
+#include "model.hpp"
+
+// Splits the machine between separation workers and the OpenBLAS threads each of them
+// runs, so that several separations in one process don't oversubscribe the cores. Every
+// worker gets its own set of physical cores (with their SMT siblings, within one NUMA
+// node where possible) and as many BLAS threads as it has cores. The best worker count
+// is found with a short calibration run and cached per machine.
+class ThreadTuner
+{
+public:
+    using ProgressCallback = std::function<void(const juce::String& message)>;
+
+    struct Topology
+    {
+        struct Core
+        {
+            int node { 0 };
+            std::vector<int> cpus; // logical CPUs, SMT siblings share a core
+        };
+
+        // Physical cores this process may run on, ordered by NUMA node
+        std::vector<Core> cores;
+        int numLogicalCpus { 1 };
+        int numNodes { 1 };
+
+        // Whether the logical CPU ids are known and threads can be pinned to them
+        bool canPin { false };
+
+        static Topology detect();
+
+        int getNumCores() const { return juce::jmax(1, static_cast<int>(cores.size())); }
+
+        // Identifies the machine for the calibration cache
+        juce::String getSignature() const;
+        juce::String toString() const;
+    };
+
+    struct Plan
+    {
+        int numWorkers { 1 };
+        int blasThreads { 1 };
+
+        // Logical CPUs per worker, empty where pinning isn't supported
+        std::vector<std::vector<int>> workerCpus;
+
+        // Measured by calibrate(), 0 for a plan that wasn't
+        double segmentsPerSecond { 0.0 };
+
+        juce::String toString() const;
+    };
+
+    // numWorkers workers sharing the cores evenly
+    static Plan makePlan(const Topology& topology, int numWorkers);
+
+    // One worker's share of plan, split again between numWorkers threads of its own, such
+    // as the streaming chunk workers of a batch or server worker
+    static Plan splitWorker(const Plan& plan, int worker, int numWorkers);
+
+    // The cached split for this machine, or a calibration run whose result is cached
+    static Plan getTunedPlan(const demucscpp::demucs_model& model, const Topology& topology,
+                             bool recalibrate = false, ProgressCallback onProgress = {});
+
+    // Separates one segment on every worker at once for 1, 2, 4... workers and keeps the
+    // split with the highest throughput. Takes a few segment inference times per candidate.
+    static Plan calibrate(const demucscpp::demucs_model& model, const Topology& topology,
+                          ProgressCallback onProgress = {});
+
+    // Pins the calling thread to the worker's cores and sets its BLAS thread count. BLAS
+    // threads started from it inherit the pinning.
+    static void applyToCurrentThread(const Plan& plan, int worker);
+
+    static void setBlasThreads(int numThreads);
+
+    // applyToCurrentThread() for as long as it lives, then puts back the thread's previous
+    // pinning and the BLAS thread count, which every other thread shares
+    class ScopedPlan
+    {
+    public:
+        ScopedPlan(const Plan& plan, int worker);
+        ~ScopedPlan();
+
+    private:
+        int mBlasThreads;
+        std::vector<int> mCpus; // empty where the pinning couldn't be read
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedPlan)
+    };
+
+    static juce::File getCacheFile();
+};
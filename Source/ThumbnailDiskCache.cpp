@@ -0,0 +1,77 @@
+#include "ThumbnailDiskCache.h"
+#include <algorithm>
+
+namespace
+{
+    constexpr const char* kFileExtension = ".thumb";
+}
+
+ThumbnailDiskCache::ThumbnailDiskCache(const juce::File& directory, int maxThumbsInMemory, int maxFiles)
+    : juce::AudioThumbnailCache(maxThumbsInMemory),
+      mDirectory(directory),
+      mMaxFiles(maxFiles)
+{
+    // Without the directory it is a plain in-memory cache
+    mDirectory.createDirectory();
+}
+
+juce::File ThumbnailDiskCache::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+           .getChildFile("DemucsJUCE/thumbnails");
+}
+
+bool ThumbnailDiskCache::loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    const auto file = getFile(hashCode);
+    juce::FileInputStream stream(file);
+    if (stream.failedToOpen() || !thumb.loadFrom(stream))
+        return false;
+
+    // The modification time doubles as the LRU timestamp
+    file.setLastModificationTime(juce::Time::getCurrentTime());
+    return true;
+}
+
+void ThumbnailDiskCache::saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    if (!mDirectory.isDirectory())
+        return;
+
+    const auto file = getFile(hashCode);
+    juce::TemporaryFile temporary(file);
+
+    {
+        juce::FileOutputStream stream(temporary.getFile());
+        if (stream.failedToOpen())
+            return;
+
+        thumb.saveTo(stream);
+        stream.flush();
+        if (stream.getStatus().failed())
+            return;
+    }
+
+    if (temporary.overwriteTargetFileWithTemporary())
+        removeOldFiles();
+}
+
+juce::File ThumbnailDiskCache::getFile(juce::int64 hashCode) const
+{
+    return mDirectory.getChildFile(juce::String::toHexString(hashCode) + kFileExtension);
+}
+
+void ThumbnailDiskCache::removeOldFiles()
+{
+    auto files = mDirectory.findChildFiles(juce::File::findFiles, false, juce::String("*") + kFileExtension);
+    if (files.size() <= mMaxFiles)
+        return;
+
+    std::sort(files.begin(), files.end(), [](const juce::File& a, const juce::File& b)
+    {
+        return a.getLastModificationTime() < b.getLastModificationTime();
+    });
+
+    for (int i = 0; i < files.size() - mMaxFiles; ++i)
+        files.getReference(i).deleteFile();
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// An AudioThumbnailCache that also keeps every finished thumbnail in a directory, so stems
+// opened again in a later session draw without being read. Files are named after the
+// thumbnail's source hash; the least recently used ones go once there are more than
+// maxFiles.
+class ThumbnailDiskCache : public juce::AudioThumbnailCache
+{
+public:
+    ThumbnailDiskCache(const juce::File& directory, int maxThumbsInMemory, int maxFiles);
+
+    static juce::File getDefaultDirectory();
+
+private:
+    bool loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+    void saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+
+    juce::File getFile(juce::int64 hashCode) const;
+    void removeOldFiles();
+
+    const juce::File mDirectory;
+    const int mMaxFiles;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ThumbnailDiskCache)
+};
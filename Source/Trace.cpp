@@ -0,0 +1,342 @@
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace
+{
+    constexpr int kEventsPerThread = 16384;
+    constexpr size_t kMaxNameLength = 47;
+
+    struct Event
+    {
+        char name[kMaxNameLength + 1];
+        juce::int64 start;
+        juce::int64 end;
+        juce::uint32 thread;
+    };
+
+    struct ThreadBuffer
+    {
+        std::unique_ptr<Event[]> events { new Event[kEventsPerThread] };
+        std::atomic<int> numEvents { 0 };
+        std::atomic<int> numDropped { 0 };
+    };
+
+    // Buffers outlive the threads that wrote them; an exiting thread hands its buffer
+    // back so the next new thread appends to it instead of allocating another one
+    class Registry
+    {
+    public:
+        ThreadBuffer* acquire()
+        {
+            const std::lock_guard<std::mutex> lock(mLock);
+            if (!mFree.empty())
+            {
+                auto* buffer = mFree.back();
+                mFree.pop_back();
+                return buffer;
+            }
+
+            mBuffers.push_back(std::make_unique<ThreadBuffer>());
+            return mBuffers.back().get();
+        }
+
+        void release(ThreadBuffer* buffer)
+        {
+            const std::lock_guard<std::mutex> lock(mLock);
+            mFree.push_back(buffer);
+        }
+
+        template <typename Function>
+        void forEachBuffer(Function&& function)
+        {
+            const std::lock_guard<std::mutex> lock(mLock);
+            for (auto& buffer : mBuffers)
+                function(*buffer);
+        }
+
+    private:
+        std::mutex mLock;
+        std::vector<std::unique_ptr<ThreadBuffer>> mBuffers;
+        std::vector<ThreadBuffer*> mFree;
+    };
+
+    // Deliberately leaked, thread exit can run after static destruction
+    Registry& getRegistry()
+    {
+        static auto* registry = new Registry();
+        return *registry;
+    }
+
+    std::atomic<juce::uint32> nextThreadIndex { 1 };
+
+    struct ThreadSlot
+    {
+        ~ThreadSlot()
+        {
+            if (buffer != nullptr)
+                getRegistry().release(buffer);
+        }
+
+        ThreadBuffer* buffer { nullptr };
+        juce::uint32 index { nextThreadIndex++ };
+
+        // Set by Session::Scope, the buffer is looked up on the first span
+        std::shared_ptr<Trace::Session> session;
+        ThreadBuffer* sessionBuffer { nullptr };
+    };
+
+    thread_local ThreadSlot threadSlot;
+
+    double ticksToMicroseconds(juce::int64 ticks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6;
+    }
+
+    template <typename Buffers>
+    bool writeChromeTraceOf(Buffers& buffers, const juce::File& file)
+    {
+        juce::FileOutputStream stream(file);
+        if (stream.failedToOpen())
+            return false;
+
+        stream.setPosition(0);
+        stream.truncate();
+
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        bool first = true;
+        int numDropped = 0;
+        buffers.forEachBuffer([&](ThreadBuffer& buffer)
+        {
+            const int numEvents = buffer.numEvents.load(std::memory_order_acquire);
+            numDropped += buffer.numDropped.load(std::memory_order_relaxed);
+
+            for (int i = 0; i < numEvents; ++i)
+            {
+                const auto& event = buffer.events[(size_t) i];
+                stream << (first ? "" : ",\n")
+                       << "{\"name\":" << juce::JSON::toString(juce::String(event.name))
+                       << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << (int) event.thread
+                       << ",\"ts\":" << juce::String(ticksToMicroseconds(event.start), 1)
+                       << ",\"dur\":" << juce::String(ticksToMicroseconds(event.end - event.start), 1)
+                       << "}";
+                first = false;
+            }
+        });
+
+        stream << "\n],\"otherData\":{\"droppedEvents\":" << numDropped << "}}\n";
+        stream.flush();
+        return stream.getStatus().wasOk();
+    }
+
+    template <typename Buffers>
+    std::vector<Trace::StageSummary> summariseOf(Buffers& buffers)
+    {
+        std::map<juce::String, Trace::StageSummary> stages;
+        double total = 0.0;
+
+        buffers.forEachBuffer([&](ThreadBuffer& buffer)
+        {
+            const int numEvents = buffer.numEvents.load(std::memory_order_acquire);
+            for (int i = 0; i < numEvents; ++i)
+            {
+                const auto& event = buffer.events[(size_t) i];
+                const auto name = juce::String(event.name).removeCharacters("0123456789").trim();
+                const double milliseconds = juce::Time::highResolutionTicksToSeconds(event.end - event.start) * 1000.0;
+
+                auto& stage = stages[name];
+                stage.name = name;
+                stage.totalMilliseconds += milliseconds;
+                ++stage.numCalls;
+                total += milliseconds;
+            }
+        });
+
+        std::vector<Trace::StageSummary> result;
+        for (auto& [name, stage] : stages)
+        {
+            stage.percent = total > 0.0 ? 100.0 * stage.totalMilliseconds / total : 0.0;
+            result.push_back(stage);
+        }
+
+        std::sort(result.begin(), result.end(), [](const Trace::StageSummary& a, const Trace::StageSummary& b)
+        {
+            return a.totalMilliseconds > b.totalMilliseconds;
+        });
+
+        return result;
+    }
+}
+
+// One buffer per thread that recorded into the session, all freed with it
+struct Trace::Session::Buffers
+{
+    ThreadBuffer* acquire(juce::uint32 thread)
+    {
+        const std::lock_guard<std::mutex> lock(mLock);
+        auto& buffer = mBuffers[thread];
+        if (buffer == nullptr)
+            buffer = std::make_unique<ThreadBuffer>();
+        return buffer.get();
+    }
+
+    template <typename Function>
+    void forEachBuffer(Function&& function)
+    {
+        const std::lock_guard<std::mutex> lock(mLock);
+        for (auto& [thread, buffer] : mBuffers)
+            function(*buffer);
+    }
+
+    std::mutex mLock;
+    std::map<juce::uint32, std::unique_ptr<ThreadBuffer>> mBuffers;
+};
+
+juce::int64 Trace::now()
+{
+    return juce::Time::getHighResolutionTicks();
+}
+
+void Trace::record(const char* name, juce::int64 startTicks, juce::int64 endTicks)
+{
+    auto& slot = threadSlot;
+    ThreadBuffer* target = nullptr;
+
+    if (slot.session != nullptr)
+    {
+        if (slot.sessionBuffer == nullptr)
+            slot.sessionBuffer = slot.session->mBuffers->acquire(slot.index);
+        target = slot.sessionBuffer;
+    }
+    else
+    {
+        if (slot.buffer == nullptr)
+            slot.buffer = getRegistry().acquire();
+        target = slot.buffer;
+    }
+
+    auto& buffer = *target;
+    const int index = buffer.numEvents.load(std::memory_order_relaxed);
+    if (index >= kEventsPerThread)
+    {
+        buffer.numDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto& event = buffer.events[(size_t) index];
+    std::strncpy(event.name, name, kMaxNameLength);
+    event.name[kMaxNameLength] = '\0';
+    event.start = startTicks;
+    event.end = endTicks;
+    event.thread = slot.index;
+
+    // Publishes the event to readers that load numEvents with acquire
+    buffer.numEvents.store(index + 1, std::memory_order_release);
+}
+
+Trace::Timeline::Timeline(const char* prefix)
+{
+    mPrefixLength = juce::jmin(std::strlen(prefix), sizeof(mName) - 1);
+    std::memcpy(mName, prefix, mPrefixLength);
+    mName[mPrefixLength] = '\0';
+}
+
+void Trace::Timeline::next(const std::string& message)
+{
+    const auto time = now();
+    if (mOpen)
+        record(mName, mStart, time);
+
+    const auto length = juce::jmin(message.size(), sizeof(mName) - 1 - mPrefixLength);
+    std::memcpy(mName + mPrefixLength, message.data(), length);
+    mName[mPrefixLength + length] = '\0';
+
+    mStart = time;
+    mOpen = true;
+}
+
+void Trace::Timeline::finish()
+{
+    if (mOpen)
+        record(mName, mStart, now());
+    mOpen = false;
+}
+
+void Trace::clear()
+{
+    getRegistry().forEachBuffer([](ThreadBuffer& buffer)
+    {
+        buffer.numEvents.store(0, std::memory_order_release);
+        buffer.numDropped.store(0, std::memory_order_relaxed);
+    });
+}
+
+bool Trace::writeChromeTrace(const juce::File& file)
+{
+    return writeChromeTraceOf(getRegistry(), file);
+}
+
+std::vector<Trace::StageSummary> Trace::summarise()
+{
+    return summariseOf(getRegistry());
+}
+
+Trace::Session::Session() : mBuffers(std::make_unique<Buffers>()) {}
+
+Trace::Session::~Session() = default;
+
+Trace::Session::Scope::Scope(std::shared_ptr<Session> session) : mSession(std::move(session))
+{
+    if (mSession == nullptr)
+        return;
+
+    auto& slot = threadSlot;
+    mPrevious = std::exchange(slot.session, mSession);
+    slot.sessionBuffer = nullptr;
+}
+
+Trace::Session::Scope::~Scope()
+{
+    if (mSession == nullptr)
+        return;
+
+    auto& slot = threadSlot;
+    slot.session = std::move(mPrevious);
+    slot.sessionBuffer = nullptr;
+}
+
+std::shared_ptr<Trace::Session> Trace::Session::getCurrent()
+{
+    return threadSlot.session;
+}
+
+bool Trace::Session::writeChromeTrace(const juce::File& file)
+{
+    return writeChromeTraceOf(*mBuffers, file);
+}
+
+std::vector<Trace::StageSummary> Trace::Session::summarise()
+{
+    return summariseOf(*mBuffers);
+}
+
+juce::String Trace::formatSummary(const std::vector<StageSummary>& stages)
+{
+    juce::String text;
+    text << juce::String("Stage").paddedRight(' ', 40) << juce::String("Total ms").paddedLeft(' ', 12)
+         << juce::String("Calls").paddedLeft(' ', 8) << juce::String("%").paddedLeft(' ', 8) << "\n";
+
+    for (const auto& stage : stages)
+        text << stage.name.paddedRight(' ', 40)
+             << juce::String(stage.totalMilliseconds, 1).paddedLeft(' ', 12)
+             << juce::String(stage.numCalls).paddedLeft(' ', 8)
+             << juce::String(stage.percent, 1).paddedLeft(' ', 8) << "\n";
+
+    return text;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+
+#ifndef DEMUCS_JUCE_TRACING
+ #define DEMUCS_JUCE_TRACING 0
+#endif
+
+// Lightweight span tracing. Every thread records into its own fixed-size buffer without
+// locking; the spans are read back once a run is over, either as a Chrome trace / Perfetto
+// JSON file or as a per-stage summary. Build with DEMUCS_JUCE_TRACING=0 to compile the
+// DEMUCS_TRACE_* macros away entirely.
+namespace Trace
+{
+    juce::int64 now();
+
+    // Names longer than 47 characters are truncated
+    void record(const char* name, juce::int64 startTicks, juce::int64 endTicks);
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name) : mName(name), mStart(now()) {}
+        ~Scope() { record(mName, mStart, now()); }
+
+    private:
+        const char* mName;
+        juce::int64 mStart;
+
+        JUCE_DECLARE_NON_COPYABLE(Scope)
+    };
+
+    // Turns demucs' progress messages into back-to-back spans: each span is named after the
+    // message that started it and ends when the next message arrives
+    class Timeline
+    {
+    public:
+        explicit Timeline(const char* prefix);
+        ~Timeline() { finish(); }
+
+        void next(const std::string& message);
+        void finish();
+
+    private:
+        char mName[48] {};
+        size_t mPrefixLength { 0 };
+        juce::int64 mStart { 0 };
+        bool mOpen { false };
+
+        JUCE_DECLARE_NON_COPYABLE(Timeline)
+    };
+
+    // These read and reset the process-wide spans, recorded by threads outside any
+    // Session. Only call them while no such thread is recording.
+    void clear();
+    bool writeChromeTrace(const juce::File& file);
+
+    struct StageSummary
+    {
+        juce::String name;
+        double totalMilliseconds { 0.0 };
+        int numCalls { 0 };
+        double percent { 0.0 };
+    };
+
+    // Spans grouped by name with digits removed (so "encoder 0".."encoder 3" add up),
+    // sorted by total time. Percentages are of the summed span time across all threads.
+    std::vector<StageSummary> summarise();
+    juce::String formatSummary(const std::vector<StageSummary>& stages);
+
+    // The spans of one run, kept apart from whatever else the process records meanwhile,
+    // such as queued jobs. Threads record into the session of their innermost Scope, so
+    // threads a run hands work to have to enter its session as well. Freed with the last
+    // reference, there is nothing to clear.
+    class Session
+    {
+    public:
+        Session();
+        ~Session();
+
+        // A null session leaves the thread recording where it was
+        class Scope
+        {
+        public:
+            explicit Scope(std::shared_ptr<Session> session);
+            ~Scope();
+
+        private:
+            std::shared_ptr<Session> mSession;
+            std::shared_ptr<Session> mPrevious;
+
+            JUCE_DECLARE_NON_COPYABLE(Scope)
+        };
+
+        // The calling thread's session, null outside any Scope
+        static std::shared_ptr<Session> getCurrent();
+
+        // Only call these once no thread records into this session any more
+        bool writeChromeTrace(const juce::File& file);
+        std::vector<StageSummary> summarise();
+
+    private:
+        struct Buffers;
+        std::unique_ptr<Buffers> mBuffers;
+
+        friend void record(const char* name, juce::int64 startTicks, juce::int64 endTicks);
+
+        JUCE_DECLARE_NON_COPYABLE(Session)
+    };
+}
+
+#if DEMUCS_JUCE_TRACING
+ #define DEMUCS_TRACE_SCOPE(name) const Trace::Scope JUCE_JOIN_MACRO(traceScope, __LINE__) (name)
+ #define DEMUCS_TRACE_TIMELINE(variable, prefix) Trace::Timeline variable (prefix)
+ #define DEMUCS_TRACE_TIMELINE_NEXT(variable, message) variable.next(message)
+ #define DEMUCS_TRACE_TIMELINE_FINISH(variable) variable.finish()
+ #define DEMUCS_TRACE_SESSION(session) const Trace::Session::Scope JUCE_JOIN_MACRO(traceSession, __LINE__) (session)
+#else
+ #define DEMUCS_TRACE_SCOPE(name)
+ #define DEMUCS_TRACE_TIMELINE(variable, prefix)
+ #define DEMUCS_TRACE_TIMELINE_NEXT(variable, message)
+ #define DEMUCS_TRACE_TIMELINE_FINISH(variable)
+ #define DEMUCS_TRACE_SESSION(session)
+#endif
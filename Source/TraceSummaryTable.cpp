@@ -0,0 +1,63 @@
+#include "TraceSummaryTable.h"
+
+TraceSummaryTable::TraceSummaryTable()
+{
+    auto& header = mTable.getHeader();
+    const int flags = juce::TableHeaderComponent::visible;
+    header.addColumn("Stage", stageColumn, 300, 100, -1, flags);
+    header.addColumn("Total ms", totalColumn, 100, 60, -1, flags);
+    header.addColumn("Calls", callsColumn, 70, 50, -1, flags);
+    header.addColumn("%", percentColumn, 70, 50, -1, flags);
+
+    mTable.setRowHeight(20);
+    addAndMakeVisible(mTable);
+}
+
+void TraceSummaryTable::setStages(std::vector<Trace::StageSummary> stages)
+{
+    mStages = std::move(stages);
+    mTable.updateContent();
+    mTable.repaint();
+}
+
+void TraceSummaryTable::resized()
+{
+    mTable.setBounds(getLocalBounds());
+}
+
+int TraceSummaryTable::getNumRows()
+{
+    return static_cast<int>(mStages.size());
+}
+
+void TraceSummaryTable::paintRowBackground(juce::Graphics& g, int row, int, int, bool isSelected)
+{
+    const auto background = getLookAndFeel().findColour(juce::ListBox::backgroundColourId);
+    if (isSelected)
+        g.fillAll(getLookAndFeel().findColour(juce::TextEditor::highlightColourId));
+    else if (row % 2 == 1)
+        g.fillAll(background.interpolatedWith(getLookAndFeel().findColour(juce::ListBox::textColourId), 0.05f));
+}
+
+void TraceSummaryTable::paintCell(juce::Graphics& g, int row, int columnId, int width, int height, bool)
+{
+    if (row < 0 || row >= getNumRows())
+        return;
+
+    const auto& stage = mStages[(size_t) row];
+    juce::String text;
+    auto justification = juce::Justification::centredRight;
+
+    switch (columnId)
+    {
+        case stageColumn:   text = stage.name; justification = juce::Justification::centredLeft; break;
+        case totalColumn:   text = juce::String(stage.totalMilliseconds, 1); break;
+        case callsColumn:   text = juce::String(stage.numCalls); break;
+        case percentColumn: text = juce::String(stage.percent, 1); break;
+        default: break;
+    }
+
+    g.setColour(getLookAndFeel().findColour(juce::ListBox::textColourId));
+    g.setFont(14.0f);
+    g.drawText(text, 4, 0, width - 8, height, justification, true);
+}
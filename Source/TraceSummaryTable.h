@@ -0,0 +1,34 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Trace.h"
+
+// Per-stage timings of the last run, slowest stage first
+class TraceSummaryTable : public juce::Component,
+                          private juce::TableListBoxModel
+{
+public:
+    TraceSummaryTable();
+
+    void setStages(std::vector<Trace::StageSummary> stages);
+
+    void resized() override;
+
+private:
+    enum ColumnIds
+    {
+        stageColumn = 1,
+        totalColumn,
+        callsColumn,
+        percentColumn
+    };
+
+    int getNumRows() override;
+    void paintRowBackground(juce::Graphics& g, int row, int width, int height, bool isSelected) override;
+    void paintCell(juce::Graphics& g, int row, int columnId, int width, int height, bool isSelected) override;
+
+    juce::TableListBox mTable { {}, this };
+    std::vector<Trace::StageSummary> mStages;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TraceSummaryTable)
+};